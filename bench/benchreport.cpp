@@ -0,0 +1,149 @@
+#include "benchreport.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
+#include <dirent.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace
+{
+  std::string number(double value) {
+      char text[32];
+      std::snprintf(text, sizeof(text), "%.6g", value);
+      return text;
+  }
+
+  std::string quoted(const std::string &text) {
+      std::string result = "\"";
+      for( std::size_t i = 0; i < text.size(); ++i ) {
+          char c = text[i];
+          if( c == '"' || c == '\\' ) {
+              result += '\\';
+              result += c;
+          }
+          else if( static_cast<unsigned char>(c) < 0x20 ) {
+              char escaped[8];
+              std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+              result += escaped;
+          }
+          else {
+              result += c;
+          }
+      }
+      return result + "\"";
+  }
+
+  double percentile(const std::vector<double> &sorted, double fraction) {
+      if( sorted.empty() ) {
+          return 0;
+      }
+      std::size_t index = static_cast<std::size_t>(fraction*(sorted.size() - 1) + 0.5);
+      return sorted[std::min(index, sorted.size() - 1)];
+  }
+}
+
+Summary::Summary(const std::vector<double> &samples) : count(samples.size()), mean(0), p50(0), p90(0), p99(0), max(0) {
+    if( samples.empty() ) {
+        return;
+    }
+    std::vector<double> sorted(samples);
+    std::sort(sorted.begin(), sorted.end());
+    double sum = 0;
+    for( std::size_t i = 0; i < sorted.size(); ++i ) {
+        sum += sorted[i];
+    }
+    mean = sum/sorted.size();
+    p50 = percentile(sorted, 0.5);
+    p90 = percentile(sorted, 0.9);
+    p99 = percentile(sorted, 0.99);
+    max = sorted.back();
+}
+
+BenchReport::BenchReport(const std::string &label) : label(label), firstScenario(true), firstField(true) {
+}
+
+void BenchReport::beginScenario(const std::string &name) {
+    body += firstScenario ? "\n    " : ",\n    ";
+    body += quoted(name) + ": {";
+    firstScenario = false;
+    firstField = true;
+}
+
+void BenchReport::endScenario() {
+    body += firstField ? "}" : "\n    }";
+}
+
+void BenchReport::field(const std::string &name) {
+    body += firstField ? "\n      " : ",\n      ";
+    body += quoted(name) + ": ";
+    firstField = false;
+}
+
+void BenchReport::add(const std::string &name, double value) {
+    field(name);
+    body += number(value);
+}
+
+void BenchReport::add(const std::string &name, const std::string &value) {
+    field(name);
+    body += quoted(value);
+}
+
+void BenchReport::add(const std::string &name, const std::vector<double> &samples, const std::string &unit) {
+    Summary summary(samples);
+    field(name);
+    body += "{\"count\": " + number(summary.count) +
+            ", \"mean_" + unit + "\": " + number(summary.mean) +
+            ", \"p50_" + unit + "\": " + number(summary.p50) +
+            ", \"p90_" + unit + "\": " + number(summary.p90) +
+            ", \"p99_" + unit + "\": " + number(summary.p99) +
+            ", \"max_" + unit + "\": " + number(summary.max) + "}";
+}
+
+std::string BenchReport::json() const {
+    char date[32];
+    std::time_t now = std::time(NULL);
+    std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+    return "{\n  \"label\": " + quoted(label) + ",\n  \"date\": " + quoted(date) +
+           ",\n  \"scenarios\": {" + body + (firstScenario ? "}\n}\n" : "\n  }\n}\n");
+}
+
+long long processCpuTime() {
+    struct timespec time;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &time);
+    return static_cast<long long>(time.tv_sec)*1000000000LL + time.tv_nsec;
+}
+
+long processWakeups() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_nvcsw;
+}
+
+long processThreads() {
+    DIR *tasks = opendir("/proc/self/task");
+    if( !tasks ) {
+        return -1;
+    }
+    long count = 0;
+    while( struct dirent *entry = readdir(tasks) ) {
+        if( entry->d_name[0] != '.' ) {
+            ++count;
+        }
+    }
+    closedir(tasks);
+    return count;
+}
+
+long processResidentKb() {
+    std::FILE *statm = std::fopen("/proc/self/statm", "r");
+    if( !statm ) {
+        return -1;
+    }
+    long size = 0, resident = 0;
+    int read = std::fscanf(statm, "%ld %ld", &size, &resident);
+    std::fclose(statm);
+    return read == 2 ? resident*(sysconf(_SC_PAGESIZE)/1024) : -1;
+}
@@ -0,0 +1,70 @@
+#ifndef BENCH_REPORT_H
+#define BENCH_REPORT_H
+
+#include <string>
+#include <vector>
+
+/**
+  * Summary of a set of measurements, computed once all of them are collected
+  */
+struct Summary {
+    Summary(const std::vector<double> &samples);
+    std::size_t count;
+    double mean;
+    double p50;
+    double p90;
+    double p99;
+    double max;
+};
+
+/**
+  * Benchmark results written as a single JSON object
+  * Each scenario is an object of named values and summaries, written in the order they were added
+  */
+class BenchReport
+{
+  public:
+    BenchReport(const std::string &label);
+
+    void beginScenario(const std::string &name);
+    void endScenario();
+
+    void add(const std::string &name, double value);
+    void add(const std::string &name, const std::string &value);
+
+    /**
+      * Adds the summary of the samples, unit is appended to the names of the fields
+      */
+    void add(const std::string &name, const std::vector<double> &samples, const std::string &unit);
+
+    /**
+      * Complete JSON document
+      */
+    std::string json() const;
+
+  private:
+    void field(const std::string &name);
+
+    std::string label;
+    std::string body;
+    bool firstScenario;
+    bool firstField;
+};
+
+/**
+  * CPU time of the whole process in nanoseconds
+  */
+long long processCpuTime();
+
+/**
+  * Context switches of the whole process, voluntary ones are the times a thread went to sleep and was woken
+  */
+long processWakeups();
+
+/**
+  * Threads of the process and its resident memory in kB, read from /proc
+  */
+long processThreads();
+long processResidentKb();
+
+#endif
@@ -0,0 +1,1736 @@
+/**
+ * Benchmarks of the Logger and Interface modules, run on the host against local stand-ins
+ * for ALMemory, ALAudioPlayer, ALAudioDevice, ALLeds and the sound classification module
+ *
+ * Usage: rtnbench [options]
+ *   --scenario=a,b         scenarios to run, all of them by default
+ *   --label=text           label written to the report, e.g. the version being measured
+ *   --faces=n              FaceDetected events raised in the callbacks, race and metrics scenarios (300)
+ *   --sounds=n             SoundClassified events raised in the callbacks, race and metrics scenarios (100)
+ *   --calls=n              ChildCalledRTN events raised in the callbacks and race scenarios, calls of the playback
+ *                          scenario and sessions of the cancel, startup and resume scenarios (20)
+ *   --clip=ms              length of every played clip (1500)
+ *   --idle=s               length of the idle scenario in seconds (60)
+ *   --events=n             events raised through each mode of the transport scenario (2000)
+ *   --kills=n              times each session of the resume scenario is killed at most (3)
+ *   --logs=directory       folder the session logs are written to, the recordings are written to its sounds folder (/tmp)
+ *   --port=n               port of the local broker (9600)
+ *   --out=file             writes the report to the file instead of the standard output
+ *   --resume-child=dir     runs one process of the resume scenario on the session in the folder, used by the scenario
+ *   --wav=file             16 bit WAV recording classified by the audio scenario, a synthetic one by default
+ *   --classifier-delay=ms  time the sound classification stand-in takes to start or stop in the classifier scenario (200)
+ *   --face-rate=hz         FaceDetected events raised per second in the stress, soak and throughput scenarios (30)
+ *   --sound-rate=hz        SoundClassified events raised per second in the stress, soak and throughput scenarios (10)
+ *   --stress=s             length of the stress scenario in seconds (30)
+ *   --soak=s               length of the soak scenario in seconds (120)
+ *   --late=ms              time from raising a sound to its record after which it counts as late (100)
+ *   --seed=n               seed of the random touches and ends of the stress and soak scenarios (1)
+ *
+ * Report is a JSON object with one object per scenario, times are in microseconds unless the name says otherwise
+ */
+
+#include "standins.hpp"
+#include "benchreport.hpp"
+#include "logmodule.hpp"
+#include "uimodule.hpp"
+#include "callprotocol.hpp"
+#include "remotetransport.hpp"
+#include "eventtime.hpp"
+#include "sessionlog.hpp"
+#include "logstorage.hpp"
+#include "audiofrontend.hpp"
+#include "sessionmetrics.hpp"
+#include "cputime.hpp"
+#include <alcommon/albroker.h>
+#include <alcommon/albrokermanager.h>
+#include <alerror/alerror.h>
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+#include <signal.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace
+{
+  struct Options {
+      std::string scenarios;
+      std::string label;
+      int faces;
+      int sounds;
+      int calls;
+      unsigned int clip;
+      unsigned int idle;
+      int events;
+      int kills;
+      std::string logs;
+      int port;
+      std::string out;
+      std::string resumeChild;
+      std::string wav;
+      unsigned int classifierDelay;
+      int faceRate;
+      int soundRate;
+      unsigned int stress;
+      unsigned int soak;
+      unsigned int late;
+      unsigned int seed;
+  };
+
+  /**
+    * Local broker with the stand-ins and both modules loaded into it
+    */
+  struct Bench {
+      Options options;
+      std::string program;
+      boost::shared_ptr<AL::ALBroker> broker;
+      boost::shared_ptr<MemoryStandIn> memory;
+      boost::shared_ptr<AudioPlayerStandIn> player;
+      boost::shared_ptr<AudioDeviceStandIn> audio;
+      boost::shared_ptr<ClassificationStandIn> classifier;
+      boost::shared_ptr<ResponseToNameLogger> logger;
+      boost::shared_ptr<ResponseToNameInterface> interface;
+
+      /**
+        * Time it took to create each module, in nanoseconds
+        */
+      long long loggerCreation;
+      long long interfaceCreation;
+  };
+
+  struct Scenario {
+      const char *name;
+      void (*run)(Bench &bench, BenchReport &report);
+  };
+
+  double microseconds(long long nanoseconds) {
+      return nanoseconds/1000.0;
+  }
+
+  /**
+    * Starts a session the way the robot does, by touching the front tactile sensor
+    * Returns once the Logger has started the session, false if it did not
+    */
+  bool startSession(Bench &bench) {
+      unsigned long started = bench.memory->raised("StartSessionRTN");
+      bench.interface->startTask("enable");
+      bench.memory->raiseEvent("FrontTactilTouched", AL::ALValue(1.0f));
+      if( !bench.memory->waitForEvent("StartSessionRTN", started + 1, 5000) ) {
+          std::fprintf(stderr, "Session did not start\n");
+          return false;
+      }
+      bench.memory->waitUntilDelivered();
+      return true;
+  }
+
+  /**
+    * Value of FaceDetected with one face, as raised by ALFaceDetection
+    */
+  AL::ALValue faceValue(int frame) {
+      AL::ALValue timestamp;
+      timestamp.arrayPush(frame/10);
+      timestamp.arrayPush((frame%10)*100000);
+      AL::ALValue shape;
+      shape.arrayPush(0);
+      shape.arrayPush(0.1f);
+      shape.arrayPush(0.05f);
+      shape.arrayPush(0.2f);
+      shape.arrayPush(0.2f);
+      AL::ALValue face;
+      face.arrayPush(shape);
+      AL::ALValue faces;
+      faces.arrayPush(face);
+      AL::ALValue value;
+      value.arrayPush(timestamp);
+      value.arrayPush(faces);
+      return value;
+  }
+
+  AL::ALValue soundValue(int sound) {
+      AL::ALValue value;
+      value.arrayPush(sound%2 ? "Artikulirano" : "Neartikulirano");
+      for( int i = 0; i < 12; ++i ) {
+          value.arrayPush(static_cast<float>(sound + i)/10);
+      }
+      return value;
+  }
+
+  /**
+    * Time from raising each event to the return of the Logger callback, by which the record is queued for the log
+    */
+  void callbacks(Bench &bench, BenchReport &report) {
+      if( !startSession(bench) ) {
+          return;
+      }
+      for( int i = 0; i < bench.options.faces; ++i ) {
+          bench.memory->raiseEvent("FaceDetected", faceValue(i));
+          boost::this_thread::sleep(boost::posix_time::milliseconds(10));
+      }
+      for( int i = 0; i < bench.options.sounds; ++i ) {
+          bench.memory->raiseEvent("SoundClassified", soundValue(i));
+          boost::this_thread::sleep(boost::posix_time::milliseconds(10));
+      }
+      for( int i = 0; i < bench.options.calls; ++i ) {
+          bench.memory->raiseEvent("ChildCalledRTN", AL::ALValue(1));
+          boost::this_thread::sleep(boost::posix_time::milliseconds(10));
+      }
+      bench.memory->raiseEvent("EndSessionRTN", AL::ALValue(0));
+      bench.memory->waitUntilDelivered();
+
+      std::map<std::string, std::vector<double> > latencies;
+      std::vector<Delivery> deliveries = bench.memory->deliveries(true);
+      for( std::size_t i = 0; i < deliveries.size(); ++i ) {
+          if( deliveries[i].module == "ResponseToNameLogger" ) {
+              latencies[deliveries[i].event].push_back(microseconds(deliveries[i].returned - deliveries[i].raised));
+          }
+      }
+      for( std::map<std::string, std::vector<double> >::const_iterator it = latencies.begin(); it != latencies.end(); ++it ) {
+          report.add(it->first, it->second, "us");
+      }
+  }
+
+  /**
+    * Events raised back to back to a module receiving them through the dispatcher, subscribed once, and to one
+    * unsubscribing and subscribing again in its callback, as the modules did before the dispatcher
+    * Measures events per second raised and handled for each and the events each of them missed
+    */
+  void subscriptions(Bench &bench, BenchReport &report) {
+      const char *patterns[] = { "dispatcher", "resubscribe" };
+      boost::shared_ptr<SubscriberStandIn> subscriber =
+          AL::ALModule::createModule<SubscriberStandIn>(bench.broker, "ResponseToNameSubscriber");
+      for( int pattern = 0; pattern < 2; ++pattern ) {
+          std::string event = std::string(patterns[pattern]) + "SubscriptionRTN";
+          bench.memory->declareEvent(event);
+          subscriber->start(event, pattern == 1);
+          subscriber->handled(true);
+          long long start = monotonicTime();
+          for( int i = 0; i < bench.options.faces; ++i ) {
+              bench.memory->raiseEvent(event, faceValue(i));
+          }
+          bench.memory->waitUntilDelivered();
+          long long elapsed = monotonicTime() - start;
+          subscriber->stop();
+          unsigned long handled = subscriber->handled(true);
+          bench.memory->forget(event);
+          bench.memory->deliveries(true);
+          report.add(std::string(patterns[pattern]) + "EventsPerSecond", handled*1e9/std::max(1LL, elapsed));
+          report.add(std::string(patterns[pattern]) + "Missed", static_cast<double>(bench.options.faces - handled));
+      }
+  }
+
+  /**
+    * Whole session in which the child never responds, every call is made and the session ends unanswered
+    * Measures the time from CallChildRTN to playFile, how late the calls are made and the cost of waiting for them
+    */
+  void calls(Bench &bench, BenchReport &report) {
+      CallProtocol::Parameters protocol;
+      bench.player->setClipLength(bench.options.clip);
+      bench.player->playTimes(true);
+      bench.memory->deliveries(true);
+      std::vector<long long> callsBefore = bench.memory->raiseTimes("CallChildRTN");
+      std::size_t calledBefore = bench.memory->raiseTimes("ChildCalledRTN").size();
+      std::size_t startsBefore = bench.memory->raiseTimes("StartSessionRTN").size();
+      bench.player->endTimes(true);
+      unsigned long ended = bench.memory->raised("EndSessionRTN");
+
+      long long cpu = processCpuTime();
+      long wakeups = processWakeups();
+      long long start = monotonicTime();
+      if( !startSession(bench) ) {
+          return;
+      }
+      unsigned int timeout = (protocol.nameCalls + protocol.phraseCalls + 1)*(protocol.callTimeout + bench.options.clip) + 10000;
+      if( !bench.memory->waitForEvent("EndSessionRTN", ended + 1, timeout) ) {
+          std::fprintf(stderr, "Session did not end\n");
+          return;
+      }
+      bench.memory->waitUntilDelivered();
+      long long elapsed = monotonicTime() - start;
+      cpu = processCpuTime() - cpu;
+      wakeups = processWakeups() - wakeups;
+
+      // Deadline of each decision is measured from the session start or the call end, the times the events carry,
+      // and each decision from the time CallChildRTN carries, which the Interface may act on before it reaches ALMemory
+      std::vector<long long> references = bench.memory->eventTimes("StartSessionRTN");
+      references.erase(references.begin(), references.begin() + startsBefore);
+      std::vector<long long> called = bench.memory->eventTimes("ChildCalledRTN");
+      references.insert(references.end(), called.begin() + calledBefore, called.end());
+      std::sort(references.begin(), references.end());
+      std::vector<double> callbackReturn;
+      std::vector<Delivery> deliveries = bench.memory->deliveries(true);
+      for( std::size_t i = 0; i < deliveries.size(); ++i ) {
+          if( deliveries[i].module == "ResponseToNameInterface" && deliveries[i].event == "CallChildRTN" ) {
+              callbackReturn.push_back(microseconds(deliveries[i].returned - deliveries[i].raised));
+          }
+      }
+      std::vector<long long> decisions = bench.memory->eventTimes("CallChildRTN");
+      decisions.erase(decisions.begin(), decisions.begin() + callsBefore.size());
+      std::vector<long long> plays = bench.player->playTimes(true);
+
+      std::vector<double> dispatch;
+      for( std::size_t i = 0; i < decisions.size() && i < plays.size(); ++i ) {
+          dispatch.push_back(microseconds(plays[i] - decisions[i]));
+      }
+      // Logger learns of the end of each call from ChildCalledRTN, raised once the clip ended
+      called = bench.memory->raiseTimes("ChildCalledRTN");
+      called.erase(called.begin(), called.begin() + calledBefore);
+      std::vector<long long> clipEnds = bench.player->endTimes(true);
+      std::vector<double> endNotice;
+      for( std::size_t i = 0; i < called.size() && i < clipEnds.size(); ++i ) {
+          endNotice.push_back(microseconds(called[i] - clipEnds[i]));
+      }
+      std::vector<long long> ends = bench.memory->eventTimes("EndSessionRTN");
+      decisions.push_back(ends.back());
+      std::vector<double> drift;
+      for( std::size_t i = 0; i < decisions.size() && i < references.size(); ++i ) {
+          drift.push_back(microseconds(decisions[i] - references[i]) - protocol.callTimeout*1000.0);
+      }
+
+      report.add("calls", static_cast<double>(decisions.size() - 1));
+      report.add("callChildToPlayFile", dispatch, "us");
+      report.add("callChildCallbackReturn", callbackReturn, "us");
+      report.add("clipEndToChildCalled", endNotice, "us");
+      report.add("deadlineDrift", drift, "us");
+      report.add("sessionSeconds", elapsed/1e9);
+      report.add("cpuMsPerMinute", cpu/1e6*60e9/elapsed);
+      report.add("wakeupsPerMinute", wakeups*60e9/elapsed);
+  }
+
+  /**
+    * Writes a 48 kHz stereo 16 bit recording of the given length, a tone the player has to decode like speech
+    */
+  bool writeRecording(const std::string &path, unsigned int milliseconds) {
+      const unsigned long rate = 48000, channels = 2;
+      unsigned long frames = rate*milliseconds/1000;
+      unsigned long dataSize = frames*channels*2;
+      unsigned char header[44] = { 'R', 'I', 'F', 'F', 0, 0, 0, 0, 'W', 'A', 'V', 'E',
+                                   'f', 'm', 't', ' ', 16, 0, 0, 0, 1, 0, channels, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                                   channels*2, 0, 16, 0, 'd', 'a', 't', 'a', 0, 0, 0, 0 };
+      unsigned long fields[4][2] = { { 4, 36 + dataSize }, { 24, rate }, { 28, rate*channels*2 }, { 40, dataSize } };
+      for( int i = 0; i < 4; ++i ) {
+          for( int b = 0; b < 4; ++b ) {
+              header[fields[i][0] + b] = static_cast<unsigned char>(fields[i][1] >> (8*b));
+          }
+      }
+      std::vector<unsigned char> data(dataSize);
+      for( unsigned long i = 0; i < frames; ++i ) {
+          short sample = static_cast<short>(8000*std::sin(2*M_PI*440*i/rate));
+          for( unsigned long c = 0; c < channels; ++c ) {
+              data[(i*channels + c)*2] = static_cast<unsigned char>(sample & 0xFF);
+              data[(i*channels + c)*2 + 1] = static_cast<unsigned char>((sample >> 8) & 0xFF);
+          }
+      }
+      std::FILE *out = std::fopen(path.c_str(), "wb");
+      if( !out ) {
+          std::perror(path.c_str());
+          return false;
+      }
+      bool written = std::fwrite(header, 1, sizeof(header), out) == sizeof(header) &&
+                     std::fwrite(&data[0], 1, data.size(), out) == data.size();
+      return std::fclose(out) == 0 && written;
+  }
+
+  /**
+    * Time from CallChildRTN and from the dispatch time carried by CallStartedRTN to the first sample of the call,
+    * with the recordings played from their files and with the recordings loaded into the player before the session
+    * Calls are made by the benchmark in short succession, clips are short so the Logger never makes a call of its own
+    */
+  void playback(Bench &bench, BenchReport &report) {
+      std::string directory = bench.options.logs + "/sounds";
+      mkdir(directory.c_str(), 0755);
+      const char *files[] = { "name.wav", "phrase.wav", "bravo.wav" };
+      for( int i = 0; i < 3; ++i ) {
+          if( !writeRecording(directory + "/" + files[i], bench.options.clip) ) {
+              return;
+          }
+      }
+      bench.interface->setParameter("soundDirectory", AL::ALValue(directory));
+      bench.player->setClipLength(10);
+
+      const char *modes[] = { "playFile", "soundBank" };
+      for( int mode = 0; mode < 2; ++mode ) {
+          bench.interface->setParameter("soundBank", AL::ALValue(mode == 1));
+          if( !startSession(bench) ) {
+              return;
+          }
+          std::size_t callsBefore = bench.memory->raiseTimes("CallChildRTN").size();
+          std::size_t startedBefore = bench.memory->eventTimes("CallStartedRTN").size();
+          unsigned long called = bench.memory->raised("ChildCalledRTN");
+          bench.player->firstSampleTimes(true);
+          for( int i = 0; i < bench.options.calls; ++i ) {
+              bench.memory->raiseEvent("CallChildRTN", AL::ALValue(1 + i%2));
+              if( !bench.memory->waitForEvent("ChildCalledRTN", called + i + 1, 5000) ) {
+                  std::fprintf(stderr, "Call was not made\n");
+                  return;
+              }
+          }
+          bench.memory->raiseEvent("EndSessionRTN", AL::ALValue(0));
+          bench.memory->waitUntilDelivered();
+
+          std::vector<long long> decisions = bench.memory->raiseTimes("CallChildRTN");
+          decisions.erase(decisions.begin(), decisions.begin() + callsBefore);
+          std::vector<long long> samples = bench.player->firstSampleTimes(true);
+          std::vector<double> latency;
+          for( std::size_t i = 0; i < decisions.size() && i < samples.size(); ++i ) {
+              latency.push_back(microseconds(samples[i] - decisions[i]));
+          }
+          report.add(std::string(modes[mode]) + "CallToFirstSample", latency, "us");
+          // CallStartedRTN carries the time the call was dispatched, the first sample follows it
+          std::vector<long long> dispatched = bench.memory->eventTimes("CallStartedRTN");
+          dispatched.erase(dispatched.begin(), dispatched.begin() + std::min(startedBefore, dispatched.size()));
+          std::vector<double> delay;
+          for( std::size_t i = 0; i < dispatched.size() && i < samples.size(); ++i ) {
+              delay.push_back(microseconds(samples[i] - dispatched[i]));
+          }
+          report.add(std::string(modes[mode]) + "DispatchToFirstSample", delay, "us");
+      }
+      bench.interface->setParameter("soundBank", AL::ALValue(true));
+      bench.player->playTimes(true);
+  }
+
+  /**
+    * Sessions ended while the child is being called, time from EndSessionRTN until the call is stopped and silent
+    * Cancelled calls must not be reported to the Logger as made
+    */
+  void cancel(Bench &bench, BenchReport &report) {
+      bench.player->setClipLength(bench.options.clip);
+      bench.player->stopTimes(true);
+      bench.player->endTimes(true);
+      std::size_t endsBefore = bench.memory->raiseTimes("EndSessionRTN").size();
+      unsigned long calledBefore = bench.memory->raised("ChildCalledRTN");
+      for( int i = 0; i < bench.options.calls; ++i ) {
+          if( !startSession(bench) ) {
+              return;
+          }
+          unsigned long callsStarted = bench.memory->raised("CallStartedRTN");
+          bench.memory->raiseEvent("CallChildRTN", AL::ALValue(1));
+          if( !bench.memory->waitForEvent("CallStartedRTN", callsStarted + 1, 5000) ) {
+              std::fprintf(stderr, "Call was not started\n");
+              return;
+          }
+          bench.memory->raiseEvent("EndSessionRTN", AL::ALValue(1));
+          bench.memory->waitUntilDelivered();
+      }
+      // Stopped calls end at once, bravo is played after each of them
+      boost::this_thread::sleep(boost::posix_time::milliseconds(bench.options.clip + 100));
+      bench.memory->waitUntilDelivered();
+
+      std::vector<long long> endsRaised = bench.memory->raiseTimes("EndSessionRTN");
+      endsRaised.erase(endsRaised.begin(), endsRaised.begin() + endsBefore);
+      std::vector<long long> stops = bench.player->stopTimes(true);
+      std::vector<long long> clipEnds = bench.player->endTimes(true);
+      std::vector<double> toStop, toSilence;
+      for( std::size_t i = 0; i < endsRaised.size(); ++i ) {
+          if( i < stops.size() ) {
+              toStop.push_back(microseconds(stops[i] - endsRaised[i]));
+          }
+          std::vector<long long>::const_iterator end = std::lower_bound(clipEnds.begin(), clipEnds.end(), endsRaised[i]);
+          if( end != clipEnds.end() ) {
+              toSilence.push_back(microseconds(*end - endsRaised[i]));
+          }
+      }
+      report.add("endSessionToStop", toStop, "us");
+      report.add("endSessionToSilence", toSilence, "us");
+      report.add("cancelledCallsReported", static_cast<double>(bench.memory->raised("ChildCalledRTN") - calledBefore));
+  }
+
+  /**
+    * No session in progress, cost of the modules waiting for the next one
+    */
+  void idle(Bench &bench, BenchReport &report) {
+      long long cpu = processCpuTime();
+      long wakeups = processWakeups();
+      long long start = monotonicTime();
+      boost::this_thread::sleep(boost::posix_time::seconds(bench.options.idle));
+      long long elapsed = monotonicTime() - start;
+      cpu = processCpuTime() - cpu;
+      wakeups = processWakeups() - wakeups;
+      report.add("seconds", elapsed/1e9);
+      report.add("cpuMsPerMinute", cpu/1e6*60e9/elapsed);
+      report.add("wakeupsPerMinute", wakeups*60e9/elapsed);
+  }
+
+  /**
+    * Events raised through a proxy connected to the broker over the loopback, the way a remote module raises them,
+    * one call at a time and pipelined by the sender of the transport, taking turns between the four events of
+    * a session, with the subscription changes of a session start and end every ten events
+    * Measures events per second and the time from raising each event to its arrival in ALMemory, and how many
+    * times more events per second and less tail latency the pipelined transport gives
+    */
+  void transport(Bench &bench, BenchReport &report) {
+      const char *modes[] = { "direct", "batched" };
+      boost::shared_ptr<AL::ALMemoryProxy> remote;
+      try {
+          remote = boost::shared_ptr<AL::ALMemoryProxy>(new AL::ALMemoryProxy("127.0.0.1", bench.options.port));
+      }
+      catch (const AL::ALError& e) {
+          std::fprintf(stderr, "Error connecting to the local broker %s\n", e.toString().c_str());
+          return;
+      }
+      const char *events[] = { "StartSession", "CallStarted", "ChildCalled", "EndSession" };
+      const int eventCount = sizeof(events)/sizeof(events[0]);
+      double eventsPerSecond[2] = { 0, 0 };
+      double tailLatency[2] = { 0, 0 };
+      for( int mode = 0; mode < 2; ++mode ) {
+          RemoteTransport transport(remote, "ResponseToNameBench", mode == 0 ? RemoteTransport::Direct : RemoteTransport::Batched);
+          std::vector<std::string> names;
+          std::vector<std::size_t> before;
+          for( int e = 0; e < eventCount; ++e ) {
+              names.push_back(std::string(modes[mode]) + events[e] + "TransportRTN");
+              before.push_back(bench.memory->raiseTimes(names.back()).size());
+          }
+          long long start = monotonicTime();
+          for( int i = 0; i < bench.options.events; ++i ) {
+              transport.raiseEvent(names[i%eventCount], timedEventValue(i, monotonicTime()));
+              if( i%10 == 0 ) {
+                  transport.subscribe("TransportChurnRTN", "onTransportChurn");
+                  transport.unsubscribe("TransportChurnRTN");
+              }
+          }
+          transport.flush();
+          std::vector<double> latency;
+          long long last = start;
+          for( int e = 0; e < eventCount; ++e ) {
+              unsigned long expected = bench.options.events/eventCount + (e < bench.options.events%eventCount ? 1 : 0);
+              if( !bench.memory->waitForEvent(names[e], before[e] + expected, 30000) ) {
+                  std::fprintf(stderr, "Events raised %s did not arrive\n", modes[mode]);
+                  return;
+              }
+              std::vector<long long> arrivals = bench.memory->raiseTimes(names[e]);
+              std::vector<long long> raised = bench.memory->eventTimes(names[e]);
+              for( std::size_t i = before[e]; i < arrivals.size() && i < raised.size(); ++i ) {
+                  latency.push_back(microseconds(arrivals[i] - raised[i]));
+              }
+              last = std::max(last, arrivals.back());
+          }
+          eventsPerSecond[mode] = bench.options.events*1e9/std::max(1LL, last - start);
+          tailLatency[mode] = Summary(latency).p99;
+          report.add(std::string(modes[mode]) + "EventsPerSecond", eventsPerSecond[mode]);
+          report.add(std::string(modes[mode]) + "RaiseToArrival", latency, "us");
+          report.add(std::string(modes[mode]) + "CallsSent", static_cast<double>(transport.sent()));
+          report.add(std::string(modes[mode]) + "Batches", static_cast<double>(transport.batches()));
+          report.add(std::string(modes[mode]) + "Coalesced", static_cast<double>(transport.coalesced()));
+      }
+      // Above 1 where the pipelined transport is the faster one
+      report.add("batchedEventsPerSecondGain", eventsPerSecond[0] > 0 ? eventsPerSecond[1]/eventsPerSecond[0] : 0.0);
+      report.add("batchedTailLatencyGain", tailLatency[1] > 0 ? tailLatency[0]/tailLatency[1] : 0.0);
+  }
+
+  /**
+    * Adds the mean and the maximum of every setup histogram of a module to the report, in microseconds
+    */
+  void addSetupHistograms(const std::string &module, const AL::ALValue &histograms, BenchReport &report) {
+      for( int i = 0; i < static_cast<int>(histograms.getSize()); ++i ) {
+          std::string name = (std::string)histograms[i][0];
+          int count = (int)histograms[i][1];
+          if( name.compare(0, 6, "Setup.") != 0 || count == 0 ) {
+              continue;
+          }
+          // Setup.sessionStart is reported as loggerSessionStartMean
+          std::string step = name.substr(6);
+          step[0] = static_cast<char>(std::toupper(step[0]));
+          report.add(module + step + "Mean", (double)histograms[i][2]/count);
+          report.add(module + step + "Max", static_cast<double>((int)histograms[i][3]));
+      }
+  }
+
+  /**
+    * Time each module took to be created, sessions started and ended one after another,
+    * time from the touch until StartSessionRTN and the time each step of the setup took in both modules
+    * Runs first, so the first session measured is the first one the modules start
+    */
+  void startup(Bench &bench, BenchReport &report) {
+      report.add("loggerCreation", microseconds(bench.loggerCreation));
+      report.add("interfaceCreation", microseconds(bench.interfaceCreation));
+      std::size_t touchesBefore = bench.memory->raiseTimes("FrontTactilTouched").size();
+      std::size_t startsBefore = bench.memory->eventTimes("StartSessionRTN").size();
+      for( int i = 0; i < bench.options.calls; ++i ) {
+          if( !startSession(bench) ) {
+              return;
+          }
+          bench.memory->raiseEvent("EndSessionRTN", AL::ALValue(0));
+          bench.memory->waitUntilDelivered();
+      }
+
+      std::vector<long long> touches = bench.memory->raiseTimes("FrontTactilTouched");
+      std::vector<long long> starts = bench.memory->eventTimes("StartSessionRTN");
+      std::vector<double> touchToStart;
+      for( std::size_t i = 0; touchesBefore + i < touches.size() && startsBefore + i < starts.size(); ++i ) {
+          touchToStart.push_back(microseconds(starts[startsBefore + i] - touches[touchesBefore + i]));
+      }
+      report.add("touchToStartSession", touchToStart, "us");
+      addSetupHistograms("logger", bench.logger->getLatencyHistograms(false), report);
+      addSetupHistograms("interface", bench.interface->getLatencyHistograms(false), report);
+  }
+
+  /**
+    * Raises one kind of event as fast as the stand-in takes them, from a thread of its own
+    */
+  struct Raiser {
+      Bench *bench;
+      std::string event;
+      int count;
+
+      void operator()() const {
+          for( int i = 0; i < count; ++i ) {
+              if( event == "FaceDetected" ) {
+                  bench->memory->raiseEvent(event, faceValue(i));
+              }
+              else if( event == "SoundClassified" ) {
+                  bench->memory->raiseEvent(event, soundValue(i));
+              }
+              else {
+                  bench->memory->raiseEvent(event, timedEventValue(1, monotonicTime()));
+              }
+          }
+      }
+  };
+
+  /**
+    * Reads the session state of the Logger in a loop until stopped, as an observer polling the module would,
+    * counting reads which go back in time within the session
+    */
+  struct StateReader {
+      Bench *bench;
+      volatile int *stop;
+      long reads;
+      long inconsistent;
+
+      void operator()() {
+          AL::ALValue last = bench->logger->getSessionState();
+          while( !__sync_fetch_and_add(stop, 0) ) {
+              AL::ALValue state = bench->logger->getSessionState();
+              // Same session, so calls, the last call end and the end of the session only move forward
+              if( (int)state[0] == (int)last[0] &&
+                  ((int)state[2] < (int)last[2] || (int)state[5] < (int)last[5] || ((bool)last[6] && !(bool)state[6])) ) {
+                  ++inconsistent;
+              }
+              last = state;
+              ++reads;
+          }
+      }
+  };
+
+  /**
+    * Faces, sounds and call ends raised at once from threads of their own during a session, delivered concurrently
+    * by the stand-in while the session state is read in a loop; the protocol may end the session in the middle of it
+    * Measures the time from raising each event to the return of the Logger callback, so an event of one kind
+    * waiting for another shows, and checks every state read; built with RTN_BENCH_TSAN the run is also checked
+    * by ThreadSanitizer
+    */
+  void race(Bench &bench, BenchReport &report) {
+      if( !startSession(bench) ) {
+          return;
+      }
+      bench.memory->deliveries(true);
+      volatile int stop = 0;
+      StateReader reader = { &bench, &stop, 0, 0 };
+      boost::thread readerThread(boost::ref(reader));
+      Raiser raisers[] = { { &bench, "FaceDetected", bench.options.faces },
+                           { &bench, "SoundClassified", bench.options.sounds },
+                           { &bench, "ChildCalledRTN", bench.options.calls } };
+      boost::thread_group threads;
+      for( int i = 0; i < 3; ++i ) {
+          threads.create_thread(raisers[i]);
+      }
+      threads.join_all();
+      bench.memory->waitUntilDelivered();
+      __sync_lock_test_and_set(&stop, 1);
+      readerThread.join();
+      if( (bool)bench.logger->getSessionState()[1] ) {
+          bench.memory->raiseEvent("EndSessionRTN", AL::ALValue(0));
+          bench.memory->waitUntilDelivered();
+      }
+
+      std::map<std::string, std::vector<double> > latencies;
+      std::vector<Delivery> deliveries = bench.memory->deliveries(true);
+      for( std::size_t i = 0; i < deliveries.size(); ++i ) {
+          if( deliveries[i].module == "ResponseToNameLogger" ) {
+              latencies[deliveries[i].event].push_back(microseconds(deliveries[i].returned - deliveries[i].raised));
+          }
+      }
+      for( std::map<std::string, std::vector<double> >::const_iterator it = latencies.begin(); it != latencies.end(); ++it ) {
+          report.add(it->first, it->second, "us");
+      }
+      report.add("stateReads", static_cast<double>(reader.reads));
+      report.add("inconsistentStateReads", static_cast<double>(reader.inconsistent));
+  }
+
+  /**
+    * Short protocol of the resume scenario, two calls by name and one with the phrase, 400 ms apart
+    */
+  const char *const ResumeProtocol =
+      "CS 1 0 400 400\n"
+      "CS 2 2 400 400\n"
+      "PS 1 2 400 400\n"
+      "SE -1 2 400 400\n";
+
+  bool fileExists(const std::string &path) {
+      struct stat info;
+      return ::stat(path.c_str(), &info) == 0;
+  }
+
+  bool writeFile(const std::string &path, const std::string &text, bool append) {
+      std::FILE *file = std::fopen(path.c_str(), append ? "a" : "w");
+      if( !file ) {
+          return false;
+      }
+      bool written = std::fwrite(text.data(), 1, text.size(), file) == text.size();
+      return std::fclose(file) == 0 && written;
+  }
+
+  /**
+    * One process of the resume scenario, killed at any point by the scenario and started again
+    * Resumes the session of the folder from its checkpoint, or starts it if it was never started,
+    * and runs it until it ends; the time the Logger took to resume is appended to resume.times
+    * Returns the exit status of the process, 0 once the session ended
+    */
+  int resumeChild(Bench &bench) {
+      const std::string &directory = bench.options.resumeChild;
+      bench.player->setClipLength(bench.options.clip);
+      bench.logger->setParameter("protocol", AL::ALValue(directory + "/protocol.txt"));
+      bench.logger->setParameter("checkpoint", AL::ALValue(directory + "/session.rtnc"));
+      bool resumed = (bool)bench.logger->getSessionState()[1];
+      if( !resumed ) {
+          // Session was started before and ended, or its end was logged and the resume only ended its log
+          if( fileExists(directory + "/started") ) {
+              return writeFile(directory + "/done", "", false) ? 0 : 1;
+          }
+          if( !startSession(bench) ) {
+              return 1;
+          }
+          writeFile(directory + "/started", "", false);
+      }
+      else {
+          AL::ALValue histograms = bench.logger->getLatencyHistograms(false);
+          for( int i = 0; i < static_cast<int>(histograms.getSize()); ++i ) {
+              if( (std::string)histograms[i][0] == "Setup.resume" && (int)histograms[i][1] > 0 ) {
+                  char line[32];
+                  std::snprintf(line, sizeof(line), "%.1f\n", (double)histograms[i][2]/(int)histograms[i][1]);
+                  writeFile(directory + "/resume.times", line, true);
+              }
+          }
+      }
+      long long deadline = monotonicTime() + 30000000000LL;
+      while( (bool)bench.logger->getSessionState()[1] && monotonicTime() < deadline ) {
+          boost::this_thread::sleep(boost::posix_time::milliseconds(10));
+      }
+      bench.memory->waitUntilDelivered();
+      if( (bool)bench.logger->getSessionState()[1] ) {
+          std::fprintf(stderr, "Resumed session did not end\n");
+          return 1;
+      }
+      return writeFile(directory + "/done", "", false) ? 0 : 1;
+  }
+
+  /**
+    * Session log checked against the protocol: calls are made in the order of the table, each one ends before
+    * the next one is made, call ends count up from 1 and the session ends once, after everything else
+    */
+  bool consistentSession(const std::vector<LogRecord> &records, const CallProtocol::Table &table) {
+      std::size_t calls = 0;
+      int ends = 0;
+      bool pending = false, ended = false;
+      for( std::size_t i = 0; i < records.size(); ++i ) {
+          const LogRecord &record = records[i];
+          bool call = record.event == LogCallStarted || record.event == LogPhraseStarted;
+          if( ended && (call || record.event == LogCallEnded || record.event == LogSessionEnded) ) {
+              return false;
+          }
+          if( call ) {
+              CallProtocol::Action action = record.event == LogCallStarted ? CallProtocol::CallByName : CallProtocol::CallWithPhrase;
+              if( pending || calls >= table.size() || table[calls].action != action || table[calls].value != record.value ) {
+                  return false;
+              }
+              ++calls;
+              pending = true;
+          }
+          else if( record.event == LogCallEnded ) {
+              if( !pending || record.value != ends + 1 ) {
+                  return false;
+              }
+              ++ends;
+              pending = false;
+          }
+          else if( record.event == LogSessionEnded ) {
+              if( pending ) {
+                  return false;
+              }
+              ended = true;
+          }
+      }
+      return ended;
+  }
+
+  /**
+    * Sessions run by processes of their own which are killed with SIGKILL at random points and started again,
+    * each one resuming the session from the checkpoint left by the one before
+    * Checks that every session ended once in the log with a call sequence the protocol could have made,
+    * and measures the time the Logger took to resume; sessions a process started and was killed before
+    * they were checkpointed are counted as abandoned
+    */
+  void resume(Bench &bench, BenchReport &report) {
+      std::string root = bench.options.logs + "/resume";
+      mkdir(root.c_str(), 0755);
+      CallProtocol::Table table;
+      std::string error;
+      std::srand(static_cast<unsigned int>(monotonicTime()));
+      int kills = 0, spawned = 0, inconsistent = 0, abandoned = 0, failed = 0;
+      std::vector<double> resumeTimes;
+      for( int run = 0; run < bench.options.calls; ++run ) {
+          char name[32];
+          std::snprintf(name, sizeof(name), "/%d", run);
+          std::string directory = root + name;
+          std::system(("rm -rf '" + directory + "'").c_str());
+          mkdir(directory.c_str(), 0755);
+          if( !writeFile(directory + "/protocol.txt", ResumeProtocol, false) ||
+              !CallProtocol::load(directory + "/protocol.txt", table, error) ) {
+              std::fprintf(stderr, "Protocol of the resume scenario can not be used %s\n", error.c_str());
+              return;
+          }
+          int killsLeft = bench.options.kills;
+          bool finished = false;
+          while( !finished ) {
+              char port[32], clip[32];
+              std::snprintf(port, sizeof(port), "--port=%d", bench.options.port + 1 + spawned%100);
+              std::snprintf(clip, sizeof(clip), "--clip=%d", 100);
+              std::string child = "--resume-child=" + directory, logs = "--logs=" + directory;
+              char *arguments[] = { const_cast<char *>(bench.program.c_str()), const_cast<char *>(child.c_str()),
+                                    const_cast<char *>(logs.c_str()), port, clip, 0 };
+              pid_t pid = fork();
+              if( pid == 0 ) {
+                  execv(arguments[0], arguments);
+                  _exit(127);
+              }
+              ++spawned;
+              // Killed at a random point of the session, or left to finish it
+              long long killAt = killsLeft > 0 ? monotonicTime() + (50 + std::rand()%1500)*1000000LL : -1;
+              long long giveUp = monotonicTime() + 60000000000LL;
+              int status = 0;
+              while( waitpid(pid, &status, WNOHANG) == 0 ) {
+                  long long now = monotonicTime();
+                  if( (killAt >= 0 && now >= killAt) || now >= giveUp ) {
+                      kill(pid, SIGKILL);
+                      waitpid(pid, &status, 0);
+                      break;
+                  }
+                  boost::this_thread::sleep(boost::posix_time::milliseconds(5));
+              }
+              if( WIFSIGNALED(status) ) {
+                  if( killAt < 0 ) {
+                      ++failed;
+                      finished = true;
+                  }
+                  ++kills;
+                  --killsLeft;
+              }
+              else {
+                  finished = true;
+                  if( WEXITSTATUS(status) != 0 ) {
+                      ++failed;
+                  }
+              }
+          }
+
+          std::vector<LogStorage::Session> sessions;
+          LogStorage::readIndex(directory, sessions);
+          int complete = 0;
+          for( std::size_t i = 0; i < sessions.size(); ++i ) {
+              char path[64];
+              std::snprintf(path, sizeof(path), "/%s#%lu", LogStorage::IndexName, sessions[i].id);
+              std::vector<LogRecord> records;
+              if( !sessions[i].complete ) {
+                  ++abandoned;
+              }
+              else if( ++complete > 1 || !readSessionLog(directory + path, records) || !consistentSession(records, table) ) {
+                  ++inconsistent;
+                  std::fprintf(stderr, "Session %lu of %s is not consistent\n", sessions[i].id, directory.c_str());
+              }
+          }
+          if( complete == 0 ) {
+              ++inconsistent;
+              std::fprintf(stderr, "Session of %s never ended\n", directory.c_str());
+          }
+          std::FILE *times = std::fopen((directory + "/resume.times").c_str(), "r");
+          double time;
+          while( times && std::fscanf(times, "%lf", &time) == 1 ) {
+              resumeTimes.push_back(time);
+          }
+          if( times ) {
+              std::fclose(times);
+          }
+      }
+      report.add("sessions", static_cast<double>(bench.options.calls));
+      report.add("processes", static_cast<double>(spawned));
+      report.add("kills", static_cast<double>(kills));
+      report.add("resumes", static_cast<double>(resumeTimes.size()));
+      report.add("inconsistentSessions", static_cast<double>(inconsistent));
+      report.add("abandonedSessions", static_cast<double>(abandoned));
+      report.add("failedProcesses", static_cast<double>(failed));
+      report.add("resumeLatency", resumeTimes, "us");
+  }
+
+  /**
+    * Writes a 16 kHz mono recording of ten seconds, a second each of articulated and non-articulated sounds
+    * Articulated ones are harmonics of 180 Hz shaped like speech and modulated four times a second like syllables,
+    * non-articulated ones a sustained low hum, every sound followed by 300 ms of quiet noise
+    */
+  bool writeSpeech(const std::string &path) {
+      const unsigned long rate = 16000;
+      unsigned long frames = rate*10;
+      unsigned long dataSize = frames*2;
+      unsigned char header[44] = { 'R', 'I', 'F', 'F', 0, 0, 0, 0, 'W', 'A', 'V', 'E',
+                                   'f', 'm', 't', ' ', 16, 0, 0, 0, 1, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                                   2, 0, 16, 0, 'd', 'a', 't', 'a', 0, 0, 0, 0 };
+      unsigned long fields[4][2] = { { 4, 36 + dataSize }, { 24, rate }, { 28, rate*2 }, { 40, dataSize } };
+      for( int i = 0; i < 4; ++i ) {
+          for( int b = 0; b < 4; ++b ) {
+              header[fields[i][0] + b] = static_cast<unsigned char>(fields[i][1] >> (8*b));
+          }
+      }
+      std::vector<unsigned char> data(dataSize);
+      std::srand(22);
+      for( unsigned long i = 0; i < frames; ++i ) {
+          double t = static_cast<double>(i)/rate;
+          int second = static_cast<int>(t);
+          double local = t - second;
+          double value = std::rand()%200 - 100;
+          if( local < 0.7 && second%2 == 0 ) {
+              double envelope = 0.5 - 0.5*std::cos(2*M_PI*4*local);
+              for( int k = 1; k <= 16; ++k ) {
+                  double frequency = 180.0*k;
+                  double gain = frequency > 500 && frequency < 3500 ? 1.0 : 0.2;
+                  value += envelope*6000*gain*std::sin(2*M_PI*frequency*t)/std::sqrt(static_cast<double>(k));
+              }
+          }
+          else if( local < 0.7 ) {
+              double envelope = std::min(1.0, local/0.02);
+              value += envelope*16000*(std::sin(2*M_PI*220*t) + 0.4*std::sin(2*M_PI*440*t));
+          }
+          short sample = static_cast<short>(std::max(-32768.0, std::min(32767.0, value)));
+          data[2*i] = static_cast<unsigned char>(sample & 0xFF);
+          data[2*i + 1] = static_cast<unsigned char>((sample >> 8) & 0xFF);
+      }
+      std::FILE *out = std::fopen(path.c_str(), "wb");
+      if( !out ) {
+          std::perror(path.c_str());
+          return false;
+      }
+      bool written = std::fwrite(header, 1, sizeof(header), out) == sizeof(header) &&
+                     std::fwrite(&data[0], 1, data.size(), out) == data.size();
+      return std::fclose(out) == 0 && written;
+  }
+
+  /**
+    * Sounds the front end decides over the recording, fed in buffers as ALAudioDevice delivers them
+    */
+  std::vector<AudioFrontEnd::Sound> classify(AudioFrontEnd &frontEnd, const std::vector<short> &samples) {
+      std::vector<AudioFrontEnd::Sound> sounds;
+      frontEnd.reset();
+      int sampleRate = frontEnd.parameters().sampleRate;
+      for( std::size_t first = 0; first + AudioDeviceStandIn::BufferLength <= samples.size(); first += AudioDeviceStandIn::BufferLength ) {
+          long long time = static_cast<long long>(first)*1000000000LL/sampleRate;
+          frontEnd.process(&samples[first], 1, AudioDeviceStandIn::BufferLength, time, sounds);
+      }
+      return sounds;
+  }
+
+  /**
+    * Sound classification in the Logger, throughput of the scalar and vector kernels of the front end over the recording
+    * and a session classifying the recording played in real time by the ALAudioDevice stand-in:
+    * time each buffer takes the Logger, CPU it uses and the sounds it logs against the ones decided offline
+    */
+  void audio(Bench &bench, BenchReport &report) {
+      std::string directory = bench.options.logs + "/sounds";
+      mkdir(directory.c_str(), 0755);
+      std::string recording = bench.options.wav;
+      if( recording.empty() ) {
+          recording = directory + "/speech.wav";
+          if( !writeSpeech(recording) ) {
+              return;
+          }
+      }
+      std::vector<short> samples;
+      int sampleRate;
+      std::string error;
+      if( !AudioDeviceStandIn::readRecording(recording, samples, sampleRate, error) ) {
+          std::fprintf(stderr, "Recording %s can not be used, %s\n", recording.c_str(), error.c_str());
+          return;
+      }
+
+      // Recording is classified again and again for at least a second of CPU with each kind of kernels
+      const char *names[] = { "scalar", "vector" };
+      std::vector<AudioFrontEnd::Sound> decided[2];
+      double framesPerSecond[2];
+      for( int kernels = 0; kernels < 2; ++kernels ) {
+          AudioFrontEnd::Parameters parameters;
+          parameters.sampleRate = sampleRate;
+          parameters.kernels = kernels == 0 ? AudioFrontEnd::Scalar : AudioFrontEnd::Vector;
+          AudioFrontEnd frontEnd(parameters);
+          long long cpu = threadCpuTime();
+          decided[kernels] = classify(frontEnd, samples);
+          while( threadCpuTime() - cpu < 1000000000LL ) {
+              classify(frontEnd, samples);
+          }
+          cpu = threadCpuTime() - cpu;
+          framesPerSecond[kernels] = frontEnd.framesAnalysed()*1e9/cpu;
+          report.add(std::string(names[kernels]) + "FramesPerSecond", framesPerSecond[kernels]);
+      }
+      int differ = decided[0].size() == decided[1].size() ? 0 : 1;
+      int articulated = 0;
+      for( std::size_t i = 0; i < decided[1].size(); ++i ) {
+          if( i < decided[0].size() && (decided[0][i].soundClass != decided[1][i].soundClass || decided[0][i].time != decided[1][i].time) ) {
+              ++differ;
+          }
+          articulated += decided[1][i].soundClass;
+      }
+      report.add("vectorised", AudioFrontEnd::vectorised() ? 1.0 : 0.0);
+      report.add("vectorSpeedup", framesPerSecond[1]/framesPerSecond[0]);
+      report.add("recordingSeconds", static_cast<double>(samples.size())/sampleRate);
+      report.add("sounds", static_cast<double>(decided[1].size()));
+      report.add("articulatedSounds", static_cast<double>(articulated));
+      report.add("kernelDecisionsDiffer", static_cast<double>(differ));
+
+      // Session makes no call before the recording ends, the benchmark ends it
+      std::string protocol = directory + "/audio-protocol.txt";
+      if( !writeFile(protocol, "SE -1 0 600000 600000\n", false) ) {
+          return;
+      }
+      bench.logger->setParameter("protocol", AL::ALValue(protocol));
+      bench.logger->setParameter("classifier", AL::ALValue("internal"));
+      unsigned long ended = bench.memory->raised("EndSessionRTN");
+      if( !startSession(bench) || !bench.audio->waitForSubscriber("ResponseToNameLogger", 5000) ) {
+          std::fprintf(stderr, "Logger did not subscribe to ALAudioDevice\n");
+          return;
+      }
+      long long cpu = processCpuTime();
+      long long start = monotonicTime();
+      std::vector<long long> durations = bench.audio->play(samples, sampleRate, true);
+      long long elapsed = monotonicTime() - start;
+      cpu = processCpuTime() - cpu;
+      bench.memory->raiseEvent("EndSessionRTN", AL::ALValue(0));
+      bench.memory->waitForEvent("EndSessionRTN", ended + 1, 5000);
+      bench.memory->waitUntilDelivered();
+      bench.logger->setParameter("classifier", AL::ALValue("external"));
+      bench.logger->setParameter("protocol", AL::ALValue("study"));
+
+      std::vector<double> latency;
+      for( std::size_t i = 0; i < durations.size(); ++i ) {
+          latency.push_back(microseconds(durations[i]));
+      }
+      std::vector<SessionLogLocation> logs = locateSessionLogs(bench.options.logs);
+      std::vector<LogRecord> records;
+      if( logs.empty() || !readSessionLog(logs.back(), records) ) {
+          std::fprintf(stderr, "Session log can not be read\n");
+          return;
+      }
+      std::vector<int> logged;
+      for( std::size_t i = 0; i < records.size(); ++i ) {
+          if( records[i].event == LogSoundClassified ) {
+              logged.push_back(records[i].value);
+          }
+      }
+      int mismatched = logged.size() == decided[1].size() ? 0 : 1;
+      for( std::size_t i = 0; i < logged.size() && i < decided[1].size(); ++i ) {
+          if( logged[i] != decided[1][i].soundClass ) {
+              ++mismatched;
+          }
+      }
+      report.add("buffers", static_cast<double>(durations.size()));
+      report.add("processRemote", latency, "us");
+      report.add("loggedSounds", static_cast<double>(logged.size()));
+      report.add("loggedSoundsDiffer", static_cast<double>(mismatched));
+      report.add("cpuMsPerMinute", cpu/1e6*60e9/elapsed);
+  }
+
+  /**
+    * Session with a slow sound classifier, calls 300 ms apart and short clips
+    * Time from each decision to CallChildRTN and from each ChildCalledRTN to the return of the Logger callback,
+    * neither of which may wait for the classifier, and the starts and stops the classifier received
+    */
+  void classifier(Bench &bench, BenchReport &report) {
+      std::string protocol = bench.options.logs + "/classifier-protocol.txt";
+      if( !writeFile(protocol, "CS 1 0 300 300\nCS 2 0 300 300\nPS 1 0 300 300\nSE -1 0 300 300\n", false) ) {
+          return;
+      }
+      bench.logger->setParameter("protocol", AL::ALValue(protocol));
+      bench.classifier->setDelay(bench.options.classifierDelay);
+      bench.classifier->starts(true);
+      bench.classifier->stops(true);
+      bench.player->setClipLength(10);
+      bench.memory->deliveries(true);
+      std::size_t callsBefore = bench.memory->raiseTimes("CallChildRTN").size();
+      unsigned long ended = bench.memory->raised("EndSessionRTN");
+      if( !startSession(bench) ) {
+          return;
+      }
+      if( !bench.memory->waitForEvent("EndSessionRTN", ended + 1, 30000) ) {
+          std::fprintf(stderr, "Session did not end\n");
+          return;
+      }
+      bench.memory->waitUntilDelivered();
+      // Commands left queued by the end of the session are carried out at the pace of the classifier
+      long long settle = monotonicTime() + 10000000000LL;
+      while( bench.classifier->running() && monotonicTime() < settle ) {
+          boost::this_thread::sleep(boost::posix_time::milliseconds(10));
+      }
+      bench.logger->setParameter("protocol", AL::ALValue("study"));
+      bench.classifier->setDelay(0);
+
+      std::vector<long long> raised = bench.memory->raiseTimes("CallChildRTN");
+      std::vector<long long> decided = bench.memory->eventTimes("CallChildRTN");
+      std::vector<double> toCall;
+      for( std::size_t i = callsBefore; i < raised.size() && i < decided.size(); ++i ) {
+          toCall.push_back(microseconds(raised[i] - decided[i]));
+      }
+      std::vector<double> childCalled;
+      std::vector<Delivery> deliveries = bench.memory->deliveries(true);
+      for( std::size_t i = 0; i < deliveries.size(); ++i ) {
+          if( deliveries[i].module == "ResponseToNameLogger" && deliveries[i].event == "ChildCalledRTN" ) {
+              childCalled.push_back(microseconds(deliveries[i].returned - deliveries[i].raised));
+          }
+      }
+      report.add("classifierDelayMs", static_cast<double>(bench.options.classifierDelay));
+      report.add("decisionToCallChild", toCall, "us");
+      report.add("childCalledCallbackReturn", childCalled, "us");
+      report.add("classifierStarts", static_cast<double>(bench.classifier->starts()));
+      report.add("classifierStops", static_cast<double>(bench.classifier->stops()));
+      report.add("classifierRunningAfterSession", bench.classifier->running() ? 1.0 : 0.0);
+  }
+
+  /**
+    * Session with faces at 30 Hz and sounds at 10 Hz while the Logger publishes its metrics
+    * Measures how often the metrics are published, how long after a sound the published count includes it,
+    * and compares the metrics published last and the summary record with the metrics computed from the log
+    */
+  void metrics(Bench &bench, BenchReport &report) {
+      unsigned long ended = bench.memory->raised("EndSessionRTN");
+      unsigned long inserts = bench.memory->listInserts();
+      if( !startSession(bench) ) {
+          return;
+      }
+      long long start = monotonicTime();
+      std::vector<double> visible;
+      int sounds = 0;
+      for( int frame = 0; frame < bench.options.faces; ++frame ) {
+          bench.memory->raiseEvent("FaceDetected", faceValue(frame));
+          if( frame%3 == 0 && sounds < bench.options.sounds ) {
+              long long raised = monotonicTime();
+              bench.memory->raiseEvent("SoundClassified", soundValue(sounds++));
+              // Published count is polled until the next frame is due
+              while( monotonicTime() < raised + 33000000LL ) {
+                  AL::ALValue published = bench.memory->getData("ResponseToName/Sounds");
+                  if( published.isValid() && (int)published >= sounds ) {
+                      visible.push_back(microseconds(monotonicTime() - raised));
+                      break;
+                  }
+                  boost::this_thread::sleep(boost::posix_time::milliseconds(1));
+              }
+          }
+          long long next = start + (frame + 1)*33333333LL;
+          long long now = monotonicTime();
+          if( next > now ) {
+              boost::this_thread::sleep(boost::posix_time::microseconds((next - now)/1000));
+          }
+      }
+      long long elapsed = monotonicTime() - start;
+      inserts = bench.memory->listInserts() - inserts;
+      bench.memory->raiseEvent("EndSessionRTN", AL::ALValue(0));
+      bench.memory->waitForEvent("EndSessionRTN", ended + 1, 5000);
+      bench.memory->waitUntilDelivered();
+
+      std::vector<SessionLogLocation> logs = locateSessionLogs(bench.options.logs);
+      std::vector<LogRecord> records;
+      if( logs.empty() || !readSessionLog(logs.back(), records) ) {
+          std::fprintf(stderr, "Session log can not be read\n");
+          return;
+      }
+      std::vector<LogRecord> session;
+      const LogRecord *summary = 0;
+      for( std::size_t i = 0; i < records.size(); ++i ) {
+          if( records[i].event == LogSummary ) {
+              summary = &records[i];
+          }
+          else {
+              session.push_back(records[i]);
+          }
+      }
+      LogRecord computed = sessionMetrics(session).toLogRecord(0);
+      bool summaryMatches = summary && summary->value == computed.value && summary->featureCount == computed.featureCount &&
+                            std::equal(computed.features, computed.features + computed.featureCount, summary->features);
+      bool publishedMatches = (int)bench.memory->getData("ResponseToName/Sounds") == sessionMetrics(session).sounds &&
+                              (int)bench.memory->getData("ResponseToName/Active") == 0;
+
+      report.add("publishes", static_cast<double>(inserts));
+      report.add("publishesPerSecond", inserts*1e9/elapsed);
+      report.add("soundToPublished", visible, "us");
+      report.add("soundsNotSeen", static_cast<double>(sounds - static_cast<int>(visible.size())));
+      report.add("summaryMatchesLog", summaryMatches ? 1.0 : 0.0);
+      report.add("publishedMatchesLog", publishedMatches ? 1.0 : 0.0);
+  }
+
+  /**
+    * Protocol of the stress and soak scenarios, calls 400 ms apart which no number of faces answers,
+    * so calls keep playing while faces and sounds arrive
+    */
+  const char *const StressProtocol =
+      "CS 1 0 400 400\n"
+      "CS 2 1000000 400 400\n"
+      "PS 1 1000000 400 400\n"
+      "SE -1 1000000 400 400\n";
+
+  /**
+    * Events raised within this many nanoseconds of the start or the end of a session may fall either side of it
+    */
+  const long long SessionMargin = 100000000LL;
+
+  /**
+    * Raises FaceDetected and SoundClassified at fixed rates from threads of their own until stopped
+    * Each sound carries its number as its first feature, so the record logged for it is found again
+    * An event due more than a period ago when raised is late, the stand-in and the modules did not keep up
+    */
+  struct EventLoad {
+      Bench *bench;
+      volatile int stop;
+      boost::mutex mutex;
+      std::vector<long long> faces;
+      /**
+        * Time each sound was raised, the first one is sound firstSound
+        */
+      std::vector<long long> sounds;
+      int firstSound;
+      long late;
+
+      explicit EventLoad(Bench *loaded) : bench(loaded), stop(0), firstSound(0), late(0) {
+      }
+
+      void raise(bool face, int rate) {
+          if( rate <= 0 ) {
+              return;
+          }
+          long long period = 1000000000LL/rate;
+          long long due = monotonicTime();
+          for( int i = 0; !stop; ++i, due += period ) {
+              long long now = monotonicTime();
+              if( due > now ) {
+                  boost::this_thread::sleep(boost::posix_time::microseconds((due - now)/1000));
+              }
+              else if( now - due > period ) {
+                  boost::mutex::scoped_lock lock(mutex);
+                  ++late;
+              }
+              if( face ) {
+                  long long raised = monotonicTime();
+                  bench->memory->raiseEvent("FaceDetected", faceValue(i));
+                  boost::mutex::scoped_lock lock(mutex);
+                  faces.push_back(raised);
+              }
+              else {
+                  // Time is kept before the sound is raised, the Logger may log it at once
+                  int sound;
+                  {
+                      boost::mutex::scoped_lock lock(mutex);
+                      sound = firstSound + static_cast<int>(sounds.size());
+                      sounds.push_back(monotonicTime());
+                  }
+                  bench->memory->raiseEvent("SoundClassified", soundValue(sound));
+              }
+          }
+      }
+
+      /**
+        * Forgets the events raised so far, sounds keep their numbers
+        */
+      void forget() {
+          boost::mutex::scoped_lock lock(mutex);
+          faces.clear();
+          firstSound += static_cast<int>(sounds.size());
+          sounds.clear();
+      }
+  };
+
+  /**
+    * Events of the load checked against the logs of the sessions
+    */
+  struct LoadCheck {
+      LoadCheck() : sessions(0), unmatched(0), soundsExpected(0), soundsDropped(0), soundsDuplicated(0),
+                    soundsOutside(0), soundsLate(0), facesRaised(0), facesLogged(0), facesDropped(0), calls(0) {
+      }
+      long sessions;
+      long unmatched;          // sessions started without a log, or logs without a start
+      long soundsExpected;     // sounds raised within a session, away from its start and end
+      long soundsDropped;
+      long soundsDuplicated;
+      long soundsOutside;      // sounds logged which were raised outside the session
+      long soundsLate;
+      std::vector<double> soundToLog;
+      long facesRaised;
+      long facesLogged;
+      long facesDropped;
+      long calls;
+  };
+
+  /**
+    * Waits until the Logger has no session and the given number of sessions of the log directory ended
+    */
+  std::vector<SessionLogLocation> waitForLogs(Bench &bench, std::size_t count) {
+      long long deadline = monotonicTime() + 10000000000LL;
+      std::vector<SessionLogLocation> logs = locateSessionLogs(bench.options.logs);
+      while( (logs.size() < count || (bool)bench.logger->getSessionState()[1]) && monotonicTime() < deadline ) {
+          boost::this_thread::sleep(boost::posix_time::milliseconds(20));
+          logs = locateSessionLogs(bench.options.logs);
+      }
+      return logs;
+  }
+
+  /**
+    * Checks the sessions started since the counts were taken against the events the load raised
+    * Every sound raised within a session, away from its start and end, is logged once in its log, late if it took
+    * longer than --late; faces are counted, the Logger drops a face arriving while it still handles the last one
+    */
+  void checkLoad(Bench &bench, EventLoad &load, std::size_t startsBefore, std::size_t endsBefore, std::size_t logsBefore,
+                 LoadCheck &check) {
+      std::vector<long long> starts = bench.memory->eventTimes("StartSessionRTN");
+      starts.erase(starts.begin(), starts.begin() + std::min(startsBefore, starts.size()));
+      std::vector<long long> ends = bench.memory->raiseTimes("EndSessionRTN");
+      ends.erase(ends.begin(), ends.begin() + std::min(endsBefore, ends.size()));
+      std::sort(ends.begin(), ends.end());
+      std::vector<SessionLogLocation> logs = waitForLogs(bench, logsBefore + starts.size());
+      std::size_t sessions = logs.size() - std::min(logsBefore, logs.size());
+      check.unmatched += std::labs(static_cast<long>(sessions) - static_cast<long>(starts.size()));
+
+      // Load may still be raising, it is not held up while the logs are read
+      std::vector<long long> sounds, faces;
+      int firstSound;
+      {
+          boost::mutex::scoped_lock lock(load.mutex);
+          sounds = load.sounds;
+          faces = load.faces;
+          firstSound = load.firstSound;
+      }
+      long long late = bench.options.late*1000000LL;
+      for( std::size_t k = 0; k < sessions && k < starts.size(); ++k ) {
+          std::vector<LogRecord> records;
+          if( !readSessionLog(logs[logsBefore + k], records) ) {
+              ++check.unmatched;
+              continue;
+          }
+          long long start = starts[k];
+          std::vector<long long>::const_iterator after = std::lower_bound(ends.begin(), ends.end(), start);
+          long long end = after == ends.end() ? monotonicTime() : *after;
+          ++check.sessions;
+
+          std::vector<int> logged(sounds.size(), 0);
+          long loggedFaces = 0;
+          for( std::size_t i = 0; i < records.size(); ++i ) {
+              const LogRecord &record = records[i];
+              long long time = start + record.timestamp*1000;
+              bool inner = time >= start + SessionMargin && time <= end - SessionMargin;
+              if( record.event == LogSoundFeatures && record.featureCount > 0 ) {
+                  int sound = static_cast<int>(std::floor(record.features[0]*10 + 0.5f)) - firstSound;
+                  if( sound < 0 || sound >= static_cast<int>(sounds.size()) ) {
+                      continue;
+                  }
+                  long long raised = sounds[sound];
+                  if( raised < start - SessionMargin || raised > end + SessionMargin ) {
+                      ++check.soundsOutside;
+                  }
+                  if( ++logged[sound] == 2 ) {
+                      ++check.soundsDuplicated;
+                  }
+                  check.soundToLog.push_back(microseconds(time - raised));
+                  if( time - raised > late ) {
+                      ++check.soundsLate;
+                  }
+              }
+              else if( record.event == LogFaceDetected && inner ) {
+                  ++loggedFaces;
+              }
+              else if( record.event == LogFaceInterval && inner ) {
+                  loggedFaces += record.value;
+              }
+              else if( record.event == LogCallStarted || record.event == LogPhraseStarted ) {
+                  ++check.calls;
+              }
+          }
+          for( std::size_t i = 0; i < sounds.size(); ++i ) {
+              if( sounds[i] >= start + SessionMargin && sounds[i] <= end - SessionMargin ) {
+                  ++check.soundsExpected;
+                  if( !logged[i] ) {
+                      ++check.soundsDropped;
+                  }
+              }
+          }
+          long raisedFaces = 0;
+          for( std::size_t i = 0; i < faces.size(); ++i ) {
+              if( faces[i] >= start + SessionMargin && faces[i] <= end - SessionMargin ) {
+                  ++raisedFaces;
+              }
+          }
+          check.facesRaised += raisedFaces;
+          check.facesLogged += loggedFaces;
+          check.facesDropped += std::max(0L, raisedFaces - loggedFaces);
+      }
+  }
+
+  void reportLoad(const LoadCheck &check, const EventLoad &load, long long elapsed, BenchReport &report) {
+      report.add("sessions", static_cast<double>(check.sessions));
+      report.add("unmatchedSessions", static_cast<double>(check.unmatched));
+      report.add("calls", static_cast<double>(check.calls));
+      report.add("soundsExpected", static_cast<double>(check.soundsExpected));
+      report.add("soundsDropped", static_cast<double>(check.soundsDropped));
+      report.add("soundsDuplicated", static_cast<double>(check.soundsDuplicated));
+      report.add("soundsOutsideSession", static_cast<double>(check.soundsOutside));
+      report.add("soundsLate", static_cast<double>(check.soundsLate));
+      report.add("soundToLog", check.soundToLog, "us");
+      report.add("facesRaised", static_cast<double>(check.facesRaised));
+      report.add("facesLogged", static_cast<double>(check.facesLogged));
+      report.add("facesDropped", static_cast<double>(check.facesDropped));
+      report.add("lateRaises", static_cast<double>(load.late));
+      report.add("seconds", elapsed/1e9);
+  }
+
+  /**
+    * Random touches, starts and ends of sessions for --stress seconds while faces and sounds are raised at
+    * --face-rate and --sound-rate, with calls played by a protocol no face answers
+    * Checks every session against the events raised during it, and the threads and memory of the process
+    * once the modules are idle again against before
+    */
+  void stress(Bench &bench, BenchReport &report) {
+      std::string protocol = bench.options.logs + "/stress-protocol.txt";
+      if( !writeFile(protocol, StressProtocol, false) ) {
+          std::fprintf(stderr, "Protocol of the stress scenario can not be written\n");
+          return;
+      }
+      bench.logger->setParameter("protocol", AL::ALValue(protocol));
+      bench.player->setClipLength(bench.options.clip);
+      long threads = processThreads();
+      long resident = processResidentKb();
+      std::size_t startsBefore = bench.memory->raiseTimes("StartSessionRTN").size();
+      std::size_t endsBefore = bench.memory->raiseTimes("EndSessionRTN").size();
+      std::size_t logsBefore = locateSessionLogs(bench.options.logs).size();
+
+      EventLoad load(&bench);
+      boost::thread_group raisers;
+      raisers.create_thread(boost::bind(&EventLoad::raise, &load, true, bench.options.faceRate));
+      raisers.create_thread(boost::bind(&EventLoad::raise, &load, false, bench.options.soundRate));
+      unsigned int seed = bench.options.seed;
+      long actions[6] = { 0, 0, 0, 0, 0, 0 };
+      long long start = monotonicTime();
+      long long deadline = start + bench.options.stress*1000000000LL;
+      while( monotonicTime() < deadline ) {
+          int action = rand_r(&seed)%6;
+          ++actions[action];
+          if( action == 0 || action == 1 ) {
+              // Touch as the robot is used, the second touch of a session is ignored
+              bench.interface->startTask("enable");
+              bench.memory->raiseEvent("FrontTactilTouched", AL::ALValue(1.0f));
+          }
+          else if( action == 2 ) {
+              // Touch while the Interface does not listen to the sensor
+              bench.memory->raiseEvent("FrontTactilTouched", AL::ALValue(1.0f));
+          }
+          else if( action == 3 ) {
+              bench.interface->startTask("start");
+          }
+          else if( action == 4 ) {
+              bench.memory->raiseEvent("EndSessionRTN", timedEventValue(rand_r(&seed)%2, monotonicTime()));
+          }
+          boost::this_thread::sleep(boost::posix_time::milliseconds(rand_r(&seed)%1500));
+      }
+      if( (bool)bench.logger->getSessionState()[1] ) {
+          bench.memory->raiseEvent("EndSessionRTN", timedEventValue(0, monotonicTime()));
+      }
+      __sync_lock_test_and_set(&load.stop, 1);
+      raisers.join_all();
+      long long elapsed = monotonicTime() - start;
+      bench.memory->waitUntilDelivered();
+      // Bravo and the last classifier commands are done before the modules count as idle
+      boost::this_thread::sleep(boost::posix_time::milliseconds(bench.options.clip + 500));
+      bench.memory->deliveries(true);
+
+      LoadCheck check;
+      checkLoad(bench, load, startsBefore, endsBefore, logsBefore, check);
+      bench.logger->setParameter("protocol", AL::ALValue("study"));
+      reportLoad(check, load, elapsed, report);
+      report.add("touches", static_cast<double>(actions[0] + actions[1] + actions[2]));
+      report.add("starts", static_cast<double>(actions[3]));
+      report.add("ends", static_cast<double>(actions[4]));
+      report.add("threadGrowth", static_cast<double>(processThreads() - threads));
+      report.add("residentKbGrowth", static_cast<double>(processResidentKb() - resident));
+  }
+
+  /**
+    * Sessions one after another for --soak seconds with faces and sounds raised at --face-rate and --sound-rate,
+    * each ended by the protocol or at a random time; checks each session as it ends and samples the threads
+    * and resident memory of the process between sessions, once the modules are idle
+    * Stand-in and load forget the events of every checked session, so only the modules could grow
+    */
+  void soak(Bench &bench, BenchReport &report) {
+      std::string protocol = bench.options.logs + "/stress-protocol.txt";
+      if( !writeFile(protocol, StressProtocol, false) ) {
+          std::fprintf(stderr, "Protocol of the soak scenario can not be written\n");
+          return;
+      }
+      bench.logger->setParameter("protocol", AL::ALValue(protocol));
+      bench.player->setClipLength(bench.options.clip);
+      // Whole protocol, four calls and their clips, and some time to end
+      unsigned int sessionMs = 4*(400 + bench.options.clip) + 2000;
+
+      EventLoad load(&bench);
+      boost::thread_group raisers;
+      raisers.create_thread(boost::bind(&EventLoad::raise, &load, true, bench.options.faceRate));
+      raisers.create_thread(boost::bind(&EventLoad::raise, &load, false, bench.options.soundRate));
+      unsigned int seed = bench.options.seed;
+      LoadCheck check;
+      std::vector<double> threads, resident, sampled;
+      long long start = monotonicTime();
+      long long deadline = start + bench.options.soak*1000000000LL;
+      while( monotonicTime() < deadline ) {
+          std::size_t startsBefore = bench.memory->raiseTimes("StartSessionRTN").size();
+          std::size_t endsBefore = bench.memory->raiseTimes("EndSessionRTN").size();
+          std::size_t logsBefore = locateSessionLogs(bench.options.logs).size();
+          if( !startSession(bench) ) {
+              break;
+          }
+          // One session in three is ended by the robot operator before the protocol ends it
+          if( rand_r(&seed)%3 == 0 ) {
+              boost::this_thread::sleep(boost::posix_time::milliseconds(rand_r(&seed)%sessionMs));
+              bench.memory->raiseEvent("EndSessionRTN", timedEventValue(1, monotonicTime()));
+          }
+          if( !bench.memory->waitForEvent("EndSessionRTN", endsBefore + 1, sessionMs + 10000) ) {
+              std::fprintf(stderr, "Session did not end\n");
+              break;
+          }
+          bench.memory->waitUntilDelivered();
+          checkLoad(bench, load, startsBefore, endsBefore, logsBefore, check);
+          load.forget();
+          bench.memory->forget("FaceDetected");
+          bench.memory->forget("SoundClassified");
+          bench.memory->deliveries(true);
+          boost::this_thread::sleep(boost::posix_time::milliseconds(bench.options.clip + 500));
+          threads.push_back(static_cast<double>(processThreads()));
+          resident.push_back(static_cast<double>(processResidentKb()));
+          sampled.push_back((monotonicTime() - start)/1e9);
+      }
+      __sync_lock_test_and_set(&load.stop, 1);
+      raisers.join_all();
+      long long elapsed = monotonicTime() - start;
+      bench.memory->waitUntilDelivered();
+      bench.logger->setParameter("protocol", AL::ALValue("study"));
+
+      reportLoad(check, load, elapsed, report);
+      if( threads.empty() ) {
+          return;
+      }
+      // Growth is measured from the first idle sample, by which the thread pools and caches are warmed up
+      double slope = 0;
+      if( sampled.size() > 1 && sampled.back() > sampled.front() ) {
+          slope = (resident.back() - resident.front())/(sampled.back() - sampled.front())*3600;
+      }
+      report.add("idleThreads", threads, "threads");
+      report.add("threadGrowth", threads.back() - threads.front());
+      report.add("residentKb", resident, "kB");
+      report.add("residentKbGrowth", resident.back() - resident.front());
+      report.add("residentKbPerHour", slope);
+  }
+
+  /**
+    * Sessions with faces and sounds raised at rising rates, from --face-rate and --sound-rate doubling each step,
+    * until sounds are dropped or late, or the raisers fall behind; the highest rates passed are the limit
+    */
+  void throughput(Bench &bench, BenchReport &report) {
+      int faceRate = std::max(1, bench.options.faceRate);
+      int soundRate = std::max(1, bench.options.soundRate);
+      int passedFaces = 0, passedSounds = 0;
+      for( int step = 0; step < 8; ++step, faceRate *= 2, soundRate *= 2 ) {
+          std::size_t startsBefore = bench.memory->raiseTimes("StartSessionRTN").size();
+          std::size_t endsBefore = bench.memory->raiseTimes("EndSessionRTN").size();
+          std::size_t logsBefore = locateSessionLogs(bench.options.logs).size();
+          if( !startSession(bench) ) {
+              break;
+          }
+          EventLoad load(&bench);
+          boost::thread_group raisers;
+          raisers.create_thread(boost::bind(&EventLoad::raise, &load, true, faceRate));
+          raisers.create_thread(boost::bind(&EventLoad::raise, &load, false, soundRate));
+          boost::this_thread::sleep(boost::posix_time::seconds(2));
+          __sync_lock_test_and_set(&load.stop, 1);
+          raisers.join_all();
+          bench.memory->raiseEvent("EndSessionRTN", timedEventValue(0, monotonicTime()));
+          bench.memory->waitUntilDelivered();
+          LoadCheck check;
+          checkLoad(bench, load, startsBefore, endsBefore, logsBefore, check);
+          bench.memory->forget("FaceDetected");
+          bench.memory->forget("SoundClassified");
+          bench.memory->deliveries(true);
+
+          char name[64];
+          std::snprintf(name, sizeof(name), "soundToLogAt%dHz", soundRate);
+          report.add(name, check.soundToLog, "us");
+          std::snprintf(name, sizeof(name), "facesDroppedAt%dHz", faceRate);
+          report.add(name, static_cast<double>(check.facesDropped));
+          bool passed = check.sessions == 1 && check.soundsDropped == 0 && check.soundsLate == 0 &&
+                        load.late*100 <= static_cast<long>(load.faces.size() + load.sounds.size());
+          if( !passed ) {
+              break;
+          }
+          passedFaces = faceRate;
+          passedSounds = soundRate;
+      }
+      report.add("maxFaceRate", static_cast<double>(passedFaces));
+      report.add("maxSoundRate", static_cast<double>(passedSounds));
+  }
+
+  const Scenario scenarios[] = {
+      { "startup", startup },
+      { "callbacks", callbacks },
+      { "subscriptions", subscriptions },
+      { "calls", calls },
+      { "playback", playback },
+      { "cancel", cancel },
+      { "idle", idle },
+      { "transport", transport },
+      { "race", race },
+      { "resume", resume },
+      { "audio", audio },
+      { "classifier", classifier },
+      { "metrics", metrics },
+      { "stress", stress },
+      { "soak", soak },
+      { "throughput", throughput }
+  };
+
+  bool selected(const Options &options, const char *name) {
+      if( options.scenarios.empty() ) {
+          return true;
+      }
+      std::string list = "," + options.scenarios + ",";
+      return list.find("," + std::string(name) + ",") != std::string::npos;
+  }
+
+  /**
+    * Value of --name=value, 0 if the argument is another option
+    */
+  const char *option(const char *argument, const char *name) {
+      std::size_t length = std::strlen(name);
+      if( std::strncmp(argument, name, length) == 0 && argument[length] == '=' ) {
+          return argument + length + 1;
+      }
+      return 0;
+  }
+}
+
+int main(int argc, char *argv[]) {
+    Bench bench;
+    bench.program = argv[0];
+    Options &options = bench.options;
+    options.faces = 300;
+    options.sounds = 100;
+    options.calls = 20;
+    options.clip = 1500;
+    options.idle = 60;
+    options.events = 2000;
+    options.kills = 3;
+    options.logs = "/tmp";
+    options.port = 9600;
+    options.classifierDelay = 200;
+    options.faceRate = 30;
+    options.soundRate = 10;
+    options.stress = 30;
+    options.soak = 120;
+    options.late = 100;
+    options.seed = 1;
+
+    for( int i = 1; i < argc; ++i ) {
+        const char *value;
+        if( (value = option(argv[i], "--scenario")) ) options.scenarios = value;
+        else if( (value = option(argv[i], "--label")) ) options.label = value;
+        else if( (value = option(argv[i], "--faces")) ) options.faces = std::atoi(value);
+        else if( (value = option(argv[i], "--sounds")) ) options.sounds = std::atoi(value);
+        else if( (value = option(argv[i], "--calls")) ) options.calls = std::atoi(value);
+        else if( (value = option(argv[i], "--clip")) ) options.clip = std::atoi(value);
+        else if( (value = option(argv[i], "--idle")) ) options.idle = std::atoi(value);
+        else if( (value = option(argv[i], "--events")) ) options.events = std::atoi(value);
+        else if( (value = option(argv[i], "--kills")) ) options.kills = std::atoi(value);
+        else if( (value = option(argv[i], "--logs")) ) options.logs = value;
+        else if( (value = option(argv[i], "--port")) ) options.port = std::atoi(value);
+        else if( (value = option(argv[i], "--out")) ) options.out = value;
+        else if( (value = option(argv[i], "--resume-child")) ) options.resumeChild = value;
+        else if( (value = option(argv[i], "--wav")) ) options.wav = value;
+        else if( (value = option(argv[i], "--classifier-delay")) ) options.classifierDelay = std::atoi(value);
+        else if( (value = option(argv[i], "--face-rate")) ) options.faceRate = std::atoi(value);
+        else if( (value = option(argv[i], "--sound-rate")) ) options.soundRate = std::atoi(value);
+        else if( (value = option(argv[i], "--stress")) ) options.stress = std::atoi(value);
+        else if( (value = option(argv[i], "--soak")) ) options.soak = std::atoi(value);
+        else if( (value = option(argv[i], "--late")) ) options.late = std::atoi(value);
+        else if( (value = option(argv[i], "--seed")) ) options.seed = std::atoi(value);
+        else {
+            std::fprintf(stderr, "Usage: %s [--scenario=a,b] [--label=text] [--faces=n] [--sounds=n] [--calls=n]"
+                                 " [--clip=ms] [--idle=s] [--events=n] [--kills=n] [--logs=directory] [--port=n] [--out=file] [--wav=file] [--classifier-delay=ms]"
+                                 " [--face-rate=hz] [--sound-rate=hz] [--stress=s] [--soak=s] [--late=ms] [--seed=n]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    // Stand-ins take the names of the NAOqi modules, so the proxies of the Logger and the Interface find them
+    try {
+        bench.broker = AL::ALBroker::createBroker("rtnbench", "127.0.0.1", options.port, "", 0, 0);
+        AL::ALBrokerManager::setInstance(bench.broker->fBrokerManager.lock());
+        AL::ALBrokerManager::getInstance()->addBroker(bench.broker);
+        bench.memory = AL::ALModule::createModule<MemoryStandIn>(bench.broker, "ALMemory");
+        bench.player = AL::ALModule::createModule<AudioPlayerStandIn>(bench.broker, "ALAudioPlayer");
+        bench.audio = AL::ALModule::createModule<AudioDeviceStandIn>(bench.broker, "ALAudioDevice");
+        AL::ALModule::createModule<LedsStandIn>(bench.broker, "ALLeds");
+        bench.classifier = AL::ALModule::createModule<ClassificationStandIn>(bench.broker, "LRKlasifikacijaZvukova");
+        long long created = monotonicTime();
+        bench.logger = AL::ALModule::createModule<ResponseToNameLogger>(bench.broker, "ResponseToNameLogger");
+        bench.loggerCreation = monotonicTime() - created;
+        created = monotonicTime();
+        bench.interface = AL::ALModule::createModule<ResponseToNameInterface>(bench.broker, "ResponseToNameInterface");
+        bench.interfaceCreation = monotonicTime() - created;
+        bench.logger->setParameter("logDirectory", AL::ALValue(options.logs));
+    }
+    catch (const AL::ALError& e) {
+        std::fprintf(stderr, "Error setting up the local broker %s\n", e.toString().c_str());
+        return 1;
+    }
+
+    // Process of the resume scenario runs its session and nothing else
+    if( !options.resumeChild.empty() ) {
+        int status = resumeChild(bench);
+        bench.broker->shutdown();
+        return status;
+    }
+
+    BenchReport report(options.label);
+    for( std::size_t i = 0; i < sizeof(scenarios)/sizeof(scenarios[0]); ++i ) {
+        if( selected(options, scenarios[i].name) ) {
+            std::fprintf(stderr, "Running %s\n", scenarios[i].name);
+            report.beginScenario(scenarios[i].name);
+            scenarios[i].run(bench, report);
+            report.endScenario();
+        }
+    }
+
+    std::FILE *out = options.out.empty() ? stdout : std::fopen(options.out.c_str(), "w");
+    if( !out ) {
+        std::perror(options.out.c_str());
+        return 1;
+    }
+    std::string json = report.json();
+    std::fwrite(json.data(), 1, json.size(), out);
+    if( out != stdout ) {
+        std::fclose(out);
+    }
+
+    bench.broker->shutdown();
+    return 0;
+}
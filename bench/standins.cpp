@@ -0,0 +1,676 @@
+#include "standins.hpp"
+#include "eventtime.hpp"
+#include "wavfile.hpp"
+#include <alcommon/albroker.h>
+#include <alcommon/alproxy.h>
+#include <alerror/alerror.h>
+#include <boost/bind.hpp>
+#include <qi/log.hpp>
+#include <cstdio>
+
+namespace
+{
+  /**
+    * Number of threads delivering events, callbacks of one event can run at the same time
+    */
+  const int DeliveryThreads = 4;
+}
+
+MemoryStandIn::MemoryStandIn(boost::shared_ptr<AL::ALBroker> broker, const std::string &name) :
+    AL::ALModule(broker, name), shutdown(false), inFlight(0), listInsertCount(0) {
+
+    setModuleDescription("Stand-in for ALMemory used by the benchmarks");
+
+    functionName("declareEvent", getName(), "Declares an event");
+    addParam("event", "Name of the event");
+    BIND_METHOD(MemoryStandIn::declareEvent);
+
+    functionName("declareEvent", getName(), "Declares an event raised by the given module");
+    addParam("event", "Name of the event");
+    addParam("owner", "Module raising the event");
+    BIND_METHOD(MemoryStandIn::declareEventWithOwner);
+
+    functionName("subscribeToEvent", getName(), "Subscribes the module to the event");
+    addParam("event", "Name of the event");
+    addParam("module", "Name of the subscribed module");
+    addParam("callback", "Method called when the event is raised");
+    BIND_METHOD(MemoryStandIn::subscribeToEvent);
+
+    functionName("unsubscribeToEvent", getName(), "Unsubscribes the module from the event");
+    addParam("event", "Name of the event");
+    addParam("module", "Name of the subscribed module");
+    BIND_METHOD(MemoryStandIn::unsubscribeToEvent);
+
+    functionName("raiseEvent", getName(), "Raises the event, delivering it to the subscribed modules");
+    addParam("event", "Name of the event");
+    addParam("value", "Value of the event");
+    BIND_METHOD(MemoryStandIn::raiseEvent);
+
+    functionName("insertData", getName(), "Stores the value under the key");
+    addParam("key", "Key of the data");
+    addParam("value", "Value of the data");
+    BIND_METHOD(MemoryStandIn::insertData);
+
+    functionName("insertListData", getName(), "Stores each value of a list of key, value pairs under its key");
+    addParam("list", "List of key, value pairs");
+    BIND_METHOD(MemoryStandIn::insertListData);
+
+    functionName("getData", getName(), "Value stored under the key");
+    addParam("key", "Key of the data");
+    setReturn("value", "Value of the data, invalid if nothing is stored");
+    BIND_METHOD(MemoryStandIn::getData);
+
+    for( int i = 0; i < DeliveryThreads; ++i ) {
+        workers.create_thread(boost::bind(&MemoryStandIn::deliver, this));
+    }
+}
+
+MemoryStandIn::~MemoryStandIn() {
+    {
+        boost::mutex::scoped_lock lock(mutex);
+        shutdown = true;
+    }
+    condition.notify_all();
+    workers.join_all();
+}
+
+void MemoryStandIn::declareEvent(const std::string &event) {
+}
+
+void MemoryStandIn::declareEventWithOwner(const std::string &event, const std::string &owner) {
+}
+
+void MemoryStandIn::subscribeToEvent(const std::string &event, const std::string &module, const std::string &callback) {
+    boost::mutex::scoped_lock lock(mutex);
+    std::vector<Subscriber> &list = subscribers[event];
+    for( std::size_t i = 0; i < list.size(); ++i ) {
+        if( list[i].module == module ) {
+            list[i].callback = callback;
+            return;
+        }
+    }
+    Subscriber subscriber;
+    subscriber.module = module;
+    subscriber.callback = callback;
+    list.push_back(subscriber);
+}
+
+void MemoryStandIn::unsubscribeToEvent(const std::string &event, const std::string &module) {
+    boost::mutex::scoped_lock lock(mutex);
+    std::vector<Subscriber> &list = subscribers[event];
+    for( std::size_t i = 0; i < list.size(); ++i ) {
+        if( list[i].module == module ) {
+            list.erase(list.begin() + i);
+            return;
+        }
+    }
+}
+
+void MemoryStandIn::raiseEvent(const std::string &event, const AL::ALValue &value) {
+    long long now = monotonicTime();
+    {
+        boost::mutex::scoped_lock lock(mutex);
+        data[event] = value;
+        raises[event].push_back(now);
+        carried[event].push_back(eventTime(value, now));
+        const std::vector<Subscriber> &list = subscribers[event];
+        for( std::size_t i = 0; i < list.size(); ++i ) {
+            Pending pending;
+            pending.subscriber = list[i];
+            pending.event = event;
+            pending.value = value;
+            pending.raised = now;
+            queue.push_back(pending);
+            inFlight++;
+        }
+    }
+    condition.notify_all();
+    delivered.notify_all();
+}
+
+void MemoryStandIn::insertData(const std::string &key, const AL::ALValue &value) {
+    boost::mutex::scoped_lock lock(mutex);
+    data[key] = value;
+}
+
+void MemoryStandIn::insertListData(const AL::ALValue &list) {
+    boost::mutex::scoped_lock lock(mutex);
+    for( unsigned int i = 0; i < list.getSize(); ++i ) {
+        data[(std::string)list[i][0]] = list[i][1];
+    }
+    ++listInsertCount;
+}
+
+unsigned long MemoryStandIn::listInserts() {
+    boost::mutex::scoped_lock lock(mutex);
+    return listInsertCount;
+}
+
+AL::ALValue MemoryStandIn::getData(const std::string &key) {
+    boost::mutex::scoped_lock lock(mutex);
+    std::map<std::string, AL::ALValue>::const_iterator found = data.find(key);
+    return found == data.end() ? AL::ALValue() : found->second;
+}
+
+unsigned long MemoryStandIn::raised(const std::string &event) {
+    boost::mutex::scoped_lock lock(mutex);
+    return raises[event].size();
+}
+
+void MemoryStandIn::forget(const std::string &event) {
+    boost::mutex::scoped_lock lock(mutex);
+    raises.erase(event);
+    carried.erase(event);
+}
+
+bool MemoryStandIn::waitForEvent(const std::string &event, unsigned long count, unsigned int timeout) {
+    boost::system_time deadline = boost::get_system_time() + boost::posix_time::milliseconds(timeout);
+    boost::mutex::scoped_lock lock(mutex);
+    while( raises[event].size() < count ) {
+        if( !delivered.timed_wait(lock, deadline) ) {
+            return raises[event].size() >= count;
+        }
+    }
+    return true;
+}
+
+void MemoryStandIn::waitUntilDelivered() {
+    boost::mutex::scoped_lock lock(mutex);
+    while( inFlight > 0 ) {
+        delivered.wait(lock);
+    }
+}
+
+std::vector<Delivery> MemoryStandIn::deliveries(bool clear) {
+    boost::mutex::scoped_lock lock(mutex);
+    std::vector<Delivery> result = trace;
+    if( clear ) {
+        trace.clear();
+    }
+    return result;
+}
+
+std::vector<long long> MemoryStandIn::raiseTimes(const std::string &event) {
+    boost::mutex::scoped_lock lock(mutex);
+    return raises[event];
+}
+
+std::vector<long long> MemoryStandIn::eventTimes(const std::string &event) {
+    boost::mutex::scoped_lock lock(mutex);
+    return carried[event];
+}
+
+void MemoryStandIn::deliver() {
+    boost::mutex::scoped_lock lock(mutex);
+    while( true ) {
+        while( queue.empty() && !shutdown ) {
+            condition.wait(lock);
+        }
+        if( shutdown ) {
+            return;
+        }
+        Pending pending = queue.front();
+        queue.pop_front();
+
+        Delivery delivery;
+        delivery.event = pending.event;
+        delivery.module = pending.subscriber.module;
+        delivery.raised = pending.raised;
+        lock.unlock();
+        delivery.started = monotonicTime();
+        call(pending.subscriber, pending.event, pending.value);
+        delivery.returned = monotonicTime();
+        lock.lock();
+
+        trace.push_back(delivery);
+        inFlight--;
+        delivered.notify_all();
+    }
+}
+
+void MemoryStandIn::call(const Subscriber &subscriber, const std::string &event, const AL::ALValue &value) {
+    std::string method = subscriber.module + "." + subscriber.callback;
+    int parameters;
+    {
+        boost::mutex::scoped_lock lock(mutex);
+        std::map<std::string, int>::const_iterator found = arity.find(method);
+        parameters = found == arity.end() ? -1 : found->second;
+    }
+    AL::ALProxy proxy(getParentBroker(), subscriber.module);
+    // ALMemory calls back with key, value and message, or with fewer of them if the callback takes fewer
+    for( int tried = 3; tried >= 0; --tried ) {
+        if( parameters >= 0 && tried != parameters ) {
+            continue;
+        }
+        try {
+            switch( tried ) {
+                case 3: proxy.callVoid(subscriber.callback, event, value, std::string()); break;
+                case 2: proxy.callVoid(subscriber.callback, event, value); break;
+                case 1: proxy.callVoid(subscriber.callback, event); break;
+                default: proxy.callVoid(subscriber.callback); break;
+            }
+        }
+        catch (const AL::ALError& e) {
+            if( parameters >= 0 || tried == 0 ) {
+                qiLogError("MemoryStandIn") << "Error delivering " << event << " to " << method << e.toString() << std::endl;
+                return;
+            }
+            continue;
+        }
+        if( parameters < 0 ) {
+            boost::mutex::scoped_lock lock(mutex);
+            arity[method] = tried;
+        }
+        return;
+    }
+}
+
+AudioPlayerStandIn::AudioPlayerStandIn(boost::shared_ptr<AL::ALBroker> broker, const std::string &name) :
+    AL::ALModule(broker, name), stopCount(0), clipLength(0), nextId(1) {
+
+    setModuleDescription("Stand-in for ALAudioPlayer used by the benchmarks");
+
+    functionName("playFile", getName(), "Decodes and plays the file, takes as long as the clip set for the benchmark");
+    addParam("file", "Path of the file");
+    BIND_METHOD(AudioPlayerStandIn::playFile);
+
+    functionName("loadFile", getName(), "Decodes the file and keeps its samples, returns the ID of the sound");
+    addParam("file", "Path of the file");
+    setReturn("id", "ID of the loaded sound");
+    BIND_METHOD(AudioPlayerStandIn::loadFile);
+
+    functionName("play", getName(), "Plays a loaded sound, takes as long as the clip set for the benchmark");
+    addParam("id", "ID of the sound");
+    BIND_METHOD(AudioPlayerStandIn::play);
+
+    functionName("unloadFile", getName(), "Releases the samples of a loaded sound");
+    addParam("id", "ID of the sound");
+    BIND_METHOD(AudioPlayerStandIn::unloadFile);
+
+    functionName("stop", getName(), "Stops the sounds being played");
+    addParam("id", "ID of the task playing the sound");
+    BIND_METHOD(AudioPlayerStandIn::stop);
+}
+
+std::vector<float> AudioPlayerStandIn::decode(const std::string &file) {
+    std::vector<float> samples;
+    WavInfo info;
+    std::string error;
+    if( !readWavInfo(file, info, error) || info.bitsPerSample != 16 ) {
+        qiLogError("AudioPlayerStandIn") << "Can not decode " << file << " " << error << std::endl;
+        return samples;
+    }
+    std::FILE *in = std::fopen(file.c_str(), "rb");
+    if( !in ) {
+        return samples;
+    }
+    std::vector<unsigned char> data(info.dataSize);
+    std::fseek(in, info.dataOffset, SEEK_SET);
+    std::size_t size = std::fread(&data[0], 1, data.size(), in);
+    std::fclose(in);
+    samples.resize(size/2);
+    for( std::size_t i = 0; i < samples.size(); ++i ) {
+        short sample = static_cast<short>(data[2*i] | (data[2*i + 1] << 8));
+        samples[i] = sample/32768.0f;
+    }
+    return samples;
+}
+
+void AudioPlayerStandIn::playSamples() {
+    boost::mutex::scoped_lock lock(mutex);
+    firstSamples.push_back(monotonicTime());
+    boost::system_time end = boost::get_system_time() + boost::posix_time::milliseconds(clipLength);
+    unsigned long stopsBefore = stopCount;
+    while( stopCount == stopsBefore && stopped.timed_wait(lock, end) ) {
+    }
+    ends.push_back(monotonicTime());
+}
+
+void AudioPlayerStandIn::playFile(const std::string &file) {
+    {
+        boost::mutex::scoped_lock lock(mutex);
+        plays.push_back(monotonicTime());
+    }
+    decode(file);
+    playSamples();
+}
+
+int AudioPlayerStandIn::loadFile(const std::string &file) {
+    std::vector<float> samples = decode(file);
+    boost::mutex::scoped_lock lock(mutex);
+    int id = nextId++;
+    loaded[id].swap(samples);
+    return id;
+}
+
+void AudioPlayerStandIn::play(const int &id) {
+    {
+        boost::mutex::scoped_lock lock(mutex);
+        plays.push_back(monotonicTime());
+    }
+    playSamples();
+}
+
+void AudioPlayerStandIn::unloadFile(const int &id) {
+    boost::mutex::scoped_lock lock(mutex);
+    loaded.erase(id);
+}
+
+void AudioPlayerStandIn::stop(const int &id) {
+    boost::mutex::scoped_lock lock(mutex);
+    stops.push_back(monotonicTime());
+    ++stopCount;
+    stopped.notify_all();
+}
+
+void AudioPlayerStandIn::setClipLength(unsigned int milliseconds) {
+    boost::mutex::scoped_lock lock(mutex);
+    clipLength = milliseconds;
+}
+
+std::vector<long long> AudioPlayerStandIn::playTimes(bool clear) {
+    boost::mutex::scoped_lock lock(mutex);
+    std::vector<long long> result = plays;
+    if( clear ) {
+        plays.clear();
+    }
+    return result;
+}
+
+std::vector<long long> AudioPlayerStandIn::firstSampleTimes(bool clear) {
+    boost::mutex::scoped_lock lock(mutex);
+    std::vector<long long> result = firstSamples;
+    if( clear ) {
+        firstSamples.clear();
+    }
+    return result;
+}
+
+std::vector<long long> AudioPlayerStandIn::endTimes(bool clear) {
+    boost::mutex::scoped_lock lock(mutex);
+    std::vector<long long> result = ends;
+    if( clear ) {
+        ends.clear();
+    }
+    return result;
+}
+
+std::vector<long long> AudioPlayerStandIn::stopTimes(bool clear) {
+    boost::mutex::scoped_lock lock(mutex);
+    std::vector<long long> result = stops;
+    if( clear ) {
+        stops.clear();
+    }
+    return result;
+}
+
+LedsStandIn::LedsStandIn(boost::shared_ptr<AL::ALBroker> broker, const std::string &name) :
+    AL::ALModule(broker, name) {
+
+    setModuleDescription("Stand-in for ALLeds used by the benchmarks");
+
+    functionName("fadeRGB", getName(), "Fades the LED group to the color, does nothing");
+    addParam("group", "Name of the LED group");
+    addParam("color", "Color as 0x00RRGGBB");
+    addParam("duration", "Duration of the fade in seconds");
+    BIND_METHOD(LedsStandIn::fadeRGB);
+}
+
+void LedsStandIn::fadeRGB(const std::string &group, const int &color, const float &duration) {
+}
+
+ClassificationStandIn::ClassificationStandIn(boost::shared_ptr<AL::ALBroker> broker, const std::string &name) :
+    AL::ALModule(broker, name), delay(0), startCount(0), stopCount(0), classifying(false) {
+
+    setModuleDescription("Stand-in for the sound classification module used by the benchmarks");
+
+    functionName("pocni_klasifikaciju", getName(), "Starts sound classification, only takes the time set for it");
+    addParam("parameters", "Processing and recording parameters");
+    BIND_METHOD(ClassificationStandIn::pocni_klasifikaciju);
+
+    functionName("prekini_klasifikaciju", getName(), "Stops sound classification, only takes the time set for it");
+    BIND_METHOD(ClassificationStandIn::prekini_klasifikaciju);
+}
+
+void ClassificationStandIn::pocni_klasifikaciju(const AL::ALValue &parameters) {
+    unsigned int wait;
+    {
+        boost::mutex::scoped_lock lock(mutex);
+        wait = delay;
+    }
+    boost::this_thread::sleep(boost::posix_time::milliseconds(wait));
+    boost::mutex::scoped_lock lock(mutex);
+    ++startCount;
+    classifying = true;
+}
+
+void ClassificationStandIn::prekini_klasifikaciju() {
+    unsigned int wait;
+    {
+        boost::mutex::scoped_lock lock(mutex);
+        wait = delay;
+    }
+    boost::this_thread::sleep(boost::posix_time::milliseconds(wait));
+    boost::mutex::scoped_lock lock(mutex);
+    ++stopCount;
+    classifying = false;
+}
+
+void ClassificationStandIn::setDelay(unsigned int milliseconds) {
+    boost::mutex::scoped_lock lock(mutex);
+    delay = milliseconds;
+}
+
+unsigned long ClassificationStandIn::starts(bool clear) {
+    boost::mutex::scoped_lock lock(mutex);
+    unsigned long count = startCount;
+    if( clear ) {
+        startCount = 0;
+    }
+    return count;
+}
+
+unsigned long ClassificationStandIn::stops(bool clear) {
+    boost::mutex::scoped_lock lock(mutex);
+    unsigned long count = stopCount;
+    if( clear ) {
+        stopCount = 0;
+    }
+    return count;
+}
+
+bool ClassificationStandIn::running() {
+    boost::mutex::scoped_lock lock(mutex);
+    return classifying;
+}
+
+AudioDeviceStandIn::AudioDeviceStandIn(boost::shared_ptr<AL::ALBroker> broker, const std::string &name) :
+    AL::ALModule(broker, name) {
+
+    setModuleDescription("Stand-in for ALAudioDevice used by the benchmarks");
+
+    functionName("subscribe", getName(), "Subscribes the module to the buffers of the microphones");
+    addParam("module", "Name of the subscribed module");
+    BIND_METHOD(AudioDeviceStandIn::subscribe);
+
+    functionName("unsubscribe", getName(), "Unsubscribes the module from the buffers of the microphones");
+    addParam("module", "Name of the subscribed module");
+    BIND_METHOD(AudioDeviceStandIn::unsubscribe);
+
+    functionName("setClientPreferences", getName(), "Sets the format of the buffers of the module, does nothing");
+    addParam("module", "Name of the module");
+    addParam("sampleRate", "Sample rate of the buffers");
+    addParam("channels", "Channels of the buffers");
+    addParam("deinterleaved", "Channels are deinterleaved");
+    BIND_METHOD(AudioDeviceStandIn::setClientPreferences);
+}
+
+void AudioDeviceStandIn::subscribe(const std::string &module) {
+    boost::shared_ptr<AL::ALProxy> proxy(new AL::ALProxy(getParentBroker(), module));
+    boost::mutex::scoped_lock lock(mutex);
+    subscribers[module] = proxy;
+    subscribed.notify_all();
+}
+
+void AudioDeviceStandIn::unsubscribe(const std::string &module) {
+    boost::mutex::scoped_lock lock(mutex);
+    subscribers.erase(module);
+}
+
+void AudioDeviceStandIn::setClientPreferences(const std::string &module, const int &sampleRate, const int &channels, const int &deinterleaved) {
+}
+
+bool AudioDeviceStandIn::waitForSubscriber(const std::string &module, unsigned int timeout) {
+    boost::mutex::scoped_lock lock(mutex);
+    boost::system_time end = boost::get_system_time() + boost::posix_time::milliseconds(timeout);
+    while( subscribers.find(module) == subscribers.end() ) {
+        if( !subscribed.timed_wait(lock, end) ) {
+            return subscribers.find(module) != subscribers.end();
+        }
+    }
+    return true;
+}
+
+bool AudioDeviceStandIn::readRecording(const std::string &path, std::vector<short> &samples, int &sampleRate, std::string &error) {
+    WavInfo info;
+    if( !readWavInfo(path, info, error) ) {
+        return false;
+    }
+    if( info.bitsPerSample != 16 ) {
+        error = "samples are not 16 bit";
+        return false;
+    }
+    std::FILE *in = std::fopen(path.c_str(), "rb");
+    if( !in ) {
+        error = "can not be opened";
+        return false;
+    }
+    std::vector<unsigned char> data(info.dataSize);
+    std::fseek(in, info.dataOffset, SEEK_SET);
+    std::size_t size = data.empty() ? 0 : std::fread(&data[0], 1, data.size(), in);
+    std::fclose(in);
+    std::size_t frames = size/(2*info.channels);
+    samples.resize(frames);
+    for( std::size_t i = 0; i < frames; ++i ) {
+        std::size_t byte = 2*i*info.channels;
+        samples[i] = static_cast<short>(data[byte] | (data[byte + 1] << 8));
+    }
+    sampleRate = info.sampleRate;
+    return true;
+}
+
+std::vector<long long> AudioDeviceStandIn::play(const std::vector<short> &samples, int sampleRate, bool realTime) {
+    std::vector<long long> durations;
+    long long start = monotonicTime();
+    AL::ALValue timestamp;
+    timestamp.arraySetSize(2);
+    for( std::size_t first = 0; first + BufferLength <= samples.size(); first += BufferLength ) {
+        // Buffer is delivered once its last sample is recorded
+        long long due = start + static_cast<long long>(first + BufferLength)*1000000000LL/sampleRate;
+        if( realTime ) {
+            long long wait = due - monotonicTime();
+            if( wait > 0 ) {
+                boost::this_thread::sleep(boost::posix_time::microseconds(wait/1000));
+            }
+        }
+        std::vector<boost::shared_ptr<AL::ALProxy> > proxies;
+        {
+            boost::mutex::scoped_lock lock(mutex);
+            for( std::map<std::string, boost::shared_ptr<AL::ALProxy> >::iterator i = subscribers.begin(); i != subscribers.end(); ++i ) {
+                proxies.push_back(i->second);
+            }
+        }
+        long long now = monotonicTime();
+        timestamp[0] = static_cast<int>(now/1000000000LL);
+        timestamp[1] = static_cast<int>(now%1000000000LL/1000);
+        AL::ALValue buffer(&samples[first], static_cast<int>(BufferLength*sizeof(short)));
+        for( std::size_t i = 0; i < proxies.size(); ++i ) {
+            try {
+                long long called = monotonicTime();
+                proxies[i]->callVoid("processRemote", 1, static_cast<int>(BufferLength), timestamp, buffer);
+                durations.push_back(monotonicTime() - called);
+            }
+            catch (const AL::ALError& e) {
+                qiLogError("AudioDeviceStandIn") << "Error delivering audio " << e.toString() << std::endl;
+            }
+        }
+    }
+    return durations;
+}
+
+SubscriberStandIn::SubscriberStandIn(boost::shared_ptr<AL::ALBroker> broker, const std::string &name) :
+    AL::ALModule(broker, name), resubscribing(false), handledCount(0) {
+
+    setModuleDescription("Module receiving events the old and the new way, used by the benchmarks");
+
+    functionName("onDispatched", getName(), "Receives the event through the dispatcher");
+    addParam("key", "Name of the event");
+    addParam("value", "Value of the event");
+    addParam("message", "Message of the event");
+    BIND_METHOD(SubscriberStandIn::onDispatched);
+
+    functionName("onResubscribed", getName(), "Receives the event by unsubscribing and subscribing again");
+    addParam("key", "Name of the event");
+    addParam("value", "Value of the event");
+    addParam("message", "Message of the event");
+    BIND_METHOD(SubscriberStandIn::onResubscribed);
+}
+
+SubscriberStandIn::~SubscriberStandIn() {
+    stop();
+}
+
+void SubscriberStandIn::start(const std::string &newEvent, bool resubscribe) {
+    stop();
+    if( !memoryProxy ) {
+        memoryProxy = boost::shared_ptr<AL::ALMemoryProxy>(new AL::ALMemoryProxy(getParentBroker()));
+    }
+    event = newEvent;
+    resubscribing = resubscribe;
+    if( resubscribing ) {
+        memoryProxy->subscribeToEvent(event, getName(), "onResubscribed");
+        return;
+    }
+    boost::shared_ptr<RemoteTransport> transport(new RemoteTransport(memoryProxy, getName(), RemoteTransport::Direct));
+    dispatcher = boost::shared_ptr<EventDispatcher>(new EventDispatcher(transport, getName()));
+    dispatcher->add(event, "onDispatched", boost::bind(&SubscriberStandIn::handle, this, _1), EventDispatcher::Gate::Drop);
+    dispatcher->subscribe(event);
+}
+
+void SubscriberStandIn::stop() {
+    if( dispatcher ) {
+        dispatcher->unsubscribe(event);
+        dispatcher.reset();
+    }
+    else if( resubscribing ) {
+        try {
+            memoryProxy->unsubscribeToEvent(event, getName());
+        }
+        catch (const AL::ALError& e) {
+            // Callback was running and had unsubscribed
+        }
+    }
+    resubscribing = false;
+}
+
+void SubscriberStandIn::onDispatched(const std::string &key, const AL::ALValue &value, const std::string &message) {
+    dispatcher->dispatch(key, value);
+}
+
+void SubscriberStandIn::onResubscribed(const std::string &key, const AL::ALValue &value, const std::string &message) {
+    // Events arriving until the callback subscribes again are lost, as they were in the modules
+    memoryProxy->unsubscribeToEvent(key, getName());
+    handle(value);
+    memoryProxy->subscribeToEvent(key, getName(), "onResubscribed");
+}
+
+unsigned long SubscriberStandIn::handled(bool clear) {
+    if( clear ) {
+        return __sync_lock_test_and_set(&handledCount, 0);
+    }
+    return handledCount;
+}
+
+void SubscriberStandIn::handle(const AL::ALValue &value) {
+    __sync_fetch_and_add(&handledCount, 1);
+}
@@ -0,0 +1,315 @@
+#ifndef BENCH_STANDINS_H
+#define BENCH_STANDINS_H
+
+#include "monotonictime.hpp"
+#include "eventdispatcher.hpp"
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
+#include <alcommon/almodule.h>
+#include <alcommon/alproxy.h>
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace AL
+{
+  class ALBroker;
+}
+
+/**
+  * One event delivered to one subscriber, times are monotonic nanoseconds
+  */
+struct Delivery {
+    std::string event;
+    std::string module;
+    long long raised;     // raiseEvent was called
+    long long started;    // callback of the subscriber was called
+    long long returned;   // callback of the subscriber returned
+};
+
+/**
+  * Local stand-in for ALMemory, keeps data and delivers events to subscribed modules
+  * Events are delivered on a pool of threads, raiseEvent never waits for the callbacks,
+  * and every delivery is recorded so the benchmark can measure the callbacks
+  */
+class MemoryStandIn : public AL::ALModule
+{
+  public:
+    MemoryStandIn(boost::shared_ptr<AL::ALBroker> broker, const std::string &name);
+    virtual ~MemoryStandIn();
+
+    /**
+      * Bound methods of ALMemory the modules use
+      */
+    void declareEvent(const std::string &event);
+    void declareEventWithOwner(const std::string &event, const std::string &owner);
+    void subscribeToEvent(const std::string &event, const std::string &module, const std::string &callback);
+    void unsubscribeToEvent(const std::string &event, const std::string &module);
+    void raiseEvent(const std::string &event, const AL::ALValue &value);
+    void insertData(const std::string &key, const AL::ALValue &value);
+    void insertListData(const AL::ALValue &list);
+    AL::ALValue getData(const std::string &key);
+
+    /**
+      * Number of insertListData calls so far
+      */
+    unsigned long listInserts();
+
+    /**
+      * Number of raiseEvent calls for the event so far
+      */
+    unsigned long raised(const std::string &event);
+
+    /**
+      * Forgets the raises of the event, so a long run does not keep them all; its count starts again from 0
+      */
+    void forget(const std::string &event);
+
+    /**
+      * Waits until the event was raised count times in total, returns false on timeout
+      */
+    bool waitForEvent(const std::string &event, unsigned long count, unsigned int timeout);
+
+    /**
+      * Waits until every raised event was delivered
+      */
+    void waitUntilDelivered();
+
+    /**
+      * Deliveries recorded so far, clear removes them
+      */
+    std::vector<Delivery> deliveries(bool clear = false);
+
+    /**
+      * Times at which the event was raised, in monotonic nanoseconds
+      */
+    std::vector<long long> raiseTimes(const std::string &event);
+
+    /**
+      * Times carried by the values the event was raised with, the time it was raised for a value carrying none
+      * Raising module may have acted on the event before raising it in ALMemory, as over the event bus
+      */
+    std::vector<long long> eventTimes(const std::string &event);
+
+  private:
+    struct Subscriber {
+        std::string module;
+        std::string callback;
+    };
+
+    struct Pending {
+        Subscriber subscriber;
+        std::string event;
+        AL::ALValue value;
+        long long raised;
+    };
+
+    void deliver();
+
+    /**
+      * Calls the callback with as many of key, value and message as it takes
+      */
+    void call(const Subscriber &subscriber, const std::string &event, const AL::ALValue &value);
+
+    boost::mutex mutex;
+    boost::condition_variable condition;
+    boost::condition_variable delivered;
+    boost::thread_group workers;
+    bool shutdown;
+    unsigned long inFlight;
+    unsigned long listInsertCount;
+
+    std::map<std::string, AL::ALValue> data;
+    std::map<std::string, std::vector<Subscriber> > subscribers;
+    std::map<std::string, int> arity;
+    std::map<std::string, std::vector<long long> > raises;
+    std::map<std::string, std::vector<long long> > carried;
+    std::deque<Pending> queue;
+    std::vector<Delivery> trace;
+};
+
+/**
+  * Local stand-in for ALAudioPlayer, playing a file takes the time set for the clip
+  * Files are read and decoded to samples the way the player does, by playFile on every call or once by loadFile
+  * Tasks posted to the stand-in are waited for with the wait method every module has, stop cuts short whatever is playing
+  */
+class AudioPlayerStandIn : public AL::ALModule
+{
+  public:
+    AudioPlayerStandIn(boost::shared_ptr<AL::ALBroker> broker, const std::string &name);
+
+    void playFile(const std::string &file);
+    int loadFile(const std::string &file);
+    void play(const int &id);
+    void unloadFile(const int &id);
+    void stop(const int &id);
+
+    /**
+      * Length of every clip in milliseconds
+      */
+    void setClipLength(unsigned int milliseconds);
+
+    /**
+      * Times at which playFile was called, in monotonic nanoseconds
+      */
+    std::vector<long long> playTimes(bool clear = false);
+
+    /**
+      * Times at which the first sample of each clip was ready, in monotonic nanoseconds
+      */
+    std::vector<long long> firstSampleTimes(bool clear = false);
+
+    /**
+      * Times at which each clip ended, played to the end or stopped
+      */
+    std::vector<long long> endTimes(bool clear = false);
+
+    /**
+      * Times at which stop was called
+      */
+    std::vector<long long> stopTimes(bool clear = false);
+
+  private:
+    /**
+      * Reads the file and decodes it to samples, empty if it is not a PCM WAV file
+      */
+    static std::vector<float> decode(const std::string &file);
+
+    /**
+      * Records the first sample and waits for the clip to be played or stopped
+      */
+    void playSamples();
+
+    boost::mutex mutex;
+    boost::condition_variable stopped;
+    unsigned long stopCount;
+    unsigned int clipLength;
+    std::vector<long long> plays;
+    std::vector<long long> firstSamples;
+    std::vector<long long> ends;
+    std::vector<long long> stops;
+    int nextId;
+    std::map<int, std::vector<float> > loaded;
+};
+
+/**
+  * Local stand-in for ALLeds, LEDs are not driven
+  */
+class LedsStandIn : public AL::ALModule
+{
+  public:
+    LedsStandIn(boost::shared_ptr<AL::ALBroker> broker, const std::string &name);
+
+    void fadeRGB(const std::string &group, const int &color, const float &duration);
+};
+
+/**
+  * Local stand-in for ALAudioDevice, plays a recording into the modules subscribed to it
+  * Buffers are delivered to processRemote of every subscriber, as ALAudioDevice delivers them to a module
+  * which is not a sound extractor, one at a time and in real time or as fast as the subscribers take them
+  */
+class AudioDeviceStandIn : public AL::ALModule
+{
+  public:
+    /**
+      * Samples of each channel in a buffer, as ALAudioDevice delivers them at 16 kHz
+      */
+    enum { BufferLength = 1365 };
+
+    AudioDeviceStandIn(boost::shared_ptr<AL::ALBroker> broker, const std::string &name);
+
+    void subscribe(const std::string &module);
+    void unsubscribe(const std::string &module);
+    void setClientPreferences(const std::string &module, const int &sampleRate, const int &channels, const int &deinterleaved);
+
+    /**
+      * Reads the first channel of a 16 bit PCM WAV file, returns false with the reason in error if it can not be read
+      */
+    static bool readRecording(const std::string &path, std::vector<short> &samples, int &sampleRate, std::string &error);
+
+    /**
+      * Waits until the module subscribed, returns false on timeout
+      */
+    bool waitForSubscriber(const std::string &module, unsigned int timeout);
+
+    /**
+      * Plays the samples buffer by buffer to the modules subscribed while they are, in real time or as fast as they take them
+      * Returns the time each processRemote call took, in nanoseconds
+      */
+    std::vector<long long> play(const std::vector<short> &samples, int sampleRate, bool realTime);
+
+  private:
+    boost::mutex mutex;
+    boost::condition_variable subscribed;
+    std::map<std::string, boost::shared_ptr<AL::ALProxy> > subscribers;
+};
+
+/**
+  * Local stand-in for the sound classification module, nothing is classified
+  * Starting and stopping take the time set for them, as a slow classifier does
+  */
+class ClassificationStandIn : public AL::ALModule
+{
+  public:
+    ClassificationStandIn(boost::shared_ptr<AL::ALBroker> broker, const std::string &name);
+
+    void pocni_klasifikaciju(const AL::ALValue &parameters);
+    void prekini_klasifikaciju();
+
+    /**
+      * Time every start and stop takes in milliseconds, 0 by default
+      */
+    void setDelay(unsigned int milliseconds);
+
+    /**
+      * Starts and stops received, and whether the last one was a start
+      */
+    unsigned long starts(bool clear = false);
+    unsigned long stops(bool clear = false);
+    bool running();
+
+  private:
+    boost::mutex mutex;
+    unsigned int delay;
+    unsigned long startCount;
+    unsigned long stopCount;
+    bool classifying;
+};
+
+/**
+  * Module receiving an event either through an EventDispatcher, subscribed once, or the way the modules used to,
+  * unsubscribing when the callback is entered and subscribing again when it returns
+  * Handler only counts the events, so the cost of receiving them is what is measured
+  */
+class SubscriberStandIn : public AL::ALModule
+{
+  public:
+    SubscriberStandIn(boost::shared_ptr<AL::ALBroker> broker, const std::string &name);
+    virtual ~SubscriberStandIn();
+
+    /**
+      * Starts receiving the event, through the dispatcher or by resubscribing in the callback
+      */
+    void start(const std::string &event, bool resubscribe);
+    void stop();
+
+    void onDispatched(const std::string &key, const AL::ALValue &value, const std::string &message);
+    void onResubscribed(const std::string &key, const AL::ALValue &value, const std::string &message);
+
+    /**
+      * Events handled so far, clear starts counting again
+      */
+    unsigned long handled(bool clear = false);
+
+  private:
+    void handle(const AL::ALValue &value);
+
+    boost::shared_ptr<AL::ALMemoryProxy> memoryProxy;
+    boost::shared_ptr<EventDispatcher> dispatcher;
+    std::string event;
+    bool resubscribing;
+    volatile unsigned long handledCount;
+};
+
+#endif
@@ -0,0 +1,205 @@
+#ifndef ASYNC_LOG_WRITER_H
+#define ASYNC_LOG_WRITER_H
+
+#include "logrecord.hpp"
+#include "ringbuffer.hpp"
+#include "binarylog.hpp"
+#include "featurestore.hpp"
+#include "logstorage.hpp"
+#include "latencyhistogram.hpp"
+#include "monotoniccondition.hpp"
+#include <boost/function.hpp>
+#include <boost/thread.hpp>
+#include <string>
+
+/**
+  * Session log writer, records are queued by the callbacks and written by a background thread
+  * Writer formats queued records in batches and flushes them once enough data is
+  * buffered or enough time has passed, so callbacks never wait for the storage
+  */
+class AsyncLogWriter
+{
+  public:
+
+    /**
+      * Format of the log file, tab-separated text or the compact binary format
+      */
+    enum Format { Text, Binary };
+
+    /**
+      * Capacity of the record queue
+      */
+    enum { QueueSize = 1024 };
+
+    /**
+      * Size of the formatting buffer
+      */
+    enum { BatchSize = 16384 };
+
+    /**
+      * Flush policy, buffered data is flushed after flushBytes bytes or flushInterval milliseconds
+      */
+    AsyncLogWriter(std::size_t flushBytes = 4096, unsigned int flushInterval = 1000);
+
+    /**
+      * Destructor, closes the log and joins the writer thread
+      */
+    ~AsyncLogWriter();
+
+    /**
+      * Sets the log directory and the storage policy used from the next session on
+      * Waits for the session being closed to be written out
+      */
+    void configure(const std::string &directory, unsigned long long segmentSize = LogStorage::DefaultSegmentSize,
+                   LogStorage::Durability durability = LogStorage::SessionSync, unsigned int syncInterval = 5000);
+
+    /**
+      * Configures the storage and prepares it for the next session ahead of time, starting the writer thread,
+      * does nothing while a session is open
+      */
+    bool prepare(const std::string &directory, unsigned long long segmentSize = LogStorage::DefaultSegmentSize,
+                 LogStorage::Durability durability = LogStorage::SessionSync);
+
+    /**
+      * Starts the log of a new session in the storage, writer thread is created on the first call
+      * Session start, in seconds since the epoch, is stored in the header of binary logs and in the index
+      * Sound features are also written to a columnar store session_NNNNNN.rtnf if featureStore is true
+      */
+    bool open(Format format = Text, long long sessionStart = 0, bool featureStore = false);
+
+    /**
+      * Length of the session log written so far and the timestamp of its last record
+      * Two copies are kept, the sequence tells which one was stored last and completely,
+      * so a process killed in the middle of storing leaves the previous position intact
+      */
+    struct Progress {
+        struct Position {
+            unsigned long long length;
+            long long lastTimestamp;
+        };
+
+        volatile unsigned long sequence;
+        Position positions[2];
+
+        void store(unsigned long long length, long long lastTimestamp);
+        Position load() const;
+    };
+
+    /**
+      * Continues the session log left in progress by a process which ended without closing it,
+      * at the position that process stored, without the feature store
+      * Returns false if the session can not be continued
+      */
+    bool resume(Format format, const LogStorage::Session &session, const Progress::Position &position);
+
+    /**
+      * Stores the position of the log into the progress after every write, with plain stores only,
+      * e.g. into memory mapped from a file, stops if given 0
+      * Waits for the session being closed to be written out, the progress is used from the next log on
+      */
+    void track(Progress *progress);
+
+    /**
+      * ID of the session opened last
+      */
+    unsigned long session();
+
+    /**
+      * Session opened last, where its log is in the storage
+      */
+    LogStorage::Session storageSession();
+
+    /**
+      * Queues the record, never locks or allocates
+      * Records pushed while no log is open are dropped
+      */
+    void push(const LogRecord &record);
+
+    /**
+      * Shows every record to the observer on the writer thread, in the order they are written
+      * Set before the first log is prepared or opened, the observer must not push records itself
+      */
+    void observe(const boost::function<void (const LogRecord &)> &observer);
+
+    /**
+      * Returns once the writer thread took every record queued so far and showed it to the observer,
+      * without flushing them, returns at once if no log is open
+      */
+    void waitDrained();
+
+    /**
+      * Writes every queued record, flushes and closes the log file
+      */
+    void close();
+
+    /**
+      * Number of times a producer found the queue full and had to wait for the writer
+      */
+    unsigned long stalls() const;
+
+    /**
+      * Number of bytes written to the log of the session opened last
+      */
+    unsigned long long bytesWritten() const;
+
+    /**
+      * Latencies of writing a batch to the file and flushing it
+      */
+    LatencyHistogram &writeLatency();
+
+  private:
+    /**
+      * Writer thread loop
+      */
+    void run();
+
+    /**
+      * Formats every queued record into the batch, writing out full batches
+      */
+    void drain();
+
+    /**
+      * Writes the batch to the file and flushes it
+      */
+    void flush();
+
+    RingBuffer<LogRecord, QueueSize> queue;
+
+    boost::mutex mutex;
+    MonotonicCondition condition;
+    boost::condition_variable closed;
+    boost::thread writer;
+
+    LogStorage storage;
+    Format format;
+    BinaryLogEncoder encoder;
+    FeatureStoreWriter features;
+    char batch[BatchSize];
+    std::size_t batchLength;
+    unsigned long long fileLength;
+    std::size_t flushBytes;
+    long long flushInterval;    // nanoseconds
+    long long lastFlush;        // monotonic time
+    LatencyHistogram flushLatency;
+    Progress *progress;
+    boost::function<void (const LogRecord &)> observer;
+
+    /**
+      * Drains asked for by waitDrained and done by the writer thread
+      */
+    unsigned long drainRequests;
+    unsigned long drainsDone;
+
+    bool opened;
+    bool closing;
+    bool shutdown;
+
+    /**
+      * Producer side state, updated with atomic builtins only
+      */
+    volatile int accepting;
+    volatile int producers;
+    volatile unsigned long stallCount;
+};
+
+#endif
@@ -0,0 +1,125 @@
+#ifndef AUDIO_FRONT_END_H
+#define AUDIO_FRONT_END_H
+
+#include <vector>
+
+/**
+  * Classifies sounds heard by the microphones as articulated or not, in the process of the Logger,
+  * from the raw buffers ALAudioDevice delivers
+  * A sound starts with a frame louder than the loudness threshold and is decided once it lasted the given number
+  * of frames, from the energy, zero-crossing rate and band energies of its frames: articulated speech puts most of
+  * its energy between 500 and 4000 Hz and is modulated by its syllables, other sounds of the child are sustained
+  * Kernels computing the frame features are vectorised with SSE2 when compiled with it, the scalar kernels give
+  * bit for bit the same features, so both make the same decisions
+  * Front end does not depend on NAOqi, times are monotonic nanoseconds
+  */
+class AudioFrontEnd
+{
+  public:
+    enum Kernels { Scalar, Vector };
+
+    enum {
+        BlockLength = 128,      // samples of the blocks band energies are computed over
+        Bins = BlockLength/2,
+        Bands = 5,              // 0-500, 500-1000, 1000-2000, 2000-4000 and 4000-8000 Hz at 16 kHz
+        FeatureCount = 4 + Bands
+    };
+
+    /**
+      * Parameters of the front end, defaults are the ones given to the sound classification module
+      */
+    struct Parameters {
+        Parameters();
+        int loudness;           // peak amplitude of a frame starting a sound
+        int frames;             // frames of a sound
+        int buffersPerFrame;    // blocks of BlockLength samples in a frame, at 16 kHz 5 blocks are 40 ms
+        int sampleRate;
+        float articulation;     // share of the energy between 500 and 4000 Hz an articulated sound has at least
+        float modulation;       // coefficient of variation of the frame energy an articulated sound has at least
+        Kernels kernels;
+    };
+
+    /**
+      * Features of one frame
+      */
+    struct Frame {
+        double energy;          // mean square of the samples
+        int zeroCrossings;
+        int peak;               // largest absolute sample
+        float bands[Bands];     // energy in each band
+    };
+
+    /**
+      * Decided sound, the class is 1 for articulated and 0 for non-articulated as SoundClassified reports them
+      * Features are the mean log energy, energy modulation, zero-crossing rate, articulation share
+      * and the share of each band
+      */
+    struct Sound {
+        int soundClass;
+        long long time;         // time of the first sample of the sound
+        float features[FeatureCount];
+    };
+
+    explicit AudioFrontEnd(const Parameters &parameters = Parameters());
+
+    /**
+      * Forgets the sound in progress and the samples of the frame not yet complete, e.g. when listening stops
+      */
+    void reset();
+
+    /**
+      * Takes a buffer of interleaved samples, only the first channel is analysed
+      * Time is the monotonic time of the first sample of the buffer
+      * Sounds decided within the buffer are appended to sounds, returns their number
+      */
+    int process(const short *samples, int channels, int count, long long time, std::vector<Sound> &sounds);
+
+    /**
+      * Computes the features of a frame of frameLength() samples with the given kernels
+      */
+    void analyse(const short *samples, Kernels kernels, Frame &frame) const;
+
+    int frameLength() const;
+    const Parameters &parameters() const;
+
+    /**
+      * Frames analysed since the front end was created
+      */
+    unsigned long framesAnalysed() const;
+
+    /**
+      * Front end was compiled with the vectorised kernels, otherwise both kinds of kernels are scalar
+      */
+    static bool vectorised();
+
+  private:
+    /**
+      * Adds a complete frame to the sound in progress, deciding it once it has all its frames
+      */
+    bool addFrame(const Frame &frame, long long time, Sound &sound);
+
+    Parameters settings;
+    int length;
+
+    /**
+      * Hann window multiplied into the cosine and sine of every bin, one row of BlockLength per bin
+      */
+    std::vector<float> cosines;
+    std::vector<float> sines;
+
+    /**
+      * Samples of the frame not yet complete and the time of its first sample
+      */
+    std::vector<short> pending;
+    long long pendingTime;
+
+    /**
+      * Frames of the sound in progress and the time it started
+      */
+    std::vector<Frame> sound;
+    long long soundTime;
+
+    unsigned long analysed;
+};
+
+#endif
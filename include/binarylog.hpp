@@ -0,0 +1,95 @@
+#ifndef BINARY_LOG_H
+#define BINARY_LOG_H
+
+#include "logrecord.hpp"
+#include <cstddef>
+
+/**
+  * Binary session log format
+  *
+  * Header, 16 bytes:
+  *   "RTNB" magic, format version (1 byte), 3 reserved bytes,
+  *   session start as seconds since the epoch (8 bytes, little endian)
+  * Record:
+  *   event (1 byte), value (zigzag varint),
+  *   timestamp in microseconds as a difference from the previous record (zigzag varint), in milliseconds before version 4
+  *   interval records continue with the length of the interval in milliseconds (varint, since version 2)
+  *   feature records continue with the feature count (1 byte) and the features (4 byte little endian floats)
+  *   latency records continue with the name length (1 byte) and the name, followed by the features
+  *   the same way as in feature records (since version 3)
+  *   summary records continue with the features the same way as feature records (since version 5)
+  *   feature records carry the class of the sound as reported before the features, the same way as the name
+  *   of latency records (since version 6)
+  */
+enum { BinaryLogVersion = 6 };
+enum { BinaryLogHeaderSize = 16 };
+enum { BinaryLogMaxRecordSize = 1 + 10 + 10 + 10 + 1 + LogRecord::MaxNameLength + 1 + 4*LogRecord::MaxFeatures };
+
+/**
+  * Writes the header into buffer, which must hold BinaryLogHeaderSize bytes
+  */
+std::size_t encodeBinaryLogHeader(long long sessionStart, char *buffer);
+
+/**
+  * Encodes records one after another, timestamps are stored relative to the previous record
+  */
+class BinaryLogEncoder
+{
+  public:
+    BinaryLogEncoder();
+
+    /**
+      * Starts a new file, the next timestamp is stored relative to the session start
+      */
+    void reset();
+
+    /**
+      * Continues a file whose last record has the given timestamp
+      */
+    void resume(long long timestamp);
+
+    /**
+      * Timestamp of the record encoded last, the one the next timestamp is stored relative to
+      */
+    long long last() const;
+
+    /**
+      * Encodes the record into buffer, which must hold BinaryLogMaxRecordSize bytes
+      */
+    std::size_t encode(const LogRecord &record, char *buffer);
+
+  private:
+    long long lastTimestamp;
+};
+
+/**
+  * Decodes records from a buffer, the buffer can end in the middle of a record
+  */
+class BinaryLogDecoder
+{
+  public:
+    enum Result { Decoded, NeedMore, Corrupt };
+
+    BinaryLogDecoder();
+
+    /**
+      * Reads the header, advancing begin past it
+      */
+    Result decodeHeader(const char *&begin, const char *end);
+
+    /**
+      * Reads the next record, advancing begin past it
+      * If the buffer ends before the record does, begin is left untouched and NeedMore is returned
+      */
+    Result decode(const char *&begin, const char *end, LogRecord &record);
+
+    int version() const;
+    long long sessionStart() const;
+
+  private:
+    long long lastTimestamp;
+    int formatVersion;
+    long long start;
+};
+
+#endif
@@ -0,0 +1,178 @@
+#ifndef CALL_PROTOCOL_H
+#define CALL_PROTOCOL_H
+
+#include "responsedetector.hpp"
+#include <string>
+#include <vector>
+
+/**
+  * Call protocol of the session, decides when the child is called and when the session ends
+  * Protocol does not depend on NAOqi or on a clock, all times are milliseconds from the start of the session,
+  * so the same logic drives the Logger on the robot and the replay of recorded sessions
+  * Protocol is a table with one row per state, the state being the number of calls made so far
+  * Response of the child is decided by a ResponseDetector over the faces seen after the last call
+  */
+class CallProtocol
+{
+  public:
+
+    /**
+      * Deadline meaning no decision is pending
+      */
+    static const long long Never;
+
+    /**
+      * Protocol parameters, defaults are the ones used in the study
+      */
+    struct Parameters {
+        Parameters();
+        long long faceTimeout;  // no call before this long after the last face
+        long long callTimeout;  // no call before this long after the last call
+        int nameCalls;          // calls by name, made first
+        int phraseCalls;        // calls with the special phrase, made after the calls by name
+        int responseFaces;      // faces after a call counted as the response of the child
+    };
+
+    enum Action {
+        None,           // nothing to do before the deadline
+        CallByName,     // log CS, call the child by name
+        CallWithPhrase, // log PS, call the child with the special phrase
+        EndSession      // log SE, child responded (value 1) or did not respond at all (value -1)
+    };
+
+    /**
+      * State of the session after as many calls as the index of the row
+      * Child responded once responseFaces faces were seen after the last call and the response thresholds were met,
+      * 0 does not look for a response
+      * Once both timeouts passed, the action is taken with the value and the session moves on to the next row
+      */
+    struct Row {
+        Action action;
+        int value;
+        int responseFaces;
+        long long faceTimeout;
+        long long callTimeout;
+    };
+
+    typedef std::vector<Row> Table;
+
+    /**
+      * Most rows a protocol can have
+      */
+    enum { MaxRows = 64 };
+
+    struct Decision {
+        Action action;
+        int value;              // value written to the log with the action
+        long long deadline;     // time of the next decision, Never if none
+    };
+
+    /**
+      * Protocol of the parameters, name calls followed by phrase calls
+      */
+    CallProtocol(const Parameters &parameters = Parameters(),
+                 const ResponseDetector::Thresholds &response = ResponseDetector::Thresholds());
+
+    /**
+      * Protocol of the table, which must have passed validate
+      */
+    explicit CallProtocol(const Table &table,
+                          const ResponseDetector::Thresholds &response = ResponseDetector::Thresholds());
+
+    /**
+      * Starts a new session at the given time
+      */
+    void start(long long now);
+
+    /**
+      * Continues a session after the given number of calls, the last one ending at lastCall
+      * Faces seen since are given to faceDetected again
+      */
+    void resume(int calls, long long lastCallTime, long long lastFaceTime);
+
+    /**
+      * Face was seen, returns the number of faces since the last call
+      */
+    int faceDetected(long long now);
+
+    /**
+      * Child was called, returns the number of calls made so far
+      */
+    int callEnded(long long now);
+
+    /**
+      * Faces seen after the last call, as far as the response is concerned
+      */
+    const ResponseDetector &response() const;
+
+    /**
+      * Decides what to do at the given time, call and end decisions are applied to the protocol state
+      */
+    Decision step(long long now);
+
+    const Table &table() const;
+    int iteration() const;
+    int faceCount() const;
+    bool ended() const;
+
+    /**
+      * Time of the last face and of the end of the last call, the start of the session if there was none yet
+      */
+    long long lastFaceTime() const;
+    long long lastCallTime() const;
+
+    /**
+      * Table of the parameters
+      */
+    static Table tableOf(const Parameters &parameters);
+
+    /**
+      * Checks that the table is a protocol the session can run, returns false with the reason in error otherwise
+      * Same check is made for built-in and loaded protocols
+      */
+    static bool validate(const Table &table, std::string &error);
+
+    /**
+      * Table of a built-in protocol given by its name, or read from a file given by its path, and validated
+      * File has one row per line, # starts a comment:
+      *   action (CS, PS or SE), value, response faces, face timeout and call timeout in milliseconds
+      */
+    static bool load(const std::string &source, Table &table, std::string &error);
+
+  private:
+    Table rows;
+    long long lastFace;
+    long long lastCall;
+    int iterations;
+    int faces;
+    ResponseDetector detector;
+    bool sessionEnded;
+};
+
+/**
+  * Protocols built into the modules, each one is a specialisation of ProtocolTable holding a constant table
+  * The table is copied into a Table when the protocol is loaded, validated and stepped by the same code as
+  * a protocol file; step runs once per deadline, seconds apart, so it is not specialised per protocol
+  */
+enum BuiltinProtocol { StudyProtocol };
+
+template <BuiltinProtocol Protocol>
+struct ProtocolTable;
+
+/**
+  * Protocol of the study, five calls by name and two with the special phrase, five seconds apart,
+  * child responded once two faces were seen after a call
+  */
+template <>
+struct ProtocolTable<StudyProtocol> {
+    enum { Size = 8 };
+    static const char *const name;
+    static const CallProtocol::Row rows[Size];
+};
+
+template <BuiltinProtocol Protocol>
+CallProtocol::Table builtinTable() {
+    return CallProtocol::Table(ProtocolTable<Protocol>::rows, ProtocolTable<Protocol>::rows + ProtocolTable<Protocol>::Size);
+}
+
+#endif
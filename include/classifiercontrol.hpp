@@ -0,0 +1,101 @@
+#ifndef CLASSIFIER_CONTROL_H
+#define CLASSIFIER_CONTROL_H
+
+#include "latencyhistogram.hpp"
+#include <boost/function.hpp>
+#include <boost/thread.hpp>
+#include <deque>
+
+/**
+  * Starts and stops sound classification from a thread of its own, so neither the scheduler nor the event handlers
+  * wait for the classifier
+  * Commands are carried out in the order they were given; a command undoing one still queued for the same classifier
+  * takes both out of the queue, and a command leaving the classifier as it will be anyway is dropped
+  * Each classifier is known by a small number, the external module and the Logger itself are two of them
+  */
+class ClassifierControl
+{
+  public:
+    enum { MaxClassifiers = 4 };
+
+    /**
+      * Starts or stops the classifier, returns once the classifier took the command, false if it did not
+      * Called only by the thread of the control
+      */
+    typedef boost::function<bool (int classifier, bool run)> Executor;
+
+    /**
+      * Time from giving each start and stop to the classifier taking it is recorded into the histograms, if any
+      */
+    ClassifierControl(const Executor &executor, LatencyHistogram *startLatency = 0, LatencyHistogram *stopLatency = 0);
+
+    /**
+      * Destructor, carries out the commands still queued and joins the thread
+      */
+    ~ClassifierControl();
+
+    /**
+      * Queues a command, never waits for the classifier
+      */
+    void start(int classifier);
+    void stop(int classifier);
+
+    /**
+      * Classifier took a start as its last command, the state confirmed by the classifier
+      */
+    bool running(int classifier);
+
+    /**
+      * Returns once every command queued so far was carried out
+      */
+    void flush();
+
+    /**
+      * Commands carried out, commands merged away and commands the classifier did not take
+      */
+    unsigned long sent() const;
+    unsigned long merged() const;
+    unsigned long failed() const;
+
+  private:
+    struct Command {
+        int classifier;
+        bool run;
+        long long queued;
+    };
+
+    void push(int classifier, bool run);
+
+    /**
+      * Thread loop
+      */
+    void work();
+
+    Executor executor;
+    LatencyHistogram *startLatency;
+    LatencyHistogram *stopLatency;
+
+    boost::mutex mutex;
+    boost::condition_variable condition;
+    boost::condition_variable idle;
+    std::deque<Command> queue;
+    bool busy;
+    bool shutdown;
+
+    /**
+      * State each classifier is in once the command being carried out is done, and the state it confirmed
+      */
+    bool expected[MaxClassifiers];
+    bool confirmed[MaxClassifiers];
+
+    volatile unsigned long sentCount;
+    volatile unsigned long mergedCount;
+    volatile unsigned long failedCount;
+
+    /**
+      * Declared last so it starts once everything it uses is set up
+      */
+    boost::thread worker;
+};
+
+#endif
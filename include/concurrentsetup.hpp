@@ -0,0 +1,54 @@
+#ifndef CONCURRENT_SETUP_H
+#define CONCURRENT_SETUP_H
+
+#include "latencyhistogram.hpp"
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
+#include <vector>
+
+/**
+  * Independent steps of setting up a module or a session, each run on a thread of its own
+  * Steps must not depend on each other, whatever depends on them is done once wait returns
+  */
+class ConcurrentSetup
+{
+  public:
+    /**
+      * Step of the setup, errors are handled by the step itself
+      */
+    typedef boost::function<void ()> Step;
+
+    ConcurrentSetup();
+
+    /**
+      * Destructor, waits for the steps still running
+      */
+    ~ConcurrentSetup();
+
+    /**
+      * Starts the step, its duration is recorded into the histogram, if any
+      */
+    void run(const Step &step, LatencyHistogram *latency = 0);
+
+    /**
+      * Waits for every step started so far
+      * Returns the monotonic time at which the last of them finished, 0 if no step was ever started
+      */
+    long long wait();
+
+  private:
+    void runStep(Step step, LatencyHistogram *latency);
+
+    /**
+      * Guards the threads, held while waiting so a second waiter returns only once the steps finished
+      */
+    boost::mutex mutex;
+    std::vector<boost::shared_ptr<boost::thread> > threads;
+    volatile long long finished;
+
+    ConcurrentSetup(const ConcurrentSetup &);
+    ConcurrentSetup &operator=(const ConcurrentSetup &);
+};
+
+#endif
@@ -0,0 +1,15 @@
+#ifndef CPU_TIME_H
+#define CPU_TIME_H
+
+#include <time.h>
+
+/**
+  * CPU time consumed by the calling thread, in nanoseconds
+  */
+inline long long threadCpuTime() {
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec*1000000000LL + ts.tv_nsec;
+}
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef DEADLINE_SCHEDULER_H
+#define DEADLINE_SCHEDULER_H
+
+#include "monotoniccondition.hpp"
+#include <boost/function.hpp>
+#include <boost/thread.hpp>
+
+/**
+  * Persistent worker thread which sleeps until the next deadline reported by its task
+  * The same worker is reused for every session, task is replaced on each start
+  */
+class DeadlineScheduler
+{
+  public:
+
+    /**
+      * Task run by the worker, returns the monotonic time at which it should run again, in nanoseconds
+      * Returning Never puts the worker to sleep until woken
+      * Task is called without any scheduler lock held and must not throw
+      */
+    typedef boost::function<long long ()> Task;
+
+    static const long long Never;
+
+    /**
+      * Constructor, worker thread is created lazily on the first start
+      */
+    DeadlineScheduler();
+
+    /**
+      * Destructor, stops and joins the worker thread
+      */
+    ~DeadlineScheduler();
+
+    /**
+      * Starts running the given task, task is run immediately
+      */
+    void start(const Task &task);
+
+    /**
+      * Makes the worker run the task now, regardless of the current deadline
+      */
+    void wake();
+
+    /**
+      * Stops running the task, returns once the task is no longer executing
+      * Can be called from within the task itself, in which case it does not wait
+      */
+    void stop();
+
+    /**
+      * Number of times the task was run since the last start
+      */
+    unsigned long wakeups();
+
+  private:
+    /**
+      * Worker thread loop
+      */
+    void run();
+
+    boost::mutex mutex;
+    MonotonicCondition condition;
+    boost::condition_variable idle;
+    boost::thread worker;
+
+    Task task;
+    bool active;
+    bool woken;
+    bool running;
+    bool shutdown;
+    unsigned long wakeupCount;
+};
+
+#endif
@@ -0,0 +1,123 @@
+#ifndef EVENT_BUS_H
+#define EVENT_BUS_H
+
+#include "ringbuffer.hpp"
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <alvalue/alvalue.h>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/**
+  * Carries events between the Logger and Interface modules when both are loaded into the same NAOqi process,
+  * without going through ALMemory
+  * Bus is compiled into a library of its own, rtneventbus, which both modules link to, so the process loads it once
+  * and has a single bus; a module in another process has a bus of its own that nobody else posts to
+  * Bus and its endpoints are never freed, so one module may unload while the other still posts to it
+  */
+class EventBus
+{
+  public:
+
+    /**
+      * Layout of the bus, its endpoints and messages, raised with every change of them
+      * A module built against another layout than the library does not use the bus
+      */
+    enum { Version = 2 };
+
+    enum {
+        QueueSize = 64,     // events waiting for one endpoint, power of two
+        MaxEndpoints = 4
+    };
+
+    struct Message {
+        std::string event;
+        AL::ALValue value;
+    };
+
+    /**
+      * Events of one module, queued by any thread and taken by the single thread of the module
+      */
+    class Endpoint
+    {
+      public:
+        Endpoint(const std::string &module, const std::vector<std::string> &events);
+
+        const std::string &module() const;
+
+        /**
+          * Endpoint receives the event
+          */
+        bool wants(const std::string &event) const;
+
+        /**
+          * Queues the message, returns false if the endpoint is closed or its queue is full
+          */
+        bool push(const Message &message);
+
+        /**
+          * Waits for the next message, returns false once the endpoint is closed
+          */
+        bool wait(Message &message);
+
+        /**
+          * Opens the endpoint, messages queued before are dropped
+          */
+        void open();
+
+        /**
+          * Closes the endpoint and wakes the thread waiting on it
+          */
+        void close();
+
+      private:
+        std::string name;
+        std::vector<std::string> events;
+        RingBuffer<Message, QueueSize> queue;
+        volatile int accepting;
+        volatile int producers;
+        volatile int sleeping;
+        boost::mutex mutex;
+        boost::condition_variable condition;
+    };
+
+    /**
+      * Bus of the process, created by the first module asking for it, 0 if the module was built against another
+      * layout of the bus than the library
+      */
+    static EventBus *find() {
+        return instance(Version, sizeof(EventBus), sizeof(Endpoint), sizeof(Message));
+    }
+
+    /**
+      * Endpoint of the module receiving the given events, opened
+      * Module attaching again gets its endpoint back, with the events it was created with
+      * Returns 0 if the bus has no room for another module
+      */
+    Endpoint *attach(const std::string &module, const std::vector<std::string> &events);
+
+    /**
+      * Queues the event to every open endpoint receiving it, returns the number of endpoints it was queued to
+      */
+    int post(const std::string &event, const AL::ALValue &value);
+
+  private:
+    EventBus();
+
+    /**
+      * Bus of the library, the layout the caller was compiled with is checked against its own
+      */
+    static EventBus *instance(int version, std::size_t busSize, std::size_t endpointSize, std::size_t messageSize);
+
+    /**
+      * Guards attaching, posting reads the endpoints without it
+      */
+    boost::mutex mutex;
+    Endpoint *volatile endpoints[MaxEndpoints];
+
+    EventBus(const EventBus &);
+    EventBus &operator=(const EventBus &);
+};
+
+#endif
@@ -0,0 +1,130 @@
+#ifndef EVENT_DISPATCHER_H
+#define EVENT_DISPATCHER_H
+
+#include "eventbus.hpp"
+#include "eventgate.hpp"
+#include "latencyhistogram.hpp"
+#include "remotetransport.hpp"
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include <map>
+#include <string>
+#include <vector>
+
+/**
+  * Routes ALMemory events to module handlers, shared by Logger and Interface modules
+  * Each event is subscribed once and stays subscribed for the whole session,
+  * re-entry of the handlers is resolved on the module side by an EventGate per event
+  * Once connected to the EventBus, events raised by a module in the same process also arrive through the bus,
+  * and the copy of such an event arriving later through ALMemory is dropped
+  */
+class EventDispatcher
+{
+  public:
+    typedef EventGate<AL::ALValue> Gate;
+
+    /**
+      * Handler receives the value the event was raised with
+      */
+    typedef boost::function<void (const AL::ALValue &)> Handler;
+
+    /**
+      * Where a dispatched event came from
+      */
+    enum Source { Memory, Bus };
+
+    /**
+      * Dispatcher subscribing the given module to events and raising its events through the transport
+      * Latencies of the callbacks and of subscribing are added to the given histograms, if any
+      */
+    EventDispatcher(boost::shared_ptr<RemoteTransport> transport, const std::string &moduleName,
+                    LatencyHistograms *latencies = 0);
+
+    /**
+      * Destructor, disconnects from the bus
+      */
+    ~EventDispatcher();
+
+    /**
+      * Registers the handler of the event, callback is the bound module method ALMemory calls
+      * Latency of the callback is recorded under the name of the callback
+      */
+    void add(const std::string &event, const std::string &callback, const Handler &handler, Gate::Policy policy);
+
+    /**
+      * Subscribes to the event unless already subscribed and confirmed by the transport
+      */
+    void subscribe(const std::string &event);
+
+    /**
+      * Unsubscribes from the event if subscribed, or if the transport still has it subscribed
+      */
+    void unsubscribe(const std::string &event);
+
+    /**
+      * Runs the handler of the event, called from the module callbacks
+      * Handler errors are logged and never leave the event unsubscribed
+      * Events from the bus are only handled while subscribed, as ALMemory only delivers them then
+      */
+    void dispatch(const std::string &event, const AL::ALValue &value, Source source = Memory);
+
+    /**
+      * Connects to the bus of the process, the given events then also arrive through it on a thread of the dispatcher
+      * Returns false if the bus can not be used, events keep coming through ALMemory only
+      */
+    bool connect(const std::vector<std::string> &events);
+
+    /**
+      * Closes the bus endpoint and waits for the event being handled, called before the module is torn down
+      */
+    void disconnect();
+
+    /**
+      * Raises the event, posting it on the bus first if connected, then through ALMemory for everyone else
+      */
+    void raise(const std::string &event, const AL::ALValue &value);
+
+  private:
+    struct Route {
+        std::string callback;
+        Handler handler;
+        boost::shared_ptr<Gate> gate;
+        bool subscribed;        // asked for, the transport tells whether ALMemory made it
+        LatencyHistogram *latency;
+        /**
+          * Last timed value handled from one source and not yet seen from the other
+          */
+        AL::ALValue echo;
+        Source echoSource;
+        bool echoPending;
+    };
+
+    Route *find(const std::string &event);
+
+    /**
+      * Bus thread loop, dispatches the events of the endpoint
+      */
+    void receive();
+
+    boost::shared_ptr<RemoteTransport> transport;
+    std::string moduleName;
+    LatencyHistograms *latencies;
+    LatencyHistogram *subscribeLatency;
+    LatencyHistogram *unsubscribeLatency;
+    LatencyHistogram *postLatency;
+
+    EventBus *bus;
+    EventBus::Endpoint *endpoint;
+    std::vector<std::string> busEvents;
+    boost::thread busThread;
+
+    /**
+      * Guards the routing table and subscription state, never held while a handler runs
+      */
+    boost::mutex mutex;
+    std::map<std::string, Route> routes;
+};
+
+#endif
@@ -0,0 +1,105 @@
+#ifndef EVENT_GATE_H
+#define EVENT_GATE_H
+
+#include <boost/thread/mutex.hpp>
+#include <deque>
+
+/**
+  * Protects an event handler from being re-entered while it runs
+  * The first event to arrive owns the handler, events arriving meanwhile are handled by the owner
+  * according to the policy of the gate, so the handler never runs twice at the same time
+  */
+template <typename Value>
+class EventGate
+{
+  public:
+
+    /**
+      * What happens with an event arriving while the handler runs
+      * Drop - event is ignored
+      * Coalesce - only the latest of such events is handled, after the handler returns
+      * Queue - every such event is handled in order of arrival, up to the queue limit
+      */
+    enum Policy { Drop, Coalesce, Queue };
+
+    EventGate(Policy p = Drop, std::size_t limit = 64) :
+        policy(p), queueLimit(limit), busy(false), handledCount(0), droppedCount(0), coalescedCount(0) {
+    }
+
+    /**
+      * Called when an event arrives, returns true if the caller now owns the handler
+      * Otherwise the event is dropped, coalesced or queued for the current owner
+      */
+    bool enter(const Value &value) {
+        boost::mutex::scoped_lock lock(mutex);
+        if( !busy ) {
+            busy = true;
+            ++handledCount;
+            return true;
+        }
+        if( policy == Coalesce && !pending.empty() ) {
+            pending.back() = value;
+            ++coalescedCount;
+        }
+        else if( policy != Drop && pending.size() < queueLimit ) {
+            pending.push_back(value);
+        }
+        else {
+            ++droppedCount;
+        }
+        return false;
+    }
+
+    /**
+      * Called by the owner after handling an event
+      * Returns true with the next event to handle, or releases the handler and returns false
+      */
+    bool next(Value &value) {
+        boost::mutex::scoped_lock lock(mutex);
+        if( pending.empty() ) {
+            busy = false;
+            return false;
+        }
+        value = pending.front();
+        pending.pop_front();
+        ++handledCount;
+        return true;
+    }
+
+    /**
+      * Releases the handler and forgets the events waiting for it
+      */
+    void reset() {
+        boost::mutex::scoped_lock lock(mutex);
+        droppedCount += pending.size();
+        pending.clear();
+        busy = false;
+    }
+
+    unsigned long handled() {
+        boost::mutex::scoped_lock lock(mutex);
+        return handledCount;
+    }
+
+    unsigned long dropped() {
+        boost::mutex::scoped_lock lock(mutex);
+        return droppedCount;
+    }
+
+    unsigned long coalesced() {
+        boost::mutex::scoped_lock lock(mutex);
+        return coalescedCount;
+    }
+
+  private:
+    boost::mutex mutex;
+    Policy policy;
+    std::size_t queueLimit;
+    bool busy;
+    std::deque<Value> pending;
+    unsigned long handledCount;
+    unsigned long droppedCount;
+    unsigned long coalescedCount;
+};
+
+#endif
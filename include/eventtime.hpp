@@ -0,0 +1,30 @@
+#ifndef EVENT_TIME_H
+#define EVENT_TIME_H
+
+#include "monotonictime.hpp"
+#include <alvalue/alvalue.h>
+
+/**
+  * Value of an event carrying the time at which it happened, [value, seconds, nanoseconds] of the monotonic clock
+  * Receiver uses the time the event happened instead of the time it was delivered
+  */
+AL::ALValue timedEventValue(int value, long long time);
+
+/**
+  * Value of the event, whether it carries its time or not
+  */
+int eventValue(const AL::ALValue &value);
+
+/**
+  * Oldest time an event is believed to carry, in milliseconds before it was received
+  */
+enum { MaxEventAge = 60000 };
+
+/**
+  * Time the event happened, or received if the value does not carry it
+  * Time later than received, or older than MaxEventAge, is taken from the clock of another computer,
+  * as when the sender is a remote module, and received is returned instead
+  */
+long long eventTime(const AL::ALValue &value, long long received);
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef FACE_PRESENCE_H
+#define FACE_PRESENCE_H
+
+/**
+  * Joins face observations into continuous presence intervals
+  * Face is considered present until no frame with a face is seen for longer than the gap tolerance
+  * All times are in milliseconds from the start of the session
+  */
+class FacePresenceTracker
+{
+  public:
+
+    /**
+      * Continuous interval of face presence
+      */
+    struct Interval {
+        long long start;
+        long long end;
+        int frames;
+    };
+
+    FacePresenceTracker(long long gapTolerance = 500);
+
+    /**
+      * Forgets the open interval, used at the start of the session
+      */
+    void reset();
+
+    /**
+      * Adds a frame with a face seen at the given time
+      * Returns true if the gap since the previous frame closed the previous interval, which is stored in closed
+      */
+    bool addFace(long long time, Interval &closed);
+
+    /**
+      * Tells the tracker no face was seen until the given time
+      * Returns true if the open interval is now closed, the interval is stored in closed
+      */
+    bool advance(long long time, Interval &closed);
+
+    /**
+      * Closes the open interval, if there is one, used at the end of the session
+      */
+    bool flush(Interval &closed);
+
+    /**
+      * Number of frames in the currently open interval, 0 if the face is not present
+      */
+    int frames() const;
+
+  private:
+    long long gap;
+    bool present;
+    Interval current;
+};
+
+#endif
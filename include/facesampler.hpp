@@ -0,0 +1,87 @@
+#ifndef FACE_SAMPLER_H
+#define FACE_SAMPLER_H
+
+#include "deadlinescheduler.hpp"
+#include "latencyhistogram.hpp"
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include <alproxies/almemoryproxy.h>
+#include <vector>
+
+/**
+  * Reads the FaceDetected key at a fixed rate instead of reacting to every FaceDetected event
+  * Frames already seen, recognised by their timestamp, are dropped
+  * New frames are handed over in batches, so the response logic runs a few times a second at most
+  */
+class FaceSampler
+{
+  public:
+
+    /**
+      * Receives the monotonic times at which new frames with a face were sampled, and the time of the batch
+      */
+    typedef boost::function<void (const std::vector<long long> &faces, long long now)> BatchHandler;
+
+    /**
+      * Latency of reading FaceDetected is recorded in readLatency, if given
+      */
+    FaceSampler(boost::shared_ptr<AL::ALMemoryProxy> memoryProxy, LatencyHistogram *readLatency = 0);
+
+    /**
+      * Starts sampling at rate samples per second, handing over a batch every batchInterval milliseconds
+      */
+    void start(int rate, unsigned int batchInterval, const BatchHandler &handler);
+
+    /**
+      * Stops sampling and hands over the frames sampled since the last batch
+      * Must not be called while holding a lock the batch handler takes
+      */
+    void stop();
+
+    /**
+      * Number of reads of the FaceDetected key since the last start
+      */
+    unsigned long samples() const;
+
+    /**
+      * Number of new frames with a face since the last start
+      */
+    unsigned long frames() const;
+
+    /**
+      * CPU time spent sampling since the last start, in nanoseconds
+      */
+    long long cpuTime() const;
+
+  private:
+    /**
+      * One sample, run by the scheduler, returns the time of the next one
+      */
+    long long sample();
+
+    boost::shared_ptr<AL::ALMemoryProxy> memoryProxy;
+    LatencyHistogram *readLatency;
+    BatchHandler handler;
+    long long period;
+    long long batchPeriod;
+    long long nextSample;
+    long long nextBatch;
+
+    /**
+      * Timestamp of the last frame, as stored in FaceDetected
+      */
+    int lastSeconds;
+    int lastMicroseconds;
+
+    std::vector<long long> faces;
+    unsigned long sampleCount;
+    unsigned long frameCount;
+    long long cpuNanoseconds;
+
+    /**
+      * Declared last so the worker is stopped before the rest of the object is destroyed
+      */
+    DeadlineScheduler scheduler;
+};
+
+#endif
@@ -0,0 +1,166 @@
+#ifndef FEATURE_STORE_H
+#define FEATURE_STORE_H
+
+#include "logrecord.hpp"
+#include <cstddef>
+#include <fstream>
+#include <string>
+#include <vector>
+
+/**
+  * Columnar store of the sound classification features of one session
+  *
+  * Header, 64 bytes:
+  *   "RTNF" magic, format version (1 byte), 3 reserved bytes, byte order mark 0x01020304 (4 bytes),
+  *   number of feature columns (4 bytes), rows per chunk (4 bytes), session start as seconds since the epoch (8 bytes),
+  *   zero padding
+  * Chunk, every chunk has the same size whether it is full or not:
+  *   number of rows in the chunk (4 bytes), zero padding to 64 bytes,
+  *   timestamp column (8 byte integers, milliseconds from the start of the session),
+  *   class column (1 byte integers, -1 unknown, 0 inarticulate, 1 articulate),
+  *   one column of 4 byte floats per feature
+  * Every column holds rows per chunk values and starts 64 bytes aligned, values are in the byte order of the robot
+  * so a mapped store is read in place
+  */
+enum { FeatureStoreVersion = 1 };
+enum { FeatureStoreHeaderSize = 64 };
+enum { FeatureStoreChunkRows = 256 };
+
+/**
+  * Size of one chunk of a store with the given number of feature columns
+  */
+std::size_t featureStoreChunkSize(int featureCount, int chunkRows);
+
+/**
+  * Writes the feature records of a session, one row per record
+  * Number of feature columns is taken from the first record, missing features are stored as NaN
+  * Not thread safe, used from the log writer thread only
+  */
+class FeatureStoreWriter
+{
+  public:
+    FeatureStoreWriter();
+
+    /**
+      * Destructor, writes out the last chunk
+      */
+    ~FeatureStoreWriter();
+
+    /**
+      * Opens a new store, nothing is written before the first row
+      */
+    bool open(const std::string &filename, long long sessionStart);
+
+    /**
+      * Appends the features of a LogSoundFeatures record, the value of the record is its class
+      */
+    void append(const LogRecord &record);
+
+    /**
+      * Writes the rows of the current chunk appended since the last flush, so they survive a crash
+      */
+    void flush();
+
+    /**
+      * Writes out the last chunk and closes the store
+      */
+    void close();
+
+    /**
+      * Number of rows written to the store opened last
+      */
+    unsigned long rows() const;
+
+  private:
+    /**
+      * Writes the header once the number of columns is known
+      */
+    void writeHeader();
+
+    /**
+      * Writes the values of the rows appended since the last flush of the column at the given offset in the chunk
+      */
+    void writeRows(std::streamoff base, std::size_t column, std::size_t width, unsigned int row);
+
+    std::ofstream file;
+    long long start;
+    int featureCount;
+    std::vector<char> chunk;
+    unsigned int chunkRows;
+    unsigned long chunkIndex;
+    unsigned long rowCount;
+    unsigned int flushedRows;   // rows of the current chunk already written
+};
+
+/**
+  * Memory maps a feature store and returns its columns in place
+  */
+class FeatureStoreReader
+{
+  public:
+    /**
+      * Values of one column of one chunk
+      */
+    template <typename T>
+    struct Column {
+        const T *data;
+        std::size_t size;
+    };
+
+    FeatureStoreReader();
+
+    /**
+      * Destructor, unmaps the store
+      */
+    ~FeatureStoreReader();
+
+    /**
+      * Maps the store, returns false with the reason in error if it can not be read
+      * Chunk cut off at the end of the store, left by a crash, is ignored
+      */
+    bool open(const std::string &path, std::string &error);
+
+    void close();
+
+    int featureCount() const;
+    long long sessionStart() const;
+    std::size_t chunks() const;
+    std::size_t rows() const;
+
+    Column<long long> timestamps(std::size_t chunk) const;
+    Column<signed char> classes(std::size_t chunk) const;
+    Column<float> feature(std::size_t chunk, int column) const;
+
+  private:
+    FeatureStoreReader(const FeatureStoreReader &);
+    FeatureStoreReader &operator=(const FeatureStoreReader &);
+
+    const char *chunkData(std::size_t chunk) const;
+
+    const char *data;
+    std::size_t size;
+    int features;
+    int chunkRows;
+    long long start;
+    std::size_t chunkCount;
+    std::size_t rowCount;
+};
+
+/**
+  * Statistics of one feature column over the whole store
+  */
+struct FeatureStatistics {
+    std::size_t count;
+    double mean;
+    double deviation;
+    float min;
+    float max;
+};
+
+/**
+  * Statistics of the feature over the rows of the given class, or over every row if soundClass is below -1
+  * NaN values are skipped
+  */
+FeatureStatistics featureStatistics(const FeatureStoreReader &store, int column, int soundClass = -2);
+
+#endif
@@ -0,0 +1,137 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include "logrecord.hpp"
+#include <boost/shared_ptr.hpp>
+#include <alvalue/alvalue.h>
+#include <string>
+#include <vector>
+
+/**
+  * Histogram of latencies in microseconds with log-linear buckets
+  * Every power of two is split into SubBuckets equal buckets, so the relative error stays below 1/SubBuckets
+  * Updated with atomic builtins only, so it can be recorded into from any callback without locking
+  */
+class LatencyHistogram
+{
+  public:
+
+    /**
+      * Linear buckets in each power of two, values below SubBuckets have a bucket each
+      */
+    enum { SubBuckets = 8 };
+
+    /**
+      * Buckets up to 2^30 microseconds, longer latencies are counted in the last bucket
+      */
+    enum { Buckets = SubBuckets + 28*SubBuckets };
+
+    /**
+      * Copy of the histogram at one moment
+      */
+    struct Snapshot {
+        unsigned long count;
+        long long sum;
+        long long max;
+        unsigned long buckets[Buckets];
+
+        double mean() const;
+
+        /**
+          * Upper bound of the bucket holding the given fraction of the latencies
+          */
+        double percentile(double fraction) const;
+    };
+
+    LatencyHistogram();
+
+    /**
+      * Records one latency given in nanoseconds
+      */
+    void record(long long nanoseconds);
+
+    /**
+      * Copies the histogram, reset clears every copied count
+      */
+    void snapshot(Snapshot &snapshot, bool reset = false);
+
+    /**
+      * Bucket of a latency in microseconds
+      */
+    static std::size_t bucketOf(long long microseconds);
+
+    /**
+      * Largest latency in microseconds counted in the bucket
+      */
+    static long long bucketLimit(std::size_t bucket);
+
+    /**
+      * Monotonic time in nanoseconds, the clock latencies are measured with
+      */
+    static long long now();
+
+  private:
+    volatile unsigned long counts[Buckets];
+    volatile unsigned long total;
+    volatile long long sum;
+    volatile long long maximum;
+};
+
+/**
+  * Measures the latency of the enclosing scope
+  */
+class ScopedLatency
+{
+  public:
+    ScopedLatency(LatencyHistogram &histogram) : histogram(histogram), start(LatencyHistogram::now()) {
+    }
+
+    ~ScopedLatency() {
+        histogram.record(LatencyHistogram::now() - start);
+    }
+
+  private:
+    LatencyHistogram &histogram;
+    long long start;
+};
+
+/**
+  * Named histograms of a module, one for each callback and each proxy call
+  * Histograms are added while the module is set up, afterwards the set is only read
+  */
+class LatencyHistograms
+{
+  public:
+
+    /**
+      * Adds a new histogram with the given name
+      */
+    LatencyHistogram &add(const std::string &name);
+
+    /**
+      * Adds a histogram owned by another object, which must outlive the set
+      */
+    void attach(const std::string &name, LatencyHistogram &histogram);
+
+    /**
+      * Snapshot of every histogram as [name, count, sum, max, [[limit, count], ...]] with times in microseconds,
+      * only buckets with a count are included
+      */
+    AL::ALValue toALValue(bool reset = false);
+
+    /**
+      * Summary of every histogram that has a count, as LT records of the session log
+      */
+    std::vector<LogRecord> toLogRecords(long long timestamp);
+
+  private:
+    struct Entry {
+        std::string name;
+        LatencyHistogram *histogram;
+    };
+
+    std::vector<Entry> entries;
+    std::vector<boost::shared_ptr<LatencyHistogram> > owned;
+};
+
+#endif
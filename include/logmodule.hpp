@@ -43,14 +43,14 @@ class ResponseToNameLogger : public AL::ALModule
       * This method will be called every time the event FaceDetected is raised
       * Each occurence of the face will be logged
       */
-    void onFaceDetected();
+    void onFaceDetected(const std::string &key, const AL::ALValue &value, const AL::ALValue &msg);
 
     /**
       * This method will be called when StartSession event is raised
       * Logger will be configured for a new session by setting new output file and resetting internal variables
       * Scheduler thread will be started
       */
-    void onStartLogger();
+    void onStartLogger(const std::string &key, const AL::ALValue &value, const AL::ALValue &msg);
 
     /**
       * This method will be called when EndSession event is raised
@@ -69,7 +69,66 @@ class ResponseToNameLogger : public AL::ALModule
       */
     void onSoundClassified(const std::string &key, const AL::ALValue &value, const AL::ALValue &msg);
 
+    /**
+      * This method will be called by ALAudioDevice with every buffer of the microphones while the Logger
+      * classifies sounds itself and is subscribed to it
+      * Sounds are classified as articulated or not and logged as SoundClassified is
+      */
+    void processRemote(const int &nbOfChannels, const int &nbOfSamplesByChannel, const AL::ALValue &timeStamp, const AL::ALValue &buffer);
+
+    /**
+      * Sets a Logger parameter, new value is used from the next session on
+      * logFormat - "text" for the tab-separated log, "binary" for the compact binary log
+      * faceSampling - rate in Hz at which FaceDetected is sampled, each interval of face presence is logged once
+      *                0 handles and logs every FaceDetected event
+      * logDirectory - folder the session logs are written to, /home/nao/naoqi/modules/logs/ by default
+      * featureStore - true to also write sound features to a columnar store (*.rtnf) next to the log, the default
+      * segmentSize - size in MB the log segments are preallocated to, 8 by default
+      * durability - "none" leaves syncing to the kernel, "periodic" syncs every 5 seconds and at the end of the session,
+      *              "session" syncs at the end of the session only, the default
+      * protocol - "study" or the path of a protocol file
+      * responseDwell - milliseconds a face has to stay after a call to count as a response, 0 by default
+      * responseGap - longest gap in milliseconds between frames of a face that stays, 500 by default
+      * responseWindow - milliseconds after a call in which faces are counted, 0 by default counts until the next call
+      * checkpoint - path of the session checkpoint, /home/nao/naoqi/modules/logs/session.rtnc by default, "" for none
+      *              a session left there by a Logger which did not end it is resumed at once
+      * classifier - "external" for the sound classification module, the default, "internal" to classify sounds
+      *              in the Logger from the buffers of ALAudioDevice, with the same thresholds
+      * metricsRate - highest rate in Hz the metrics of the session are published to ALMemory at while they change,
+      *               2 by default, 0 publishes none; keys are under ResponseToName/
+      */
+    void setParameter(const std::string &name, const AL::ALValue &value);
+
+    /**
+      * Latency histograms of every callback and proxy call of the module, cleared if reset is true
+      * Each histogram is [name, count, sum, max, [[limit, count], ...]] with times in microseconds
+      */
+    AL::ALValue getLatencyHistograms(const bool &reset);
+
+    /**
+      * State of the session as last published, read without waiting for the callbacks or the scheduler
+      * [session number, active, calls made, faces since the last call, last face and last call end in ms
+      * of session time, protocol ended the session]
+      */
+    AL::ALValue getSessionState();
+
   private:
+    /**
+      * Event handlers, run by the event dispatcher which makes sure none of them is re-entered
+      * Starting and ending sessions are serialized by the callback mutex, the other handlers only
+      * enter the session state, so no event waits for an event of another kind
+      */
+    void faceDetected(const AL::ALValue &face);
+    void startLogger(const AL::ALValue &value);
+    void stopLogger(const AL::ALValue &value);
+    void childCalled(const AL::ALValue &value);
+    void soundClassified(const AL::ALValue &value);
+
+    /**
+      * Resumes the session left in the checkpoint, called once the module is set up and when the checkpoint changes
+      */
+    void resumeSession();
+
     /**
       * Object implementation
       */
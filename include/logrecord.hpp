@@ -0,0 +1,86 @@
+#ifndef LOG_RECORD_H
+#define LOG_RECORD_H
+
+#include <cstddef>
+
+/**
+  * Events written to the session log, each one is written with its two letter identifier
+  */
+enum LogEvent
+{
+  LogFaceDetected,      // FD
+  LogCallStarted,       // CS
+  LogPhraseStarted,     // PS
+  LogCallEnded,         // CE
+  LogSessionEnded,      // SE
+  LogSoundClassified,   // SC with the class of the sound
+  LogSoundFeatures,     // SC with the features extracted by sound classification
+  LogFaceInterval,      // FD covering a whole interval of face presence, value is the number of frames
+  LogLatency,           // LT summary of a latency histogram, value is the number of latencies
+  LogSummary,           // SM summary of the session metrics, value is the outcome of the session
+  LogEventCount
+};
+
+/**
+  * Fixed-size log record, pushed by the callbacks without locking or allocating
+  */
+struct LogRecord
+{
+  /**
+    * Maximum number of sound classification features kept in a record
+    */
+  enum { MaxFeatures = 32 };
+
+  /**
+    * Longest line a single record can be formatted to
+    */
+  enum { MaxLineLength = 1024 };
+
+  /**
+    * Longest name a latency record can carry, including the terminating zero
+    */
+  enum { MaxNameLength = 32 };
+
+  unsigned char event;
+  unsigned char featureCount;
+  int value;
+  /**
+    * Microseconds from the start of the session
+    */
+  long long timestamp;
+  /**
+    * Length of the interval in milliseconds, only used by interval records
+    */
+  int duration;
+  /**
+    * Sound features, mean, median, 90th and 99th percentile and maximum of a latency record in microseconds,
+    * or the session metrics of a summary record
+    */
+  float features[MaxFeatures];
+  /**
+    * Name of the histogram of a latency record, or the class of a feature record as sound classification reported it
+    */
+  char name[MaxNameLength];
+};
+
+/**
+  * Two letter identifier of the event
+  */
+const char *logEventName(LogEvent event);
+
+/**
+  * Formats the record as a tab-separated line of the session log
+  * Returns the number of characters written, never more than size - 1
+  */
+std::size_t formatLogRecord(const LogRecord &record, char *buffer, std::size_t size);
+
+/**
+  * Formats the record as a line of the text log the Logger wrote before the binary format, the layout of the
+  * analysis scripts: times in seconds cut to the millisecond as streams print them, feature lines as the ALValue
+  * raised by sound classification
+  * Face intervals are written as a single FD line at their start with the number of frames as the value,
+  * latency and summary records have no such line, 0 is returned for them
+  */
+std::size_t formatLegacyLogRecord(const LogRecord &record, char *buffer, std::size_t size);
+
+#endif
@@ -0,0 +1,152 @@
+#ifndef LOG_STORAGE_H
+#define LOG_STORAGE_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/**
+  * Storage of the session logs, sessions are appended one after another to preallocated segment files
+  *
+  * Every session gets an ID one greater than the last one in the index, so IDs never repeat in a log directory
+  * Segments are named segment_NNNNNN.rtns and preallocated to the segment size, so writing a session
+  * only fills blocks that are already allocated; a session starts a new segment once the current one is full
+  * Index file sessions.idx has one tab-separated line per change of a session:
+  *   id, session start in seconds since the epoch, segment, byte offset in the segment, length in bytes or - while in progress
+  * The last line of a session is the one that counts, a session without a length did not end
+  */
+class LogStorage
+{
+  public:
+    /**
+      * When written data is forced to the storage
+      * NoSync leaves it to the kernel, PeriodicSync syncs every sync interval and at the end of the session,
+      * SessionSync only at the end of the session
+      */
+    enum Durability { NoSync, PeriodicSync, SessionSync };
+
+    enum { DefaultSegmentSize = 8*1024*1024 };
+
+    struct Session {
+        unsigned long id;
+        long long start;
+        unsigned long segment;
+        unsigned long long offset;
+        unsigned long long length;
+        bool complete;
+    };
+
+    LogStorage();
+
+    /**
+      * Destructor, ends the session in progress
+      */
+    ~LogStorage();
+
+    /**
+      * Sets the directory and policy, used from the next session on
+      */
+    void configure(const std::string &directory, unsigned long long segmentSize = DefaultSegmentSize,
+                   Durability durability = SessionSync, unsigned int syncInterval = 5000);
+
+    /**
+      * Reads the index and opens the segment the next session is written to, preallocating it,
+      * so the next session begins without touching the storage beyond the index
+      * Returns false if the storage can not be written
+      */
+    bool prepare();
+
+    /**
+      * Starts a new session, returns false if the storage can not be written
+      */
+    bool begin(long long sessionStart);
+
+    /**
+      * Continues the session left in progress by a process which ended without ending it,
+      * writing after the given length of its log, which must not have been followed by another session
+      * Returns false if the session is not the last one of the index or the storage can not be written
+      */
+    bool resume(const Session &session, unsigned long long length);
+
+    /**
+      * Appends data to the session in progress
+      */
+    bool write(const char *data, std::size_t length);
+
+    /**
+      * Called after each batch is written, syncs if the policy says it is time to
+      */
+    void flush();
+
+    /**
+      * Ends the session in progress, syncs it as the policy says and records its length in the index
+      */
+    void end();
+
+    /**
+      * Session in progress, or the one ended last
+      */
+    const Session &session() const;
+
+    /**
+      * Path of a file in the log directory, e.g. of a file belonging to the session
+      */
+    std::string path(const std::string &name) const;
+
+    /**
+      * Number of times data was synced since the storage was created
+      */
+    unsigned long syncs() const;
+
+    /**
+      * Name of the files of a session, session_NNNNNN
+      */
+    static std::string sessionName(unsigned long id);
+
+    static std::string segmentName(unsigned long segment);
+
+    static const char *IndexName;
+
+    /**
+      * Reads the sessions listed in the index of the directory, one entry per session in the order of their IDs
+      * Returns false if the directory has no index
+      */
+    static bool readIndex(const std::string &directory, std::vector<Session> &sessions);
+
+  private:
+    LogStorage(const LogStorage &);
+    LogStorage &operator=(const LogStorage &);
+
+    /**
+      * Finds where the last run left off, the next ID and the segment to continue
+      */
+    void recover();
+
+    bool openSegment(unsigned long segment, unsigned long long offset);
+
+    /**
+      * Opens the file of the log directory with the given flags, creating it and syncing the directory if it is new
+      */
+    int openFile(const std::string &file, int flags);
+    void closeSegment();
+    bool appendIndex(const Session &entry);
+    void sync(int fd);
+
+    std::string directory;
+    unsigned long long segmentSize;
+    Durability durability;
+    long long syncInterval;     // nanoseconds
+
+    int segmentFd;
+    unsigned long segment;
+    unsigned long long segmentEnd;
+    int indexFd;
+    unsigned long nextId;
+    bool recovered;
+    bool active;
+    Session current;
+    long long lastSync;         // monotonic time
+    unsigned long syncCount;
+};
+
+#endif
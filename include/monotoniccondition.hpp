@@ -0,0 +1,36 @@
+#ifndef MONOTONIC_CONDITION_H
+#define MONOTONIC_CONDITION_H
+
+#include <boost/noncopyable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <pthread.h>
+
+/**
+  * Condition variable waiting on the monotonic clock, used with a boost mutex
+  * Boost conditions wait on the wall clock, so a step of the wall clock would move a deadline; waiting on
+  * the monotonic clock a thread sleeps until its deadline in a single wait, however far away it is
+  */
+class MonotonicCondition : private boost::noncopyable
+{
+  public:
+    MonotonicCondition();
+    ~MonotonicCondition();
+
+    void notify_one();
+    void notify_all();
+
+    /**
+      * Waits until notified, the lock must be held
+      */
+    void wait(boost::mutex::scoped_lock &lock);
+
+    /**
+      * Waits until notified or until the monotonic time in nanoseconds, returns false once the time passed
+      */
+    bool waitUntil(boost::mutex::scoped_lock &lock, long long deadline);
+
+  private:
+    pthread_cond_t condition;
+};
+
+#endif
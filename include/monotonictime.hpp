@@ -0,0 +1,18 @@
+#ifndef MONOTONIC_TIME_H
+#define MONOTONIC_TIME_H
+
+#include <time.h>
+
+/**
+  * Time of the monotonic clock in nanoseconds, every time the modules measure is taken from this clock
+  * Clock is not stepped when the wall clock is set, and reads the same in every process on the robot,
+  * so times taken by the Logger and the Interface line up
+  * Read through the vDSO, without a system call, so it is cheap enough for every callback
+  */
+inline long long monotonicTime() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec*1000000000LL + ts.tv_nsec;
+}
+
+#endif
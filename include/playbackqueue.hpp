@@ -0,0 +1,80 @@
+#ifndef PLAYBACK_QUEUE_H
+#define PLAYBACK_QUEUE_H
+
+#include "latencyhistogram.hpp"
+#include "soundbank.hpp"
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
+#include <deque>
+
+/**
+  * Plays the calls on a worker thread, so the callback requesting a call returns at once
+  * Calls are played one after another in the order they were requested
+  */
+class PlaybackQueue
+{
+  public:
+    /**
+      * Reports a call with the value it was requested with and the monotonic time the player accepted it or it ended
+      * Time a call is reported as started is its dispatch time, the player needs a little longer to play its first sample
+      * Called from the worker thread without any queue lock held
+      */
+    typedef boost::function<void (int value, long long time)> Notify;
+
+    /**
+      * Worker is created lazily on the first call
+      * Latency of posting the call to the player is recorded in postLatency, the time from queueing a call to its dispatch
+      * in the given histograms
+      */
+    PlaybackQueue(boost::shared_ptr<SoundBank> sounds, const Notify &started, const Notify &finished,
+                  LatencyHistograms *latencies = 0, LatencyHistogram *postLatency = 0);
+
+    /**
+      * Destructor, stops the call being played and joins the worker
+      */
+    ~PlaybackQueue();
+
+    /**
+      * Queues the call and returns without waiting for it to be played
+      */
+    void push(SoundBank::Sound sound, int value);
+
+    /**
+      * Drops the queued calls and stops the one being played, none of them is reported as finished
+      */
+    void cancel();
+
+  private:
+    struct Call {
+        SoundBank::Sound sound;
+        int value;
+        long long queued;
+    };
+
+    /**
+      * Worker thread loop
+      */
+    void run();
+
+    boost::shared_ptr<SoundBank> sounds;
+    Notify started;
+    Notify finished;
+    LatencyHistogram *queueLatency;
+    LatencyHistogram *postLatency;
+
+    boost::mutex mutex;
+    boost::condition_variable condition;
+    boost::thread worker;
+    std::deque<Call> calls;
+
+    /**
+      * Call taken by the worker, its player task once the playback started, -1 before
+      */
+    bool playing;
+    int task;
+    bool cancelled;
+    bool shutdown;
+};
+
+#endif
@@ -0,0 +1,159 @@
+#ifndef REMOTE_TRANSPORT_H
+#define REMOTE_TRANSPORT_H
+
+#include "latencyhistogram.hpp"
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
+#include <alcommon/alproxy.h>
+#include <alproxies/almemoryproxy.h>
+#include <alvalue/alvalue.h>
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+/**
+  * Carries the calls a module makes to ALMemory and other modules
+  * Direct mode makes every call at once and waits for it, as a module loaded into NAOqi does
+  * Batched mode is meant for a module built as a remote binary, where every call is a network round trip:
+  * calls are queued and a sender thread posts them without waiting for the replies, it is not sent as a single
+  * round trip; only a request on an event with a post of the same event still running, or a call to a module
+  * with a call to it still running, waits for that post first, so raises of different events may arrive in
+  * another order than they were raised, each carrying the time it was raised
+  * Subscription changes are made at once by the sender and the state of an event changes only once ALMemory
+  * made the change; changes of an event next to each other, with no raise or call between them, are coalesced
+  * into the last one, which is dropped as well if ALMemory is already in that state
+  */
+class RemoteTransport
+{
+  public:
+    enum Mode { Direct, Batched };
+
+    /**
+      * Transport of the module with the given name, time calls wait in the queue is added to the histograms, if any
+      */
+    RemoteTransport(boost::shared_ptr<AL::ALMemoryProxy> memoryProxy, const std::string &moduleName, Mode mode,
+                    LatencyHistograms *latencies = 0);
+
+    /**
+      * Destructor, sends the queued calls and joins the sender
+      */
+    ~RemoteTransport();
+
+    Mode mode() const;
+    boost::shared_ptr<AL::ALMemoryProxy> memory() const;
+
+    void raiseEvent(const std::string &event, const AL::ALValue &value);
+
+    /**
+      * Subscribes the module to the event with the given callback
+      */
+    void subscribe(const std::string &event, const std::string &callback);
+    void unsubscribe(const std::string &event);
+
+    /**
+      * Calls the method of the module behind the proxy, in batched mode without waiting for it to return
+      */
+    void call(boost::shared_ptr<AL::ALProxy> proxy, const std::string &method);
+    void call(boost::shared_ptr<AL::ALProxy> proxy, const std::string &method, const AL::ALValue &argument);
+
+    /**
+      * Returns once every call queued so far was sent and, in batched mode, finished
+      */
+    void flush();
+
+    /**
+      * Whether ALMemory confirmed the subscription of the module to the event, a failed change leaves it as it was
+      */
+    bool isSubscribed(const std::string &event) const;
+
+    /**
+      * Calls sent, batches the sender took from the queue and subscription changes coalesced away
+      */
+    unsigned long sent() const;
+    unsigned long batches() const;
+    unsigned long coalesced() const;
+
+  private:
+    enum Kind { Raise, Subscribe, Unsubscribe, Call, CallWithArgument };
+
+    struct Request {
+        Kind kind;
+        std::string name;       // event or method
+        std::string callback;
+        AL::ALValue value;      // event value or method argument
+        boost::shared_ptr<AL::ALProxy> proxy;
+        long long queued;
+    };
+
+    void push(const Request &request);
+
+    /**
+      * Event or module a request has to stay in order with, and the proxy and task of the post still running for it
+      */
+    typedef std::pair<AL::ALProxy *, std::string> Order;
+    typedef std::pair<boost::shared_ptr<AL::ALProxy>, int> Task;
+
+    /**
+      * Sender thread loop
+      */
+    void run();
+
+    /**
+      * Posts the request once the post it has to stay in order with finished, drops a subscription change
+      * ALMemory already has
+      */
+    void post(const Request &request);
+
+    /**
+      * Waits for every post still running
+      */
+    void finish();
+
+    /**
+      * Drops the subscription changes of the batch made redundant by a later change of the same event with no raise
+      * or call between them
+      */
+    void coalesce(std::vector<Request> &batch);
+
+    /**
+      * Makes the call at once and returns 0 in direct mode, posts it and returns its task in batched mode,
+      * subscription changes are always made at once
+      */
+    int send(const Request &request);
+
+    /**
+      * Waits for the posted task of the module behind the proxy to finish
+      */
+    void wait(boost::shared_ptr<AL::ALProxy> proxy, int task);
+
+    boost::shared_ptr<AL::ALMemoryProxy> memoryProxy;
+    boost::shared_ptr<AL::ALProxy> memoryTarget;    // ALMemory as a generic proxy, for waiting on its tasks
+    std::string moduleName;
+    Mode transportMode;
+    LatencyHistogram *queueLatency;
+
+    boost::mutex mutex;
+    boost::condition_variable condition;
+    boost::condition_variable idle;
+    boost::thread sender;
+    std::deque<Request> queue;
+    bool sending;
+    bool shutdown;
+    volatile unsigned long sentCount;
+    volatile unsigned long batchCount;
+    volatile unsigned long coalescedCount;
+
+    /**
+      * Posts still running, only used by the sender
+      */
+    std::map<Order, Task> pending;
+
+    /**
+      * Subscription of each event as ALMemory last confirmed it
+      */
+    mutable boost::mutex subscriptionLock;
+    std::map<std::string, bool> subscriptions;
+};
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef RESPONSE_DETECTOR_H
+#define RESPONSE_DETECTOR_H
+
+/**
+  * Decides whether the child responded to the last call from the faces seen after it
+  * Each call opens a window at its end, faces seen in the window are joined into continuous presence
+  * and the child responded once enough faces were seen and the face stayed long enough
+  * Every face is added in constant time, all times are in milliseconds from the start of the session
+  */
+class ResponseDetector
+{
+  public:
+
+    /**
+      * Thresholds of a response, defaults count faces only
+      */
+    struct Thresholds {
+        Thresholds();
+        long long dwell;        // face has to stay this long, counted from the first frame of a presence to its last
+        long long gapTolerance; // longest gap between two frames of the same presence
+        long long window;       // faces are counted this long after the end of the call, 0 until the next call
+    };
+
+    ResponseDetector(const Thresholds &thresholds = Thresholds());
+
+    /**
+      * Starts a new session, no window is open until the first call ended
+      */
+    void start();
+
+    /**
+      * Call ended at the given time, opens its window
+      * Child responds once the given number of faces were seen in it, 0 never responds
+      */
+    void open(long long callEnd, int faces);
+
+    /**
+      * Next call started, faces are not counted until it ends
+      */
+    void close();
+
+    /**
+      * Frame with a face was seen at the given time
+      */
+    void faceDetected(long long time);
+
+    /**
+      * Child responded in the window of the last call
+      */
+    bool responded() const;
+
+    /**
+      * Milliseconds from the end of the last call to the first face in its window, -1 if there was none
+      */
+    long long firstFaceLatency() const;
+
+    /**
+      * Milliseconds from the end of the last call to the moment the child responded, -1 if it did not
+      */
+    long long responseLatency() const;
+
+    /**
+      * Longest presence of the face in the window so far
+      */
+    long long dwell() const;
+
+    /**
+      * Faces seen in the window so far
+      */
+    int faces() const;
+
+    const Thresholds &thresholds() const;
+
+  private:
+    Thresholds limits;
+    bool opened;
+    long long callEnd;
+    int facesNeeded;
+    int faceCount;
+    long long firstFace;
+    long long presenceStart;
+    long long lastFace;
+    long long longestPresence;
+    long long respondedAt;
+};
+
+#endif
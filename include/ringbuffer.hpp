@@ -0,0 +1,104 @@
+#ifndef RING_BUFFER_H
+#define RING_BUFFER_H
+
+#include <cstddef>
+
+/**
+  * Bounded lock-free multi-producer multi-consumer queue
+  * Each cell carries a sequence number telling whether it is free to write or ready to read,
+  * so producers and consumers only contend on the position they claim with compare-and-swap
+  * Size must be a power of two
+  */
+template <typename T, std::size_t Size>
+class RingBuffer
+{
+  public:
+
+    RingBuffer() : enqueuePos(0), dequeuePos(0) {
+        for( std::size_t i = 0; i < Size; ++i ) {
+            cells[i].sequence = i;
+        }
+    }
+
+    /**
+      * Copies the element into the queue, returns false if the queue is full
+      */
+    bool push(const T &element) {
+        std::size_t pos = enqueuePos;
+        while( true ) {
+            Cell &cell = cells[pos & (Size - 1)];
+            std::size_t sequence = cell.sequence;
+            __sync_synchronize();
+            long diff = static_cast<long>(sequence) - static_cast<long>(pos);
+            if( diff == 0 ) {
+                if( __sync_bool_compare_and_swap(&enqueuePos, pos, pos + 1) ) {
+                    cell.data = element;
+                    __sync_synchronize();
+                    cell.sequence = pos + 1;
+                    return true;
+                }
+            }
+            else if( diff < 0 ) {
+                return false;
+            }
+            pos = enqueuePos;
+        }
+    }
+
+    /**
+      * Moves the oldest element out of the queue, returns false if the queue is empty
+      */
+    bool pop(T &element) {
+        std::size_t pos = dequeuePos;
+        while( true ) {
+            Cell &cell = cells[pos & (Size - 1)];
+            std::size_t sequence = cell.sequence;
+            __sync_synchronize();
+            long diff = static_cast<long>(sequence) - static_cast<long>(pos + 1);
+            if( diff == 0 ) {
+                if( __sync_bool_compare_and_swap(&dequeuePos, pos, pos + 1) ) {
+                    element = cell.data;
+                    __sync_synchronize();
+                    cell.sequence = pos + Size;
+                    return true;
+                }
+            }
+            else if( diff < 0 ) {
+                return false;
+            }
+            pos = dequeuePos;
+        }
+    }
+
+    /**
+      * Approximate number of queued elements
+      */
+    std::size_t size() const {
+        std::size_t tail = dequeuePos;
+        std::size_t head = enqueuePos;
+        return head >= tail ? head - tail : 0;
+    }
+
+    std::size_t capacity() const {
+        return Size;
+    }
+
+  private:
+    struct Cell {
+        volatile std::size_t sequence;
+        T data;
+    };
+
+    // Keep producer and consumer positions on separate cache lines
+    char pad0[64];
+    volatile std::size_t enqueuePos;
+    char pad1[64];
+    volatile std::size_t dequeuePos;
+    char pad2[64];
+    Cell cells[Size];
+
+    RingBuffer(const RingBuffer &);
+    RingBuffer &operator=(const RingBuffer &);
+};
+
+#endif
@@ -0,0 +1,123 @@
+#ifndef SESSION_CHECKPOINT_H
+#define SESSION_CHECKPOINT_H
+
+#include "asynclogwriter.hpp"
+#include "logrecord.hpp"
+#include "logstorage.hpp"
+#include <string>
+#include <vector>
+
+/**
+  * Checkpoint of the Logger session in a small file mapped into memory, so a session survives a restart of NAOqi
+  * Session is saved with plain stores into the mapping and never with a system call, the kernel writes the pages
+  * back to the file, so a process killed at any point leaves its last complete save behind
+  * Two copies of the session are kept, the sequence tells which one was saved last and completely
+  * Checkpoint outlives a restart of the process, not a reboot of the robot, which a resumed session can not survive anyway
+  */
+class SessionCheckpoint
+{
+  public:
+    enum {
+        PathLength = 256,
+        SameBootTolerance = 2000   // milliseconds the wall clock may drift from the monotonic clock between saves
+    };
+
+    /**
+      * Settings the session started with, written once at its start, before it is saved active
+      */
+    struct Settings {
+        char logDirectory[PathLength];
+        char protocolSource[PathLength];
+        int format;                 // AsyncLogWriter::Format of the log
+        int faceSampling;
+        int dwell, gapTolerance, window;
+        unsigned long long segmentSize;
+        int durability;
+        int classifier;             // 1 if the Logger classifies the sounds itself
+    };
+
+    /**
+      * State of the session, times are milliseconds from its start unless noted
+      */
+    struct Session {
+        long long start;            // monotonic time the session started, in nanoseconds
+        long long saved;            // monotonic time of the save, in nanoseconds
+        long long savedWall;        // wall-clock time of the save, in microseconds, tells a restart from a reboot
+        int active;
+        int ended;
+        int stopped;                // session was being stopped, resuming it only ends its log
+        int iteration;
+        int faces;
+        long long lastFace;
+        long long lastCall;
+        int pendingCall;            // CallChildRTN value of the call decided and not ended yet, 0 if none
+        LogStorage::Session log;    // where the log of the session is in the storage
+    };
+
+    /**
+      * State of the calls the resumed session continues from, see reconcile
+      */
+    struct Resumed {
+        int iterations;
+        long long lastCall;
+        bool callPending;           // call was logged and did not end
+        bool ended;                 // end of the session was logged
+        int endValue;
+        long long lastFace;
+        std::vector<long long> faces;   // times of the faces seen since the last call ended
+    };
+
+    SessionCheckpoint();
+
+    /**
+      * Destructor, unmaps the checkpoint
+      */
+    ~SessionCheckpoint();
+
+    /**
+      * Maps the checkpoint file, creating it if it does not exist or holds no checkpoint of this build
+      * Returns false if the file can not be mapped
+      */
+    bool open(const std::string &path);
+    void close();
+    bool isOpen() const;
+    const std::string &path() const;
+
+    /**
+      * Settings of the session, written at its start
+      */
+    Settings &settings();
+
+    void save(const Session &session);
+    Session load() const;
+
+    /**
+      * Session was saved active, since the last boot and no longer than maxAge nanoseconds ago
+      */
+    bool live(long long maxAge) const;
+
+    /**
+      * Position of the session log, stored by the log writer
+      */
+    AsyncLogWriter::Progress &progress();
+
+    /**
+      * Reconciles the saved session with its log as far as it was written
+      * Calls, their ends and the end of the session are taken from the log, so the resumed session continues exactly
+      * what was recorded; faces are taken from the checkpoint when it agrees with the log on the calls, it is saved
+      * before the records reach the log
+      */
+    static Resumed reconcile(const Session &saved, const std::vector<LogRecord> &records);
+
+  private:
+    struct Data;
+
+    Data *data;
+    int fd;
+    std::string filePath;
+
+    SessionCheckpoint(const SessionCheckpoint &);
+    SessionCheckpoint &operator=(const SessionCheckpoint &);
+};
+
+#endif
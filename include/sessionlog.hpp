@@ -0,0 +1,62 @@
+#ifndef SESSION_LOG_H
+#define SESSION_LOG_H
+
+#include "logrecord.hpp"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/**
+  * Reads a whole session log into records, the log can be either text or binary
+  * A session of the log storage is read by the path <directory>/sessions.idx#<id>
+  * File is memory mapped, returns false if it can not be read or is not a session log
+  */
+bool readSessionLog(const std::string &path, std::vector<LogRecord> &records);
+
+/**
+  * Finds the file and the byte range holding the session log, length is -1 if the log is the whole file
+  * Returns false if the session is not in the index or did not end
+  */
+bool locateSessionLog(const std::string &path, std::string &file, unsigned long long &offset, long long &length);
+
+/**
+  * Session log with the file and the byte range holding it, as found by locateSessionLog
+  */
+struct SessionLogLocation {
+    std::string path;
+    std::string file;
+    unsigned long long offset;
+    long long length;
+};
+
+/**
+  * Reads a session log already located, without going through the index again
+  */
+bool readSessionLog(const SessionLogLocation &location, std::vector<LogRecord> &records);
+
+/**
+  * Parses the tab-separated text layout of the session log
+  * Lines which are not session log lines are skipped
+  * Feature lines have no time of their own, they are given the time of the preceding record
+  */
+void parseSessionLogText(const char *begin, const char *end, std::vector<LogRecord> &records);
+
+/**
+  * Parses the binary session log, returns false if the log is corrupt
+  * A record cut off at the end of the log is ignored
+  */
+bool parseSessionLogBinary(const char *begin, const char *end, std::vector<LogRecord> &records);
+
+/**
+  * Lists session logs, text or binary, found in the directory, sorted by name
+  * followed by the sessions of the log storage in the directory which ended, as <directory>/sessions.idx#<id>
+  */
+std::vector<std::string> listSessionLogs(const std::string &directory);
+
+/**
+  * Lists the session logs of the directory in the same order as listSessionLogs, located
+  * The index is read once for the whole directory
+  */
+std::vector<SessionLogLocation> locateSessionLogs(const std::string &directory);
+
+#endif
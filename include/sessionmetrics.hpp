@@ -0,0 +1,87 @@
+#ifndef SESSION_METRICS_H
+#define SESSION_METRICS_H
+
+#include "logrecord.hpp"
+#include <vector>
+
+/**
+  * Response metrics of one recorded session
+  */
+struct SessionMetrics
+{
+    SessionMetrics();
+
+    /**
+      * Value of the SE record, 0 if the session has no end
+      */
+    int outcome;
+    /**
+      * Number of CS and PS records
+      */
+    int nameCalls;
+    int phraseCalls;
+    /**
+      * Calls made before SE 1, -1 if the child did not respond
+      */
+    int callsToResponse;
+    /**
+      * Microseconds from each CE to the first face after it, -1 if no face came before the next call or the end
+      */
+    std::vector<long long> faceLatencies;
+    /**
+      * Number of SC records before the first call, between the end of each call and the start of the next one
+      * and after the last call
+      */
+    std::vector<int> soundsBetweenCalls;
+    /**
+      * Number of SC records in the whole session
+      */
+    int sounds;
+
+    /**
+      * Mean of the face latencies of calls followed by a face, -1 if there are none
+      */
+    double meanFaceLatency() const;
+
+    /**
+      * Face latency of the last call, the one the child responded to, -1 if there is none
+      */
+    long long responseFaceLatency() const;
+
+    /**
+      * Summary record of the metrics, SM with the outcome as its value followed by the name calls, phrase calls,
+      * calls to the response, sounds, mean and response face latency in milliseconds and the sounds between calls
+      */
+    LogRecord toLogRecord(long long timestamp) const;
+};
+
+/**
+  * Keeps the metrics of a session up to date as its records are logged, one record at a time
+  * Records after the end of the session are not counted
+  */
+class SessionMetricsTracker
+{
+  public:
+    SessionMetricsTracker();
+
+    void add(const LogRecord &record);
+
+    /**
+      * Metrics of the records added so far, as if the session ended after them
+      */
+    SessionMetrics metrics() const;
+
+  private:
+    SessionMetrics current;
+    bool calling;
+    bool waitingForFace;
+    long long callEnd;
+    int sounds;
+};
+
+/**
+  * Computes the metrics of a session from its records, in the order they were logged
+  */
+SessionMetrics sessionMetrics(const std::vector<LogRecord> &log);
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef SESSION_REPLAY_H
+#define SESSION_REPLAY_H
+
+#include "callprotocol.hpp"
+#include "logrecord.hpp"
+#include <vector>
+
+/**
+  * Replays a recorded session through the call protocol on a virtual clock
+  * Faces are fed in as they were recorded, calls are not played, each one ends callDuration milliseconds after it started,
+  * so a session runs in the time it takes to go through its records
+  */
+class SessionReplay
+{
+  public:
+
+    struct Result {
+        Result();
+        /**
+          * CS, PS, CE and SE records the protocol would have written
+          */
+        std::vector<LogRecord> decisions;
+        /**
+          * Values of the SE record, 0 if the session has no end
+          */
+        int recordedOutcome;
+        int replayedOutcome;
+        /**
+          * Time of the SE record in milliseconds, -1 if the session has no end
+          */
+        long long recordedEnd;
+        long long replayedEnd;
+        /**
+          * Number of CS and PS records
+          */
+        int recordedCalls;
+        int replayedCalls;
+        /**
+          * Protocol made a decision without moving its deadline past the time of the decision, replay was stopped
+          */
+        bool stalled;
+    };
+
+    /**
+      * Negative callDuration estimates the length of a call from each replayed log
+      */
+    SessionReplay(const CallProtocol::Parameters &parameters = CallProtocol::Parameters(), long long callDuration = -1,
+                  const ResponseDetector::Thresholds &response = ResponseDetector::Thresholds());
+
+    /**
+      * Replays through the protocol of the table, which must have passed CallProtocol::validate
+      */
+    SessionReplay(const CallProtocol::Table &table, long long callDuration = -1,
+                  const ResponseDetector::Thresholds &response = ResponseDetector::Thresholds());
+
+    Result run(const std::vector<LogRecord> &log) const;
+
+    /**
+      * Median time from CS or PS to the following CE in the log, 1500 ms if the log has no complete call
+      */
+    static long long estimateCallDuration(const std::vector<LogRecord> &log);
+
+  private:
+    CallProtocol::Table table;
+    long long callDuration;
+    ResponseDetector::Thresholds response;
+};
+
+#endif
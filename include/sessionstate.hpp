@@ -0,0 +1,93 @@
+#ifndef SESSION_STATE_H
+#define SESSION_STATE_H
+
+/**
+  * State of the session shared by the Logger callbacks, the scheduler and anyone reading it
+  *
+  * State is published as a whole under a sequence lock: writers, serialized by the caller, make the sequence odd
+  * while they write, readers copy the state without locking and retry if the sequence changed meanwhile,
+  * so a reader never blocks a writer or another reader and always sees the state of a single publish
+  * Event handlers enter the state before they touch the session, so ending a session can wait for them to leave
+  * Each part is padded to cache lines of its own, written state, handler count and counters never share a line
+  */
+class SessionState
+{
+  public:
+    enum { CacheLine = 64 };
+
+    struct Snapshot {
+        Snapshot();
+
+        long long start;        // monotonic time the session started, in nanoseconds
+        long long lastFace;     // session time of the last face, in milliseconds
+        long long lastCall;     // session time the last call ended, in milliseconds, 0 before the first call
+        long long deadline;     // session time of the next decision, in milliseconds
+        int session;            // sessions started since the module was created
+        int iteration;          // calls made in the session
+        int faces;              // faces seen since the last call
+        bool active;
+        bool ended;             // protocol ended the session
+    };
+
+    /**
+      * Handler of an event, entered for as long as the object lives
+      */
+    class Handler
+    {
+      public:
+        explicit Handler(SessionState &state);
+        ~Handler();
+
+        /**
+          * Session was active when the handler entered, the handler does nothing otherwise
+          */
+        bool active() const;
+
+      private:
+        SessionState &state;
+        bool entered;
+
+        Handler(const Handler &);
+        Handler &operator=(const Handler &);
+    };
+
+    SessionState();
+
+    /**
+      * Replaces the state, callers must not publish concurrently
+      */
+    void publish(const Snapshot &snapshot);
+
+    /**
+      * Copy of the state as last published, never blocks
+      */
+    Snapshot read() const;
+
+    /**
+      * Waits until every handler that entered while the session was active has left
+      * Called once the inactive state is published, handlers entering afterwards see it and do nothing
+      */
+    void quiesce() const;
+
+    /**
+      * Reads which had to be retried because a write was in progress
+      */
+    unsigned long retries() const;
+
+  private:
+    enum { Words = 9 };
+
+    char leading[CacheLine];
+    volatile unsigned long sequence;
+    volatile long long words[Words];
+    char trailing[CacheLine];
+    volatile int handlers;
+    char handlersPadding[CacheLine];
+    mutable volatile unsigned long retryCount;
+    char retriesPadding[CacheLine];
+
+    SessionState(const SessionState &);
+    SessionState &operator=(const SessionState &);
+};
+
+#endif
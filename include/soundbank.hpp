@@ -0,0 +1,91 @@
+#ifndef SOUND_BANK_H
+#define SOUND_BANK_H
+
+#include "latencyhistogram.hpp"
+#include "wavfile.hpp"
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <alproxies/alaudioplayerproxy.h>
+#include <string>
+
+/**
+  * Recordings played during the session, loaded into ALAudioPlayer once and played by their ID
+  * A call then starts without opening and decoding the file, sounds that could not be loaded are played from the file
+  */
+class SoundBank
+{
+  public:
+    enum Sound {
+        Name,       // name.wav, call by name
+        Phrase,     // phrase.wav, call with the special phrase
+        Bravo,      // bravo.wav, played when the session ends
+        SoundCount
+    };
+
+    /**
+      * Latency of loading the files is recorded in the given histograms, if any
+      */
+    SoundBank(boost::shared_ptr<AL::ALAudioPlayerProxy> audioPlayer, LatencyHistograms *latencies = 0);
+
+    /**
+      * Destructor, unloads the sounds from the player
+      */
+    ~SoundBank();
+
+    /**
+      * Sets the directory the sounds are taken from, sounds loaded from another directory are unloaded
+      */
+    void setDirectory(const std::string &directory);
+
+    /**
+      * Validates and loads every sound not loaded yet
+      * Returns false if any of the sounds could not be loaded
+      */
+    bool load();
+
+    /**
+      * Unloads every sound, afterwards sounds are played from their files
+      */
+    void unload();
+
+    /**
+      * Starts playing the sound and returns at once with the ID of the player task
+      */
+    int post(Sound sound);
+
+    /**
+      * Waits for the player task to finish
+      */
+    void wait(int task);
+
+    /**
+      * Stops the player task, the task finishes once the player stopped
+      */
+    void stop(int task);
+
+    /**
+      * Path of the sound in the directory
+      */
+    std::string path(Sound sound);
+
+    static const char *fileName(Sound sound);
+
+  private:
+    /**
+      * Player ID of the sound, -1 if it is not loaded
+      */
+    int id(Sound sound);
+
+    boost::shared_ptr<AL::ALAudioPlayerProxy> player;
+    LatencyHistogram *loadLatency;
+
+    /**
+      * Guards the loaded sounds, never held while a sound is played
+      */
+    boost::mutex mutex;
+    std::string directory;
+    int ids[SoundCount];
+    WavInfo info[SoundCount];
+};
+
+#endif
@@ -47,12 +47,14 @@ class ResponseToNameInterface : public AL::ALModule
       * This method will be called when FrontTactilTouched event is raised
       * When called, it raises StartSession event
       */
-    void onTactilTouched();
+    void onTactilTouched(const std::string &key, const AL::ALValue &value, const AL::ALValue &msg);
 
     /**
       * This method will be called when CallChild event is raised
       * Event is raised by the scheduler thread of Logger module
-      * Method uses proxy to ALAudioDevice to reproduce the call by name
+      * Call is queued for playback and the method returns at once, CallStartedRTN is raised once the player
+      * accepted the call and ChildCalledRTN once it ended, with [value, seconds, nanoseconds] of the monotonic
+      * clock at that moment; the first sample is heard after the player's own start-up delay
       */
     void callChild(const std::string &key, const AL::ALValue &value, const AL::ALValue &msg);
 
@@ -60,9 +62,36 @@ class ResponseToNameInterface : public AL::ALModule
       * This method will be called when EndSession event is raised by the Logger module
       * Resets the Interface module, subscribing back to FrontTactilTouched, enables new session
       */
-    void endSession();
+    void endSession(const std::string &key, const AL::ALValue &value, const AL::ALValue &msg);
+
+    /**
+      * This method will be called when SessionResumed event is raised by a Logger module which was restarted
+      * Interface not running a session, e.g. because it was restarted as well, joins the resumed one
+      */
+    void sessionResumed(const std::string &key, const AL::ALValue &value, const AL::ALValue &msg);
+
+    /**
+      * Latency histograms of every callback and proxy call of the module, cleared if reset is true
+      * Each histogram is [name, count, sum, max, [[limit, count], ...]] with times in microseconds
+      */
+    AL::ALValue getLatencyHistograms(const bool &reset);
+
+    /**
+      * Sets an Interface parameter, new value is used from the next session on
+      * soundDirectory - folder of name.wav, phrase.wav and bravo.wav, /home/nao/naoqi/modules/sounds/ by default
+      * soundBank - true to load the recordings into the player before the session, false to play them from their files
+      */
+    void setParameter(const std::string &name, const AL::ALValue &value);
 
   private:
+    /**
+      * Event handlers, run by the event dispatcher which makes sure none of them is re-entered
+      */
+    void tactilTouched(const AL::ALValue &value);
+    void playCall(const AL::ALValue &value);
+    void resetSession(const AL::ALValue &value);
+    void joinSession(const AL::ALValue &value);
+
     /**
       * Object implementation
       */
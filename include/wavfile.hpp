@@ -0,0 +1,31 @@
+#ifndef WAV_FILE_H
+#define WAV_FILE_H
+
+#include <string>
+
+/**
+  * Format and layout of a PCM WAV file
+  */
+struct WavInfo {
+    int channels;
+    int sampleRate;
+    int bitsPerSample;
+    /**
+      * Offset and length of the samples in the file, in bytes
+      */
+    long dataOffset;
+    long dataSize;
+
+    /**
+      * Length of the recording in milliseconds
+      */
+    long duration() const;
+};
+
+/**
+  * Reads and validates the header of a PCM WAV file, only the headers are read
+  * Returns false with the reason in error if the file can not be played
+  */
+bool readWavInfo(const std::string &path, WavInfo &info, std::string &error);
+
+#endif
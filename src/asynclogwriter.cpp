@@ -0,0 +1,287 @@
+#include "asynclogwriter.hpp"
+#include "monotonictime.hpp"
+#include <boost/bind.hpp>
+
+AsyncLogWriter::AsyncLogWriter(std::size_t bytes, unsigned int interval) :
+    format(Text),
+    batchLength(0),
+    fileLength(0),
+    flushBytes(bytes),
+    flushInterval(interval*1000000LL),
+    lastFlush(0),
+    progress(0),
+    drainRequests(0),
+    drainsDone(0),
+    opened(false),
+    closing(false),
+    shutdown(false),
+    accepting(0),
+    producers(0),
+    stallCount(0) {
+    // A single record must always fit behind the flush threshold
+    if( flushBytes > BatchSize - LogRecord::MaxLineLength ) {
+        flushBytes = BatchSize - LogRecord::MaxLineLength;
+    }
+}
+
+AsyncLogWriter::~AsyncLogWriter() {
+    close();
+    {
+        boost::mutex::scoped_lock lock(mutex);
+        shutdown = true;
+        condition.notify_all();
+    }
+    if( writer.joinable() ) {
+        writer.join();
+    }
+}
+
+void AsyncLogWriter::configure(const std::string &directory, unsigned long long segmentSize,
+                               LogStorage::Durability durability, unsigned int syncInterval) {
+    boost::mutex::scoped_lock lock(mutex);
+    while( opened ) {
+        closed.wait(lock);
+    }
+    storage.configure(directory, segmentSize, durability, syncInterval);
+}
+
+bool AsyncLogWriter::prepare(const std::string &directory, unsigned long long segmentSize,
+                             LogStorage::Durability durability) {
+    boost::mutex::scoped_lock lock(mutex);
+    if( !writer.joinable() ) {
+        writer = boost::thread(boost::bind(&AsyncLogWriter::run, this));
+    }
+    if( opened ) {
+        return true;
+    }
+    storage.configure(directory, segmentSize, durability);
+    return storage.prepare();
+}
+
+bool AsyncLogWriter::open(Format newFormat, long long sessionStart, bool featureStore) {
+    boost::mutex::scoped_lock lock(mutex);
+    // Writer thread survives between sessions, it is only created once
+    if( !writer.joinable() ) {
+        writer = boost::thread(boost::bind(&AsyncLogWriter::run, this));
+    }
+    while( opened ) {
+        closed.wait(lock);
+    }
+    if( !storage.begin(sessionStart) ) {
+        return false;
+    }
+    // Log is written even if the feature store can not be
+    if( featureStore ) {
+        features.open(storage.path(LogStorage::sessionName(storage.session().id) + ".rtnf"), sessionStart);
+    }
+    format = newFormat;
+    batchLength = 0;
+    fileLength = 0;
+    if( format == Binary ) {
+        encoder.reset();
+        batchLength = encodeBinaryLogHeader(sessionStart, batch);
+    }
+    lastFlush = monotonicTime();
+    opened = true;
+    __sync_lock_test_and_set(&accepting, 1);
+    condition.notify_all();
+    return true;
+}
+
+void AsyncLogWriter::push(const LogRecord &record) {
+    // Producer count lets close() know when no push can be in flight anymore
+    __sync_fetch_and_add(&producers, 1);
+    if( accepting ) {
+        while( !queue.push(record) ) {
+            // Queue is full, wake the writer and give it time to catch up
+            __sync_fetch_and_add(&stallCount, 1);
+            condition.notify_one();
+            boost::this_thread::yield();
+        }
+        // Do not let a burst wait for the flush interval
+        if( queue.size() == QueueSize/2 ) {
+            condition.notify_one();
+        }
+    }
+    __sync_fetch_and_sub(&producers, 1);
+}
+
+void AsyncLogWriter::close() {
+    // Stop accepting records and wait for pushes already in progress
+    __sync_lock_test_and_set(&accepting, 0);
+    while( producers != 0 ) {
+        boost::this_thread::yield();
+    }
+
+    boost::mutex::scoped_lock lock(mutex);
+    if( !opened ) {
+        return;
+    }
+    // Let the writer drain the queue and close the file
+    closing = true;
+    condition.notify_all();
+    while( opened ) {
+        closed.wait(lock);
+    }
+}
+
+unsigned long AsyncLogWriter::stalls() const {
+    return stallCount;
+}
+
+LatencyHistogram &AsyncLogWriter::writeLatency() {
+    return flushLatency;
+}
+
+unsigned long long AsyncLogWriter::bytesWritten() const {
+    return fileLength;
+}
+
+unsigned long AsyncLogWriter::session() {
+    boost::mutex::scoped_lock lock(mutex);
+    return storage.session().id;
+}
+
+LogStorage::Session AsyncLogWriter::storageSession() {
+    boost::mutex::scoped_lock lock(mutex);
+    return storage.session();
+}
+
+void AsyncLogWriter::Progress::store(unsigned long long length, long long lastTimestamp) {
+    Position &next = positions[(sequence + 1) & 1];
+    next.length = length;
+    next.lastTimestamp = lastTimestamp;
+    // Position is complete before the sequence points to it
+    __sync_synchronize();
+    sequence = sequence + 1;
+}
+
+AsyncLogWriter::Progress::Position AsyncLogWriter::Progress::load() const {
+    return positions[sequence & 1];
+}
+
+bool AsyncLogWriter::resume(Format newFormat, const LogStorage::Session &session, const Progress::Position &position) {
+    boost::mutex::scoped_lock lock(mutex);
+    if( !writer.joinable() ) {
+        writer = boost::thread(boost::bind(&AsyncLogWriter::run, this));
+    }
+    while( opened ) {
+        closed.wait(lock);
+    }
+    if( !storage.resume(session, position.length) ) {
+        return false;
+    }
+    format = newFormat;
+    batchLength = 0;
+    fileLength = position.length;
+    if( format == Binary ) {
+        encoder.resume(position.lastTimestamp);
+        // Log killed before its first write has no header yet
+        if( fileLength == 0 ) {
+            encoder.reset();
+            batchLength = encodeBinaryLogHeader(session.start, batch);
+        }
+    }
+    lastFlush = monotonicTime();
+    opened = true;
+    __sync_lock_test_and_set(&accepting, 1);
+    condition.notify_all();
+    return true;
+}
+
+void AsyncLogWriter::observe(const boost::function<void (const LogRecord &)> &newObserver) {
+    observer = newObserver;
+}
+
+void AsyncLogWriter::waitDrained() {
+    boost::mutex::scoped_lock lock(mutex);
+    unsigned long request = ++drainRequests;
+    condition.notify_all();
+    while( opened && drainsDone < request ) {
+        closed.wait(lock);
+    }
+}
+
+void AsyncLogWriter::track(Progress *newProgress) {
+    boost::mutex::scoped_lock lock(mutex);
+    // Writer only reads the progress while a log is open
+    while( opened ) {
+        closed.wait(lock);
+    }
+    progress = newProgress;
+}
+
+void AsyncLogWriter::run() {
+    boost::mutex::scoped_lock lock(mutex);
+    while( !shutdown ) {
+        // No log open, sleep until there is one
+        if( !opened ) {
+            condition.wait(lock);
+            continue;
+        }
+        bool last = closing;
+        unsigned long requested = drainRequests;
+
+        // Format and write without holding the lock, open() and close() only wait on it
+        lock.unlock();
+        drain();
+        if( last || batchLength >= flushBytes || monotonicTime() - lastFlush >= flushInterval ) {
+            flush();
+        }
+        lock.lock();
+
+        if( drainsDone != requested ) {
+            drainsDone = requested;
+            closed.notify_all();
+        }
+        if( last ) {
+            storage.end();
+            features.close();
+            opened = false;
+            closing = false;
+            closed.notify_all();
+            continue;
+        }
+        // Drain asked for while this one was running is done right away
+        if( drainsDone != drainRequests ) {
+            continue;
+        }
+        condition.waitUntil(lock, lastFlush + flushInterval);
+    }
+}
+
+void AsyncLogWriter::drain() {
+    LogRecord record;
+    while( queue.pop(record) ) {
+        if( batchLength + LogRecord::MaxLineLength > BatchSize ) {
+            flush();
+        }
+        if( record.event == LogSoundFeatures ) {
+            features.append(record);
+        }
+        if( observer ) {
+            observer(record);
+        }
+        if( format == Binary ) {
+            batchLength += encoder.encode(record, batch + batchLength);
+        }
+        else {
+            batchLength += formatLogRecord(record, batch + batchLength, BatchSize - batchLength);
+        }
+    }
+}
+
+void AsyncLogWriter::flush() {
+    ScopedLatency latency(flushLatency);
+    if( batchLength > 0 ) {
+        storage.write(batch, batchLength);
+        fileLength += batchLength;
+        batchLength = 0;
+        if( progress ) {
+            progress->store(fileLength, format == Binary ? encoder.last() : 0);
+        }
+    }
+    storage.flush();
+    features.flush();
+    lastFlush = monotonicTime();
+}
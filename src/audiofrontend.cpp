@@ -0,0 +1,349 @@
+#include "audiofrontend.hpp"
+#include <algorithm>
+#include <cmath>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+  const double Pi = 3.14159265358979323846;
+
+  /**
+    * Edges of the bands in Hz, the last band reaches the Nyquist frequency
+    */
+  const int BandEdges[AudioFrontEnd::Bands] = { 0, 500, 1000, 2000, 4000 };
+
+  /**
+    * Bands between 500 and 4000 Hz, where articulated speech has most of its energy
+    */
+  const int FirstSpeechBand = 1;
+  const int LastSpeechBand = 3;
+
+  /**
+    * Sums of the four lanes in the order the vector kernels add them
+    */
+  inline float laneSum(const float lanes[4]) {
+      return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+  }
+
+  void scalarBlock(const short *samples, int length, unsigned long long &squares, int &crossings, int &peak) {
+      int minimum = 0, maximum = 0;
+      for( int i = 0; i < length; ++i ) {
+          int sample = samples[i];
+          squares += static_cast<unsigned long long>(sample*sample);
+          if( i > 0 && ((sample ^ samples[i - 1]) & 0x8000) ) {
+              ++crossings;
+          }
+          minimum = std::min(minimum, sample);
+          maximum = std::max(maximum, sample);
+      }
+      peak = std::max(peak, std::max(maximum, -minimum));
+  }
+
+  /**
+    * Windowed cosine and sine of one bin over the block, summed in four lanes like the vector kernel
+    */
+  void scalarBin(const float *block, const float *cosine, const float *sine, int length, float &re, float &im) {
+      float cosLanes[4] = { 0, 0, 0, 0 };
+      float sinLanes[4] = { 0, 0, 0, 0 };
+      for( int i = 0; i < length; i += 4 ) {
+          for( int lane = 0; lane < 4; ++lane ) {
+              float c = block[i + lane]*cosine[i + lane];
+              float s = block[i + lane]*sine[i + lane];
+              cosLanes[lane] += c;
+              sinLanes[lane] += s;
+          }
+      }
+      re = laneSum(cosLanes);
+      im = laneSum(sinLanes);
+  }
+
+#if defined(__SSE2__)
+  /**
+    * Sum of squares, zero crossings and peak of the block, eight samples at a time
+    * Products of two samples are summed in pairs into 32 bits, which only -32768 squared twice fills,
+    * so the pairs are taken as unsigned and widened to 64 bits before they are added up
+    */
+  void vectorBlock(const short *samples, int length, unsigned long long &squares, int &crossings, int &peak) {
+      const __m128i zero = _mm_setzero_si128();
+      __m128i sum = zero;
+      __m128i changes = zero;
+      __m128i minimum = zero, maximum = zero;
+      int i = 0;
+      for( ; i + 8 <= length; i += 8 ) {
+          __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(samples + i));
+          __m128i pairs = _mm_madd_epi16(x, x);
+          sum = _mm_add_epi64(sum, _mm_unpacklo_epi32(pairs, zero));
+          sum = _mm_add_epi64(sum, _mm_unpackhi_epi32(pairs, zero));
+          if( i > 0 ) {
+              __m128i previous = _mm_loadu_si128(reinterpret_cast<const __m128i *>(samples + i - 1));
+              // Sign differs from the previous sample: -1 in the lane
+              changes = _mm_sub_epi16(changes, _mm_srai_epi16(_mm_xor_si128(x, previous), 15));
+          }
+          else {
+              __m128i previous = _mm_slli_si128(x, 2);
+              __m128i changed = _mm_srai_epi16(_mm_xor_si128(x, previous), 15);
+              // First sample has no previous one
+              changes = _mm_sub_epi16(changes, _mm_and_si128(changed, _mm_set_epi16(-1, -1, -1, -1, -1, -1, -1, 0)));
+          }
+          minimum = _mm_min_epi16(minimum, x);
+          maximum = _mm_max_epi16(maximum, x);
+      }
+      unsigned long long sums[2];
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(sums), sum);
+      short counts[8], minima[8], maxima[8];
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(counts), changes);
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(minima), minimum);
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(maxima), maximum);
+      squares += sums[0] + sums[1];
+      int low = 0, high = 0;
+      for( int lane = 0; lane < 8; ++lane ) {
+          crossings += counts[lane];
+          low = std::min(low, static_cast<int>(minima[lane]));
+          high = std::max(high, static_cast<int>(maxima[lane]));
+      }
+      peak = std::max(peak, std::max(high, -low));
+      // Samples past the last full vector, none for the block lengths used
+      for( ; i < length; ++i ) {
+          int sample = samples[i];
+          squares += static_cast<unsigned long long>(sample*sample);
+          if( i > 0 && ((sample ^ samples[i - 1]) & 0x8000) ) {
+              ++crossings;
+          }
+          peak = std::max(peak, sample < 0 ? -sample : sample);
+      }
+  }
+
+  void vectorBin(const float *block, const float *cosine, const float *sine, int length, float &re, float &im) {
+      __m128 cosSum = _mm_setzero_ps();
+      __m128 sinSum = _mm_setzero_ps();
+      for( int i = 0; i < length; i += 4 ) {
+          __m128 x = _mm_loadu_ps(block + i);
+          cosSum = _mm_add_ps(cosSum, _mm_mul_ps(x, _mm_loadu_ps(cosine + i)));
+          sinSum = _mm_add_ps(sinSum, _mm_mul_ps(x, _mm_loadu_ps(sine + i)));
+      }
+      float cosLanes[4], sinLanes[4];
+      _mm_storeu_ps(cosLanes, cosSum);
+      _mm_storeu_ps(sinLanes, sinSum);
+      re = laneSum(cosLanes);
+      im = laneSum(sinLanes);
+  }
+
+  void vectorConvert(const short *samples, float *block, int length) {
+      for( int i = 0; i < length; i += 8 ) {
+          __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(samples + i));
+          __m128i low = _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+          __m128i high = _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16);
+          _mm_storeu_ps(block + i, _mm_cvtepi32_ps(low));
+          _mm_storeu_ps(block + i + 4, _mm_cvtepi32_ps(high));
+      }
+  }
+#endif
+}
+
+AudioFrontEnd::Parameters::Parameters() :
+    loudness(10000), frames(5), buffersPerFrame(5), sampleRate(16000),
+    articulation(0.5f), modulation(0.35f), kernels(Vector) {
+}
+
+AudioFrontEnd::AudioFrontEnd(const Parameters &parameters) :
+    settings(parameters), pendingTime(0), soundTime(0), analysed(0) {
+    settings.frames = std::max(2, settings.frames);
+    settings.buffersPerFrame = std::max(1, settings.buffersPerFrame);
+    settings.sampleRate = std::max<int>(BlockLength, settings.sampleRate);
+    length = settings.buffersPerFrame*BlockLength;
+    cosines.resize(Bins*BlockLength);
+    sines.resize(Bins*BlockLength);
+    for( int bin = 0; bin < Bins; ++bin ) {
+        for( int i = 0; i < BlockLength; ++i ) {
+            double window = 0.5 - 0.5*std::cos(2*Pi*i/BlockLength);
+            cosines[bin*BlockLength + i] = static_cast<float>(window*std::cos(2*Pi*bin*i/BlockLength));
+            sines[bin*BlockLength + i] = static_cast<float>(window*std::sin(2*Pi*bin*i/BlockLength));
+        }
+    }
+    pending.reserve(length);
+    sound.reserve(settings.frames);
+}
+
+void AudioFrontEnd::reset() {
+    pending.clear();
+    sound.clear();
+}
+
+int AudioFrontEnd::frameLength() const {
+    return length;
+}
+
+const AudioFrontEnd::Parameters &AudioFrontEnd::parameters() const {
+    return settings;
+}
+
+unsigned long AudioFrontEnd::framesAnalysed() const {
+    return analysed;
+}
+
+bool AudioFrontEnd::vectorised() {
+#if defined(__SSE2__)
+    return true;
+#else
+    return false;
+#endif
+}
+
+void AudioFrontEnd::analyse(const short *samples, Kernels kernels, Frame &frame) const {
+#if !defined(__SSE2__)
+    kernels = Scalar;
+#endif
+    unsigned long long squares = 0;
+    frame.zeroCrossings = 0;
+    frame.peak = 0;
+    for( int band = 0; band < Bands; ++band ) {
+        frame.bands[band] = 0;
+    }
+    // First bin of every band but the first, the last band ends at the Nyquist frequency
+    int firstBin[Bands + 1];
+    for( int band = 0; band < Bands; ++band ) {
+        firstBin[band] = std::min<int>(Bins, static_cast<long long>(BandEdges[band])*BlockLength/settings.sampleRate);
+    }
+    firstBin[Bands] = Bins;
+
+    float block[BlockLength];
+    for( int start = 0; start < length; start += BlockLength ) {
+        const short *blockSamples = samples + start;
+#if defined(__SSE2__)
+        if( kernels == Vector ) {
+            vectorBlock(blockSamples, BlockLength, squares, frame.zeroCrossings, frame.peak);
+            vectorConvert(blockSamples, block, BlockLength);
+        }
+        else
+#endif
+        {
+            scalarBlock(blockSamples, BlockLength, squares, frame.zeroCrossings, frame.peak);
+            for( int i = 0; i < BlockLength; ++i ) {
+                block[i] = blockSamples[i];
+            }
+        }
+        // Blocks are joined by the crossing between them
+        if( start > 0 && ((blockSamples[0] ^ blockSamples[-1]) & 0x8000) ) {
+            ++frame.zeroCrossings;
+        }
+        for( int band = 0; band < Bands; ++band ) {
+            for( int bin = firstBin[band]; bin < firstBin[band + 1]; ++bin ) {
+                float re, im;
+#if defined(__SSE2__)
+                if( kernels == Vector ) {
+                    vectorBin(block, &cosines[bin*BlockLength], &sines[bin*BlockLength], BlockLength, re, im);
+                }
+                else
+#endif
+                {
+                    scalarBin(block, &cosines[bin*BlockLength], &sines[bin*BlockLength], BlockLength, re, im);
+                }
+                float power = re*re;
+                power += im*im;
+                frame.bands[band] += power;
+            }
+        }
+    }
+    frame.energy = static_cast<double>(squares)/length;
+}
+
+int AudioFrontEnd::process(const short *samples, int channels, int count, long long time, std::vector<Sound> &sounds) {
+    int decided = 0;
+    channels = std::max(1, channels);
+    for( int i = 0; i < count; ) {
+        if( pending.empty() ) {
+            pendingTime = time + i*1000000000LL/settings.sampleRate;
+        }
+        // Whole frames are analysed in place, only the parts of frames spanning buffers are copied
+        if( pending.empty() && channels == 1 && count - i >= length ) {
+            Frame frame;
+            analyse(samples + i, settings.kernels, frame);
+            ++analysed;
+            Sound decision;
+            if( addFrame(frame, pendingTime, decision) ) {
+                sounds.push_back(decision);
+                ++decided;
+            }
+            i += length;
+            continue;
+        }
+        int copied = std::min(count - i, length - static_cast<int>(pending.size()));
+        for( int j = 0; j < copied; ++j ) {
+            pending.push_back(samples[(i + j)*channels]);
+        }
+        i += copied;
+        if( static_cast<int>(pending.size()) == length ) {
+            Frame frame;
+            analyse(&pending[0], settings.kernels, frame);
+            ++analysed;
+            pending.clear();
+            Sound decision;
+            if( addFrame(frame, pendingTime, decision) ) {
+                sounds.push_back(decision);
+                ++decided;
+            }
+        }
+    }
+    return decided;
+}
+
+bool AudioFrontEnd::addFrame(const Frame &frame, long long time, Sound &decision) {
+    bool loud = frame.peak >= settings.loudness;
+    if( sound.empty() ) {
+        if( !loud ) {
+            return false;
+        }
+        soundTime = time;
+    }
+    else if( static_cast<int>(sound.size()) == settings.frames ) {
+        // Sound was decided, the next one starts with a loud frame after a quiet one
+        if( !loud ) {
+            sound.clear();
+        }
+        return false;
+    }
+    sound.push_back(frame);
+    if( static_cast<int>(sound.size()) < settings.frames ) {
+        return false;
+    }
+
+    // Onset frame is only partly filled by the sound, the modulation is measured over the frames after it
+    double logEnergy = 0, crossings = 0, energy = 0, energySquares = 0;
+    double bands[Bands] = { 0, 0, 0, 0, 0 };
+    for( std::size_t i = 0; i < sound.size(); ++i ) {
+        logEnergy += std::log10(sound[i].energy + 1);
+        crossings += sound[i].zeroCrossings;
+        for( int band = 0; band < Bands; ++band ) {
+            bands[band] += sound[i].bands[band];
+        }
+        if( i > 0 ) {
+            energy += sound[i].energy;
+            energySquares += sound[i].energy*sound[i].energy;
+        }
+    }
+    double frames = static_cast<double>(sound.size());
+    double mean = energy/(frames - 1);
+    double variance = std::max(0.0, energySquares/(frames - 1) - mean*mean);
+    double modulation = mean > 0 ? std::sqrt(variance)/mean : 0;
+    double total = 0, speech = 0;
+    for( int band = 0; band < Bands; ++band ) {
+        total += bands[band];
+        if( band >= FirstSpeechBand && band <= LastSpeechBand ) {
+            speech += bands[band];
+        }
+    }
+    double speechShare = total > 0 ? speech/total : 0;
+
+    decision.time = soundTime;
+    decision.soundClass = speechShare >= settings.articulation && modulation >= settings.modulation ? 1 : 0;
+    decision.features[0] = static_cast<float>(logEnergy/frames);
+    decision.features[1] = static_cast<float>(modulation);
+    decision.features[2] = static_cast<float>(crossings/(frames*length));
+    decision.features[3] = static_cast<float>(speechShare);
+    for( int band = 0; band < Bands; ++band ) {
+        decision.features[4 + band] = static_cast<float>(total > 0 ? bands[band]/total : 0);
+    }
+    return true;
+}
@@ -0,0 +1,202 @@
+#include "binarylog.hpp"
+#include <cstring>
+
+namespace
+{
+  const char magic[4] = { 'R', 'T', 'N', 'B' };
+
+  std::size_t putVarint(unsigned long long value, char *buffer) {
+      std::size_t length = 0;
+      while( value >= 0x80 ) {
+          buffer[length++] = static_cast<char>((value & 0x7F) | 0x80);
+          value >>= 7;
+      }
+      buffer[length++] = static_cast<char>(value);
+      return length;
+  }
+
+  bool getVarint(const char *&p, const char *end, unsigned long long &value) {
+      value = 0;
+      for( int shift = 0; shift < 64; shift += 7 ) {
+          if( p == end ) {
+              return false;
+          }
+          unsigned char byte = static_cast<unsigned char>(*p++);
+          value |= static_cast<unsigned long long>(byte & 0x7F) << shift;
+          if( !(byte & 0x80) ) {
+              return true;
+          }
+      }
+      return false;
+  }
+
+  unsigned long long zigzag(long long value) {
+      return (static_cast<unsigned long long>(value) << 1) ^ static_cast<unsigned long long>(value >> 63);
+  }
+
+  long long unzigzag(unsigned long long value) {
+      return static_cast<long long>(value >> 1) ^ -static_cast<long long>(value & 1);
+  }
+
+  void putLittleEndian(unsigned long long value, int bytes, char *buffer) {
+      for( int i = 0; i < bytes; ++i ) {
+          buffer[i] = static_cast<char>(value >> (8*i));
+      }
+  }
+
+  unsigned long long getLittleEndian(const char *buffer, int bytes) {
+      unsigned long long value = 0;
+      for( int i = 0; i < bytes; ++i ) {
+          value |= static_cast<unsigned long long>(static_cast<unsigned char>(buffer[i])) << (8*i);
+      }
+      return value;
+  }
+}
+
+std::size_t encodeBinaryLogHeader(long long sessionStart, char *buffer) {
+    std::memcpy(buffer, magic, sizeof(magic));
+    buffer[4] = BinaryLogVersion;
+    buffer[5] = buffer[6] = buffer[7] = 0;
+    putLittleEndian(static_cast<unsigned long long>(sessionStart), 8, buffer + 8);
+    return BinaryLogHeaderSize;
+}
+
+BinaryLogEncoder::BinaryLogEncoder() : lastTimestamp(0) {
+}
+
+void BinaryLogEncoder::reset() {
+    lastTimestamp = 0;
+}
+
+void BinaryLogEncoder::resume(long long timestamp) {
+    lastTimestamp = timestamp;
+}
+
+long long BinaryLogEncoder::last() const {
+    return lastTimestamp;
+}
+
+std::size_t BinaryLogEncoder::encode(const LogRecord &record, char *buffer) {
+    std::size_t length = 0;
+    buffer[length++] = static_cast<char>(record.event);
+    length += putVarint(zigzag(record.value), buffer + length);
+    // Records are queued by several threads, so a timestamp can be slightly older than the previous one
+    length += putVarint(zigzag(record.timestamp - lastTimestamp), buffer + length);
+    lastTimestamp = record.timestamp;
+    if( record.event == LogFaceInterval ) {
+        length += putVarint(static_cast<unsigned int>(record.duration), buffer + length);
+    }
+    if( record.event == LogLatency || record.event == LogSoundFeatures ) {
+        std::size_t nameLength = strnlen(record.name, LogRecord::MaxNameLength - 1);
+        buffer[length++] = static_cast<char>(nameLength);
+        std::memcpy(buffer + length, record.name, nameLength);
+        length += nameLength;
+    }
+    if( record.event == LogSoundFeatures || record.event == LogLatency || record.event == LogSummary ) {
+        unsigned int count = record.featureCount;
+        if( count > LogRecord::MaxFeatures ) {
+            count = LogRecord::MaxFeatures;
+        }
+        buffer[length++] = static_cast<char>(count);
+        for( unsigned int i = 0; i < count; ++i ) {
+            unsigned int bits;
+            std::memcpy(&bits, &record.features[i], sizeof(bits));
+            putLittleEndian(bits, 4, buffer + length);
+            length += 4;
+        }
+    }
+    return length;
+}
+
+BinaryLogDecoder::BinaryLogDecoder() : lastTimestamp(0), formatVersion(0), start(0) {
+}
+
+BinaryLogDecoder::Result BinaryLogDecoder::decodeHeader(const char *&begin, const char *end) {
+    if( end - begin < BinaryLogHeaderSize ) {
+        return NeedMore;
+    }
+    if( std::memcmp(begin, magic, sizeof(magic)) != 0 ) {
+        return Corrupt;
+    }
+    formatVersion = static_cast<unsigned char>(begin[4]);
+    if( formatVersion < 1 || formatVersion > BinaryLogVersion ) {
+        return Corrupt;
+    }
+    start = static_cast<long long>(getLittleEndian(begin + 8, 8));
+    lastTimestamp = 0;
+    begin += BinaryLogHeaderSize;
+    return Decoded;
+}
+
+BinaryLogDecoder::Result BinaryLogDecoder::decode(const char *&begin, const char *end, LogRecord &record) {
+    const char *p = begin;
+    if( p == end ) {
+        return NeedMore;
+    }
+    record.event = static_cast<unsigned char>(*p++);
+    if( record.event >= LogEventCount ) {
+        return Corrupt;
+    }
+    unsigned long long value, delta;
+    if( !getVarint(p, end, value) || !getVarint(p, end, delta) ) {
+        // A varint longer than ten bytes can not be completed by more data
+        return end - begin > 21 ? Corrupt : NeedMore;
+    }
+    record.value = static_cast<int>(unzigzag(value));
+    long long timestamp = lastTimestamp + unzigzag(delta);
+    record.timestamp = formatVersion < 4 ? timestamp*1000 : timestamp;
+    record.featureCount = 0;
+    record.duration = 0;
+    record.name[0] = '\0';
+    if( record.event == LogFaceInterval ) {
+        unsigned long long duration;
+        if( !getVarint(p, end, duration) ) {
+            return end - begin > 31 ? Corrupt : NeedMore;
+        }
+        record.duration = static_cast<int>(duration);
+    }
+    if( record.event == LogLatency || (record.event == LogSoundFeatures && formatVersion >= 6) ) {
+        if( p == end ) {
+            return NeedMore;
+        }
+        unsigned char nameLength = static_cast<unsigned char>(*p++);
+        if( nameLength >= LogRecord::MaxNameLength ) {
+            return Corrupt;
+        }
+        if( end - p < nameLength ) {
+            return NeedMore;
+        }
+        std::memcpy(record.name, p, nameLength);
+        record.name[nameLength] = '\0';
+        p += nameLength;
+    }
+    if( record.event == LogSoundFeatures || record.event == LogLatency || record.event == LogSummary ) {
+        if( p == end ) {
+            return NeedMore;
+        }
+        unsigned char count = static_cast<unsigned char>(*p++);
+        if( count > LogRecord::MaxFeatures ) {
+            return Corrupt;
+        }
+        if( end - p < 4*count ) {
+            return NeedMore;
+        }
+        for( unsigned int i = 0; i < count; ++i ) {
+            unsigned int bits = static_cast<unsigned int>(getLittleEndian(p, 4));
+            std::memcpy(&record.features[i], &bits, sizeof(bits));
+            p += 4;
+        }
+        record.featureCount = count;
+    }
+    lastTimestamp = timestamp;
+    begin = p;
+    return Decoded;
+}
+
+int BinaryLogDecoder::version() const {
+    return formatVersion;
+}
+
+long long BinaryLogDecoder::sessionStart() const {
+    return start;
+}
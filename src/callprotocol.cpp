@@ -0,0 +1,264 @@
+#include "callprotocol.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+const long long CallProtocol::Never = 0x7FFFFFFFFFFFFFFFLL;
+
+const char *const ProtocolTable<StudyProtocol>::name = "study";
+
+const CallProtocol::Row ProtocolTable<StudyProtocol>::rows[ProtocolTable<StudyProtocol>::Size] = {
+    { CallProtocol::CallByName,     1,  0, 5000, 5000 },
+    { CallProtocol::CallByName,     2,  2, 5000, 5000 },
+    { CallProtocol::CallByName,     3,  2, 5000, 5000 },
+    { CallProtocol::CallByName,     4,  2, 5000, 5000 },
+    { CallProtocol::CallByName,     5,  2, 5000, 5000 },
+    { CallProtocol::CallWithPhrase, 1,  2, 5000, 5000 },
+    { CallProtocol::CallWithPhrase, 2,  2, 5000, 5000 },
+    { CallProtocol::EndSession,     -1, 2, 5000, 5000 }
+};
+
+namespace
+{
+  const char *actionName(CallProtocol::Action action) {
+      if( action == CallProtocol::CallByName ) return "CS";
+      if( action == CallProtocol::CallWithPhrase ) return "PS";
+      if( action == CallProtocol::EndSession ) return "SE";
+      return "none";
+  }
+
+  /**
+    * Reads the rows of a protocol file, returns false with the reason in error if a line is not a row
+    */
+  bool readTable(const std::string &path, CallProtocol::Table &table, std::string &error) {
+      std::FILE *file = std::fopen(path.c_str(), "r");
+      if( !file ) {
+          error = "can not open " + path;
+          return false;
+      }
+      table.clear();
+      char line[256];
+      int number = 0;
+      bool ok = true;
+      while( ok && std::fgets(line, sizeof(line), file) ) {
+          ++number;
+          line[std::strcspn(line, "#\r\n")] = '\0';
+          char action[8];
+          CallProtocol::Row row;
+          int fields = std::sscanf(line, "%7s %d %d %lld %lld", action, &row.value, &row.responseFaces,
+                                   &row.faceTimeout, &row.callTimeout);
+          if( fields <= 0 ) {
+              continue;
+          }
+          if( std::strcmp(action, "CS") == 0 ) row.action = CallProtocol::CallByName;
+          else if( std::strcmp(action, "PS") == 0 ) row.action = CallProtocol::CallWithPhrase;
+          else if( std::strcmp(action, "SE") == 0 ) row.action = CallProtocol::EndSession;
+          else fields = 0;
+          if( fields != 5 ) {
+              char reason[64];
+              std::snprintf(reason, sizeof(reason), "line %d is not action, value, faces and two timeouts", number);
+              error = reason;
+              ok = false;
+          }
+          else {
+              table.push_back(row);
+          }
+      }
+      std::fclose(file);
+      return ok;
+  }
+}
+
+CallProtocol::Parameters::Parameters() :
+    faceTimeout(5000), callTimeout(5000), nameCalls(5), phraseCalls(2), responseFaces(2) {
+}
+
+CallProtocol::CallProtocol(const Parameters &parameters, const ResponseDetector::Thresholds &response) :
+    rows(tableOf(parameters)), detector(response) {
+    start(0);
+}
+
+CallProtocol::CallProtocol(const Table &table, const ResponseDetector::Thresholds &response) :
+    rows(table), detector(response) {
+    start(0);
+}
+
+CallProtocol::Table CallProtocol::tableOf(const Parameters &parameters) {
+    Table table;
+    int calls = parameters.nameCalls + parameters.phraseCalls;
+    for( int i = 0; i <= calls; ++i ) {
+        Row row;
+        if( i < parameters.nameCalls ) {
+            row.action = CallByName;
+            row.value = i + 1;
+        }
+        else if( i < calls ) {
+            row.action = CallWithPhrase;
+            row.value = i - parameters.nameCalls + 1;
+        }
+        else {
+            row.action = EndSession;
+            row.value = -1;
+        }
+        // Child can only respond once called
+        row.responseFaces = i > 0 ? parameters.responseFaces : 0;
+        row.faceTimeout = parameters.faceTimeout;
+        row.callTimeout = parameters.callTimeout;
+        table.push_back(row);
+    }
+    return table;
+}
+
+bool CallProtocol::validate(const Table &table, std::string &error) {
+    char reason[128];
+    if( table.empty() || table.size() > MaxRows ) {
+        std::snprintf(reason, sizeof(reason), "protocol has %lu rows, it must have 1 to %d",
+                      static_cast<unsigned long>(table.size()), static_cast<int>(MaxRows));
+        error = reason;
+        return false;
+    }
+    for( std::size_t i = 0; i < table.size(); ++i ) {
+        const Row &row = table[i];
+        reason[0] = '\0';
+        if( row.action != CallByName && row.action != CallWithPhrase && row.action != EndSession ) {
+            std::snprintf(reason, sizeof(reason), "row %lu has no action", static_cast<unsigned long>(i + 1));
+        }
+        else if( (row.action == EndSession) != (i + 1 == table.size()) ) {
+            std::snprintf(reason, sizeof(reason), "row %lu is %s, only the last row ends the session",
+                          static_cast<unsigned long>(i + 1), actionName(row.action));
+        }
+        else if( row.action == EndSession && row.value == 1 ) {
+            std::snprintf(reason, sizeof(reason), "last row ends with SE 1, which means the child responded");
+        }
+        else if( row.faceTimeout < 0 || row.callTimeout < 0 ) {
+            std::snprintf(reason, sizeof(reason), "row %lu has a negative timeout", static_cast<unsigned long>(i + 1));
+        }
+        else if( row.action != EndSession && row.callTimeout == 0 ) {
+            // Call is only counted once it ended, so it would be made again and again until then
+            std::snprintf(reason, sizeof(reason), "row %lu calls with no call timeout", static_cast<unsigned long>(i + 1));
+        }
+        else if( row.responseFaces < 0 || (i == 0 && row.responseFaces != 0) ) {
+            std::snprintf(reason, sizeof(reason), "row %lu has %d response faces, the first row must have none",
+                          static_cast<unsigned long>(i + 1), row.responseFaces);
+        }
+        if( reason[0] != '\0' ) {
+            error = reason;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool CallProtocol::load(const std::string &source, Table &table, std::string &error) {
+    if( source == ProtocolTable<StudyProtocol>::name ) {
+        table = builtinTable<StudyProtocol>();
+    }
+    else if( !readTable(source, table, error) ) {
+        return false;
+    }
+    return validate(table, error);
+}
+
+void CallProtocol::start(long long now) {
+    lastFace = now;
+    lastCall = now;
+    iterations = 0;
+    faces = 0;
+    detector.start();
+    sessionEnded = false;
+}
+
+void CallProtocol::resume(int calls, long long lastCallTime, long long lastFaceTime) {
+    start(0);
+    iterations = calls;
+    lastCall = lastCallTime;
+    lastFace = lastFaceTime;
+    if( iterations > 0 ) {
+        detector.open(lastCall, rows[std::min<std::size_t>(iterations, rows.size() - 1)].responseFaces);
+    }
+}
+
+int CallProtocol::faceDetected(long long now) {
+    lastFace = std::max(lastFace, now);
+    detector.faceDetected(now);
+    return ++faces;
+}
+
+int CallProtocol::callEnded(long long now) {
+    lastCall = std::max(lastCall, now);
+    faces = 0;
+    ++iterations;
+    // Window of the call opens with the response faces of the state it moved to
+    detector.open(now, rows[std::min<std::size_t>(iterations, rows.size() - 1)].responseFaces);
+    return iterations;
+}
+
+CallProtocol::Decision CallProtocol::step(long long now) {
+    Decision decision;
+    decision.action = None;
+    decision.value = 0;
+    decision.deadline = Never;
+
+    // Nothing more to decide
+    if( sessionEnded ) {
+        return decision;
+    }
+
+    // State is the number of calls made, a call ending without being decided stays in the last state
+    const Row &row = rows[std::min<std::size_t>(iterations, rows.size() - 1)];
+
+    // Child responded after the last call
+    if( detector.responded() ) {
+        decision.action = EndSession;
+        decision.value = 1;
+        sessionEnded = true;
+        return decision;
+    }
+
+    // Next action is due after both the last face and the last call timed out
+    decision.deadline = std::max(lastFace + row.faceTimeout, lastCall + row.callTimeout);
+    if( now < decision.deadline ) {
+        return decision;
+    }
+
+    decision.action = row.action;
+    decision.value = row.value;
+    if( row.action == EndSession ) {
+        decision.deadline = Never;
+        sessionEnded = true;
+        return decision;
+    }
+    faces = 0;
+    detector.close();
+    lastCall = now;
+    decision.deadline = std::max(lastFace + row.faceTimeout, lastCall + row.callTimeout);
+    return decision;
+}
+
+const CallProtocol::Table &CallProtocol::table() const {
+    return rows;
+}
+
+int CallProtocol::iteration() const {
+    return iterations;
+}
+
+const ResponseDetector &CallProtocol::response() const {
+    return detector;
+}
+
+int CallProtocol::faceCount() const {
+    return faces;
+}
+
+bool CallProtocol::ended() const {
+    return sessionEnded;
+}
+
+long long CallProtocol::lastFaceTime() const {
+    return lastFace;
+}
+
+long long CallProtocol::lastCallTime() const {
+    return lastCall;
+}
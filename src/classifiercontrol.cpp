@@ -0,0 +1,133 @@
+#include "classifiercontrol.hpp"
+#include "monotonictime.hpp"
+#include <boost/bind.hpp>
+
+ClassifierControl::ClassifierControl(const Executor &execute, LatencyHistogram *startHistogram, LatencyHistogram *stopHistogram) :
+    executor(execute), startLatency(startHistogram), stopLatency(stopHistogram),
+    busy(false), shutdown(false), sentCount(0), mergedCount(0), failedCount(0) {
+    for( int i = 0; i < MaxClassifiers; ++i ) {
+        expected[i] = false;
+        confirmed[i] = false;
+    }
+    worker = boost::thread(boost::bind(&ClassifierControl::work, this));
+}
+
+ClassifierControl::~ClassifierControl() {
+    {
+        boost::mutex::scoped_lock lock(mutex);
+        shutdown = true;
+        condition.notify_all();
+    }
+    if( worker.joinable() ) {
+        worker.join();
+    }
+}
+
+void ClassifierControl::start(int classifier) {
+    push(classifier, true);
+}
+
+void ClassifierControl::stop(int classifier) {
+    push(classifier, false);
+}
+
+void ClassifierControl::push(int classifier, bool run) {
+    if( classifier < 0 || classifier >= MaxClassifiers ) {
+        return;
+    }
+    boost::mutex::scoped_lock lock(mutex);
+    // Last command still queued for the classifier decides what the new one changes
+    for( std::deque<Command>::reverse_iterator i = queue.rbegin(); i != queue.rend(); ++i ) {
+        if( i->classifier != classifier ) {
+            continue;
+        }
+        if( i->run != run ) {
+            // Classifier stays as it is before the queued command
+            queue.erase(--(i.base()));
+            mergedCount += 2;
+        }
+        else {
+            ++mergedCount;
+        }
+        return;
+    }
+    if( expected[classifier] == run ) {
+        ++mergedCount;
+        return;
+    }
+    Command command;
+    command.classifier = classifier;
+    command.run = run;
+    command.queued = monotonicTime();
+    queue.push_back(command);
+    condition.notify_one();
+}
+
+bool ClassifierControl::running(int classifier) {
+    boost::mutex::scoped_lock lock(mutex);
+    return classifier >= 0 && classifier < MaxClassifiers && confirmed[classifier];
+}
+
+void ClassifierControl::flush() {
+    boost::mutex::scoped_lock lock(mutex);
+    while( !queue.empty() || busy ) {
+        idle.wait(lock);
+    }
+}
+
+unsigned long ClassifierControl::sent() const {
+    return sentCount;
+}
+
+unsigned long ClassifierControl::merged() const {
+    return mergedCount;
+}
+
+unsigned long ClassifierControl::failed() const {
+    return failedCount;
+}
+
+void ClassifierControl::work() {
+    boost::mutex::scoped_lock lock(mutex);
+    while( true ) {
+        while( queue.empty() && !shutdown ) {
+            condition.wait(lock);
+        }
+        // Commands queued before the control is destroyed are still carried out
+        if( queue.empty() ) {
+            return;
+        }
+        Command command = queue.front();
+        queue.pop_front();
+        expected[command.classifier] = command.run;
+        busy = true;
+        lock.unlock();
+
+        bool taken = executor(command.classifier, command.run);
+        LatencyHistogram *latency = command.run ? startLatency : stopLatency;
+        if( latency ) {
+            latency->record(monotonicTime() - command.queued);
+        }
+
+        lock.lock();
+        busy = false;
+        ++sentCount;
+        if( taken ) {
+            confirmed[command.classifier] = command.run;
+        }
+        else {
+            // Next command for the classifier is compared with what it last confirmed, so a failed one is tried again
+            ++failedCount;
+            bool queuedFor = false;
+            for( std::size_t i = 0; i < queue.size(); ++i ) {
+                queuedFor = queuedFor || queue[i].classifier == command.classifier;
+            }
+            if( !queuedFor ) {
+                expected[command.classifier] = confirmed[command.classifier];
+            }
+        }
+        if( queue.empty() ) {
+            idle.notify_all();
+        }
+    }
+}
@@ -0,0 +1,50 @@
+#include "concurrentsetup.hpp"
+#include "monotonictime.hpp"
+#include <boost/bind.hpp>
+#include <exception>
+#include <qi/log.hpp>
+
+ConcurrentSetup::ConcurrentSetup() : finished(0) {
+}
+
+ConcurrentSetup::~ConcurrentSetup() {
+    wait();
+}
+
+void ConcurrentSetup::run(const Step &step, LatencyHistogram *latency) {
+    boost::mutex::scoped_lock lock(mutex);
+    threads.push_back(boost::shared_ptr<boost::thread>(new boost::thread(boost::bind(&ConcurrentSetup::runStep, this, step, latency))));
+}
+
+long long ConcurrentSetup::wait() {
+    boost::mutex::scoped_lock lock(mutex);
+    for( std::size_t i = 0; i < threads.size(); ++i ) {
+        threads[i]->join();
+    }
+    threads.clear();
+    return finished;
+}
+
+void ConcurrentSetup::runStep(Step step, LatencyHistogram *latency) {
+    long long start = monotonicTime();
+    try {
+        step();
+    }
+    catch (const std::exception& e) {
+        // Thread of a step must not end with an exception, the setup goes on without the step
+        qiLogError("ConcurrentSetup") << "Setup step failed " << e.what() << std::endl;
+    }
+    long long end = monotonicTime();
+    if( latency ) {
+        latency->record(end - start);
+    }
+    // Steps finish in any order, the latest end is kept
+    long long last = finished;
+    while( end > last ) {
+        long long seen = __sync_val_compare_and_swap(&finished, last, end);
+        if( seen == last ) {
+            break;
+        }
+        last = seen;
+    }
+}
@@ -0,0 +1,92 @@
+#include "deadlinescheduler.hpp"
+#include "monotonictime.hpp"
+#include <boost/bind.hpp>
+
+const long long DeadlineScheduler::Never = 0x7FFFFFFFFFFFFFFFLL;
+
+DeadlineScheduler::DeadlineScheduler() : active(false), woken(false), running(false), shutdown(false), wakeupCount(0) {
+}
+
+DeadlineScheduler::~DeadlineScheduler() {
+    {
+        boost::mutex::scoped_lock lock(mutex);
+        shutdown = true;
+        active = false;
+        condition.notify_all();
+    }
+    if( worker.joinable() ) {
+        worker.join();
+    }
+}
+
+void DeadlineScheduler::start(const Task &newTask) {
+    boost::mutex::scoped_lock lock(mutex);
+    // Worker thread survives between sessions, it is only created once
+    if( !worker.joinable() ) {
+        worker = boost::thread(boost::bind(&DeadlineScheduler::run, this));
+    }
+    // Previous session may still be finishing its last run
+    while( running ) {
+        idle.wait(lock);
+    }
+    task = newTask;
+    wakeupCount = 0;
+    active = true;
+    woken = true;
+    condition.notify_all();
+}
+
+void DeadlineScheduler::wake() {
+    boost::mutex::scoped_lock lock(mutex);
+    woken = true;
+    condition.notify_all();
+}
+
+void DeadlineScheduler::stop() {
+    boost::mutex::scoped_lock lock(mutex);
+    active = false;
+    condition.notify_all();
+    // Task stopping its own scheduler must not wait for itself
+    if( boost::this_thread::get_id() == worker.get_id() ) {
+        return;
+    }
+    while( running ) {
+        idle.wait(lock);
+    }
+}
+
+unsigned long DeadlineScheduler::wakeups() {
+    boost::mutex::scoped_lock lock(mutex);
+    return wakeupCount;
+}
+
+void DeadlineScheduler::run() {
+    boost::mutex::scoped_lock lock(mutex);
+    while( !shutdown ) {
+        // No session in progress, sleep until started or destroyed
+        if( !active ) {
+            condition.wait(lock);
+            continue;
+        }
+
+        // Run the task without holding the lock, so callbacks can wake the worker meanwhile
+        woken = false;
+        running = true;
+        ++wakeupCount;
+        lock.unlock();
+        long long deadline = task();
+        lock.lock();
+        running = false;
+        idle.notify_all();
+
+        // Sleep until the deadline, or until woken, stopped or destroyed, in a single wait unless woken spuriously
+        while( active && !woken && !shutdown ) {
+            if( deadline == Never ) {
+                condition.wait(lock);
+            }
+            else if( !condition.waitUntil(lock, deadline) || monotonicTime() >= deadline ) {
+                break;
+            }
+        }
+    }
+}
@@ -0,0 +1,123 @@
+#include "eventbus.hpp"
+#include <boost/thread/thread.hpp>
+
+EventBus::Endpoint::Endpoint(const std::string &module, const std::vector<std::string> &received) :
+    name(module), events(received), accepting(0), producers(0), sleeping(0) {
+}
+
+const std::string &EventBus::Endpoint::module() const {
+    return name;
+}
+
+bool EventBus::Endpoint::wants(const std::string &event) const {
+    for( std::size_t i = 0; i < events.size(); ++i ) {
+        if( events[i] == event ) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool EventBus::Endpoint::push(const Message &message) {
+    // Producer count lets close() know when no push can be in flight anymore
+    __sync_fetch_and_add(&producers, 1);
+    bool queued = accepting && queue.push(message);
+    if( queued ) {
+        // Receiver announces it is going to sleep before checking the queue a last time
+        __sync_synchronize();
+        if( sleeping ) {
+            boost::mutex::scoped_lock lock(mutex);
+            condition.notify_one();
+        }
+    }
+    __sync_fetch_and_sub(&producers, 1);
+    return queued;
+}
+
+bool EventBus::Endpoint::wait(Message &message) {
+    while( true ) {
+        if( queue.pop(message) ) {
+            return true;
+        }
+        if( !accepting ) {
+            return false;
+        }
+        boost::mutex::scoped_lock lock(mutex);
+        sleeping = 1;
+        __sync_synchronize();
+        if( queue.size() == 0 && accepting ) {
+            condition.wait(lock);
+        }
+        sleeping = 0;
+    }
+}
+
+void EventBus::Endpoint::open() {
+    Message message;
+    while( queue.pop(message) ) {
+    }
+    __sync_lock_test_and_set(&accepting, 1);
+}
+
+void EventBus::Endpoint::close() {
+    // Stop accepting messages and wait for pushes already in progress
+    __sync_lock_test_and_set(&accepting, 0);
+    while( producers != 0 ) {
+        boost::this_thread::yield();
+    }
+    boost::mutex::scoped_lock lock(mutex);
+    condition.notify_all();
+}
+
+EventBus::EventBus() {
+    for( int i = 0; i < MaxEndpoints; ++i ) {
+        endpoints[i] = 0;
+    }
+}
+
+EventBus *EventBus::instance(int version, std::size_t busSize, std::size_t endpointSize, std::size_t messageSize) {
+    if( version != Version || busSize != sizeof(EventBus) || endpointSize != sizeof(Endpoint) ||
+        messageSize != sizeof(Message) ) {
+        return 0;
+    }
+    // Initialisation of a local static is guarded, modules starting at once get the same bus
+    static EventBus *bus = new EventBus();
+    return bus;
+}
+
+EventBus::Endpoint *EventBus::attach(const std::string &module, const std::vector<std::string> &events) {
+    boost::mutex::scoped_lock lock(mutex);
+    int free = -1;
+    for( int i = 0; i < MaxEndpoints; ++i ) {
+        if( endpoints[i] && endpoints[i]->module() == module ) {
+            endpoints[i]->open();
+            return endpoints[i];
+        }
+        if( !endpoints[i] && free < 0 ) {
+            free = i;
+        }
+    }
+    if( free < 0 ) {
+        return 0;
+    }
+    Endpoint *endpoint = new Endpoint(module, events);
+    endpoint->open();
+    // Endpoint is complete before posting threads can see it
+    __sync_synchronize();
+    endpoints[free] = endpoint;
+    return endpoint;
+}
+
+int EventBus::post(const std::string &event, const AL::ALValue &value) {
+    Message message;
+    message.event = event;
+    message.value = value;
+    int queued = 0;
+    for( int i = 0; i < MaxEndpoints; ++i ) {
+        Endpoint *endpoint = endpoints[i];
+        if( endpoint && endpoint->wants(event) && endpoint->push(message) ) {
+            ++queued;
+        }
+    }
+    return queued;
+}
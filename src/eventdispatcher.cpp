@@ -0,0 +1,185 @@
+#include "eventdispatcher.hpp"
+#include <boost/bind.hpp>
+#include <qi/log.hpp>
+#include <algorithm>
+
+namespace
+{
+  /**
+    * Value carrying the time of the event, which tells two raises of the same event apart
+    */
+  bool isTimed(const AL::ALValue &value) {
+      return value.isArray() && value.getSize() == 3 && value[0].isInt() && value[1].isInt() && value[2].isInt();
+  }
+
+  bool sameEvent(const AL::ALValue &a, const AL::ALValue &b) {
+      return (int)a[0] == (int)b[0] && (int)a[1] == (int)b[1] && (int)a[2] == (int)b[2];
+  }
+}
+
+EventDispatcher::EventDispatcher(boost::shared_ptr<RemoteTransport> remote, const std::string &module,
+                                 LatencyHistograms *histograms) :
+    transport(remote), moduleName(module), latencies(histograms), subscribeLatency(0), unsubscribeLatency(0),
+    postLatency(0), bus(0), endpoint(0) {
+    if( latencies ) {
+        subscribeLatency = &latencies->add("ALMemory.subscribeToEvent");
+        unsubscribeLatency = &latencies->add("ALMemory.unsubscribeToEvent");
+        postLatency = &latencies->add("EventBus.post");
+    }
+}
+
+EventDispatcher::~EventDispatcher() {
+    disconnect();
+}
+
+void EventDispatcher::add(const std::string &event, const std::string &callback, const Handler &handler, Gate::Policy policy) {
+    boost::mutex::scoped_lock lock(mutex);
+    Route &route = routes[event];
+    route.callback = callback;
+    route.handler = handler;
+    route.gate = boost::shared_ptr<Gate>(new Gate(policy));
+    route.subscribed = false;
+    route.latency = latencies ? &latencies->add(callback) : 0;
+    route.echoSource = Memory;
+    route.echoPending = false;
+}
+
+EventDispatcher::Route *EventDispatcher::find(const std::string &event) {
+    std::map<std::string, Route>::iterator it = routes.find(event);
+    if( it == routes.end() ) {
+        qiLogError(moduleName.c_str()) << "No handler registered for " << event << std::endl;
+        return 0;
+    }
+    return &it->second;
+}
+
+void EventDispatcher::subscribe(const std::string &event) {
+    boost::mutex::scoped_lock lock(mutex);
+    Route *route = find(event);
+    // Subscription the transport only queued counts once ALMemory confirmed it, a failed one is asked for again
+    if( !route || (route->subscribed && transport->isSubscribed(event)) ) {
+        return;
+    }
+    long long start = LatencyHistogram::now();
+    try {
+        transport->subscribe(event, route->callback);
+        route->subscribed = true;
+    }
+    catch (const AL::ALError& e) {
+        qiLogError(moduleName.c_str()) << "Error subscribing to " << event << e.toString() << std::endl;
+    }
+    if( subscribeLatency ) {
+        subscribeLatency->record(LatencyHistogram::now() - start);
+    }
+}
+
+void EventDispatcher::unsubscribe(const std::string &event) {
+    boost::mutex::scoped_lock lock(mutex);
+    Route *route = find(event);
+    if( !route || (!route->subscribed && !transport->isSubscribed(event)) ) {
+        return;
+    }
+    long long start = LatencyHistogram::now();
+    try {
+        transport->unsubscribe(event);
+    }
+    catch (const AL::ALError& e) {
+        qiLogError(moduleName.c_str()) << "Error unsubscribing from " << event << e.toString() << std::endl;
+    }
+    if( unsubscribeLatency ) {
+        unsubscribeLatency->record(LatencyHistogram::now() - start);
+    }
+    route->subscribed = false;
+}
+
+void EventDispatcher::dispatch(const std::string &event, const AL::ALValue &value, Source source) {
+    long long start = LatencyHistogram::now();
+    // Routes are only added during module initialization, so the route outlives the lock
+    Route *route;
+    {
+        boost::mutex::scoped_lock lock(mutex);
+        route = find(event);
+        if( !route || (source == Bus && !route->subscribed) ) {
+            return;
+        }
+        // Event raised in this process arrives twice, through the bus and through ALMemory, the second copy is dropped
+        if( endpoint && isTimed(value) && std::find(busEvents.begin(), busEvents.end(), event) != busEvents.end() ) {
+            if( route->echoPending && route->echoSource != source && sameEvent(route->echo, value) ) {
+                route->echoPending = false;
+                return;
+            }
+            route->echo = value;
+            route->echoSource = source;
+            route->echoPending = true;
+        }
+    }
+
+    // Handler is already running in another thread, it takes care of this event
+    if( !route->gate->enter(value) ) {
+        if( route->latency ) {
+            route->latency->record(LatencyHistogram::now() - start);
+        }
+        return;
+    }
+    AL::ALValue current = value;
+    do {
+        try {
+            route->handler(current);
+        }
+        catch (const AL::ALError& e) {
+            qiLogError(moduleName.c_str()) << "Error handling " << event << e.toString() << std::endl;
+        }
+        catch (const std::exception& e) {
+            qiLogError(moduleName.c_str()) << "Error handling " << event << e.what() << std::endl;
+        }
+    } while( route->gate->next(current) );
+    if( route->latency ) {
+        route->latency->record(LatencyHistogram::now() - start);
+    }
+}
+
+bool EventDispatcher::connect(const std::vector<std::string> &events) {
+    if( endpoint ) {
+        return true;
+    }
+    bus = EventBus::find();
+    if( bus ) {
+        busEvents = events;
+        endpoint = bus->attach(moduleName, events);
+    }
+    if( !endpoint ) {
+        qiLogError(moduleName.c_str()) << "Event bus can not be used, events come through ALMemory only" << std::endl;
+        bus = 0;
+        return false;
+    }
+    busThread = boost::thread(boost::bind(&EventDispatcher::receive, this));
+    return true;
+}
+
+void EventDispatcher::disconnect() {
+    if( endpoint ) {
+        endpoint->close();
+        if( busThread.joinable() && busThread.get_id() != boost::this_thread::get_id() ) {
+            busThread.join();
+        }
+    }
+}
+
+void EventDispatcher::raise(const std::string &event, const AL::ALValue &value) {
+    // Module in this process gets the event at once, ALMemory still delivers it to everyone else
+    if( endpoint ) {
+        long long start = LatencyHistogram::now();
+        bus->post(event, value);
+        if( postLatency ) {
+            postLatency->record(LatencyHistogram::now() - start);
+        }
+    }
+    transport->raiseEvent(event, value);
+}
+
+void EventDispatcher::receive() {
+    EventBus::Message message;
+    while( endpoint->wait(message) ) {
+        dispatch(message.event, message.value, Bus);
+    }
+}
@@ -0,0 +1,27 @@
+#include "eventtime.hpp"
+
+AL::ALValue timedEventValue(int value, long long time) {
+    AL::ALValue result;
+    result.arrayPush(value);
+    result.arrayPush(static_cast<int>(time/1000000000LL));
+    result.arrayPush(static_cast<int>(time%1000000000LL));
+    return result;
+}
+
+int eventValue(const AL::ALValue &value) {
+    if( value.isArray() ) {
+        return value.getSize() > 0 ? (int)value[0] : 0;
+    }
+    return (int)value;
+}
+
+long long eventTime(const AL::ALValue &value, long long received) {
+    if( !value.isArray() || value.getSize() < 3 || !value[1].isInt() || !value[2].isInt() ) {
+        return received;
+    }
+    long long time = (int)value[1]*1000000000LL + (int)value[2];
+    if( time > received || received - time > MaxEventAge*1000000LL ) {
+        return received;
+    }
+    return time;
+}
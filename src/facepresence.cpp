@@ -0,0 +1,45 @@
+#include "facepresence.hpp"
+
+FacePresenceTracker::FacePresenceTracker(long long gapTolerance) : gap(gapTolerance), present(false) {
+    current.start = current.end = 0;
+    current.frames = 0;
+}
+
+void FacePresenceTracker::reset() {
+    present = false;
+    current.start = current.end = 0;
+    current.frames = 0;
+}
+
+bool FacePresenceTracker::addFace(long long time, Interval &closed) {
+    bool wasClosed = advance(time, closed);
+    if( !present ) {
+        present = true;
+        current.start = time;
+        current.frames = 0;
+    }
+    current.end = time;
+    ++current.frames;
+    return wasClosed;
+}
+
+bool FacePresenceTracker::advance(long long time, Interval &closed) {
+    if( !present || time - current.end <= gap ) {
+        return false;
+    }
+    return flush(closed);
+}
+
+bool FacePresenceTracker::flush(Interval &closed) {
+    if( !present ) {
+        return false;
+    }
+    closed = current;
+    present = false;
+    current.frames = 0;
+    return true;
+}
+
+int FacePresenceTracker::frames() const {
+    return present ? current.frames : 0;
+}
@@ -0,0 +1,82 @@
+#include "facesampler.hpp"
+#include "cputime.hpp"
+#include "monotonictime.hpp"
+#include <boost/bind.hpp>
+#include <qi/log.hpp>
+
+FaceSampler::FaceSampler(boost::shared_ptr<AL::ALMemoryProxy> memory, LatencyHistogram *latency) :
+    memoryProxy(memory), readLatency(latency), lastSeconds(-1), lastMicroseconds(-1), sampleCount(0), frameCount(0), cpuNanoseconds(0) {
+}
+
+void FaceSampler::start(int rate, unsigned int batchInterval, const BatchHandler &batchHandler) {
+    handler = batchHandler;
+    period = 1000000000LL/(rate > 0 ? rate : 1);
+    batchPeriod = batchInterval*1000000LL;
+    nextSample = monotonicTime();
+    nextBatch = nextSample + batchPeriod;
+    lastSeconds = lastMicroseconds = -1;
+    sampleCount = frameCount = 0;
+    cpuNanoseconds = 0;
+    faces.clear();
+    scheduler.start(boost::bind(&FaceSampler::sample, this));
+}
+
+void FaceSampler::stop() {
+    scheduler.stop();
+    // Hand over what was sampled after the last batch
+    handler(faces, monotonicTime());
+    faces.clear();
+}
+
+unsigned long FaceSampler::samples() const {
+    return sampleCount;
+}
+
+unsigned long FaceSampler::frames() const {
+    return frameCount;
+}
+
+long long FaceSampler::cpuTime() const {
+    return cpuNanoseconds;
+}
+
+long long FaceSampler::sample() {
+    long long cpuStart = threadCpuTime();
+    long long now = monotonicTime();
+    try {
+        long long readStart = LatencyHistogram::now();
+        AL::ALValue face = memoryProxy->getData("FaceDetected");
+        if( readLatency ) {
+            readLatency->record(LatencyHistogram::now() - readStart);
+        }
+        ++sampleCount;
+        // FaceDetected is empty when no face is visible, otherwise it starts with the [seconds, microseconds] timestamp
+        if( face.getSize() >= 2 && face[0].getSize() >= 2 ) {
+            int seconds = face[0][0];
+            int microseconds = face[0][1];
+            if( seconds != lastSeconds || microseconds != lastMicroseconds ) {
+                lastSeconds = seconds;
+                lastMicroseconds = microseconds;
+                faces.push_back(now);
+                ++frameCount;
+            }
+        }
+    }
+    catch (const AL::ALError& e) {
+        qiLogError("FaceSampler") << "Error reading FaceDetected" << e.toString() << std::endl;
+    }
+
+    if( now >= nextBatch ) {
+        handler(faces, now);
+        faces.clear();
+        nextBatch = now + batchPeriod;
+    }
+
+    // Keep a steady rate, but do not try to catch up on samples missed while the robot was busy
+    nextSample += period;
+    if( nextSample < now ) {
+        nextSample = now + period;
+    }
+    cpuNanoseconds += threadCpuTime() - cpuStart;
+    return nextSample;
+}
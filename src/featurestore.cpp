@@ -0,0 +1,297 @@
+#include "featurestore.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+  const unsigned int ByteOrderMark = 0x01020304;
+
+  std::size_t aligned(std::size_t size) {
+      return (size + 63) & ~static_cast<std::size_t>(63);
+  }
+
+  std::size_t timestampOffset() {
+      return 64;
+  }
+
+  std::size_t classOffset(int chunkRows) {
+      return timestampOffset() + aligned(8*chunkRows);
+  }
+
+  std::size_t featureOffset(int chunkRows, int column) {
+      return classOffset(chunkRows) + aligned(chunkRows) + column*aligned(4*chunkRows);
+  }
+
+  bool fail(std::string &error, const char *reason) {
+      error = reason;
+      return false;
+  }
+}
+
+std::size_t featureStoreChunkSize(int featureCount, int chunkRows) {
+    return featureOffset(chunkRows, featureCount);
+}
+
+FeatureStoreWriter::FeatureStoreWriter() :
+    start(0), featureCount(-1), chunkRows(FeatureStoreChunkRows), chunkIndex(0), rowCount(0), flushedRows(0) {
+}
+
+FeatureStoreWriter::~FeatureStoreWriter() {
+    close();
+}
+
+bool FeatureStoreWriter::open(const std::string &filename, long long sessionStart) {
+    close();
+    file.open(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    if( !file.is_open() ) {
+        return false;
+    }
+    start = sessionStart;
+    featureCount = -1;
+    chunkIndex = 0;
+    rowCount = 0;
+    flushedRows = 0;
+    chunk.clear();
+    return true;
+}
+
+void FeatureStoreWriter::writeHeader() {
+    char header[FeatureStoreHeaderSize];
+    std::memset(header, 0, sizeof(header));
+    std::memcpy(header, "RTNF", 4);
+    header[4] = FeatureStoreVersion;
+    std::memcpy(header + 8, &ByteOrderMark, 4);
+    std::memcpy(header + 12, &featureCount, 4);
+    std::memcpy(header + 16, &chunkRows, 4);
+    std::memcpy(header + 20, &start, 8);
+    file.write(header, sizeof(header));
+    chunk.assign(featureStoreChunkSize(featureCount, chunkRows), 0);
+}
+
+void FeatureStoreWriter::append(const LogRecord &record) {
+    if( !file.is_open() ) {
+        return;
+    }
+    // Width of the store is fixed by the first row
+    if( featureCount < 0 ) {
+        featureCount = record.featureCount;
+        writeHeader();
+    }
+    unsigned int row = rowCount % chunkRows;
+    char *base = &chunk[0];
+    // Store keeps milliseconds, records carry microseconds
+    long long timestamp = record.timestamp/1000;
+    std::memcpy(base + timestampOffset() + 8*row, &timestamp, 8);
+    base[classOffset(chunkRows) + row] = static_cast<signed char>(record.value);
+    for( int i = 0; i < featureCount; ++i ) {
+        float value = i < record.featureCount ? record.features[i] : std::numeric_limits<float>::quiet_NaN();
+        std::memcpy(base + featureOffset(chunkRows, i) + 4*row, &value, 4);
+    }
+    ++rowCount;
+    ++row;
+    std::memcpy(base, &row, 4);
+    // Full chunk is written out for good, the next one starts empty
+    if( row == chunkRows ) {
+        flush();
+        ++chunkIndex;
+        flushedRows = 0;
+        std::fill(chunk.begin(), chunk.end(), 0);
+    }
+}
+
+void FeatureStoreWriter::flush() {
+    unsigned int row = 0;
+    if( !chunk.empty() ) {
+        std::memcpy(&row, &chunk[0], 4);
+    }
+    if( row == flushedRows ) {
+        return;
+    }
+    std::streamoff base = static_cast<std::streamoff>(FeatureStoreHeaderSize + chunkIndex*chunk.size());
+    // Chunk takes its whole size with its first write, what is not written yet reads as zeros
+    if( flushedRows == 0 ) {
+        file.seekp(base + static_cast<std::streamoff>(chunk.size()) - 1);
+        file.put(0);
+    }
+    // Only the rows appended since the last flush are written in each column, the row count after them
+    writeRows(base, timestampOffset(), 8, row);
+    writeRows(base, classOffset(chunkRows), 1, row);
+    for( int i = 0; i < featureCount; ++i ) {
+        writeRows(base, featureOffset(chunkRows, i), 4, row);
+    }
+    file.seekp(base);
+    file.write(&chunk[0], 4);
+    file.flush();
+    flushedRows = row;
+}
+
+void FeatureStoreWriter::writeRows(std::streamoff base, std::size_t column, std::size_t width, unsigned int row) {
+    std::size_t from = column + width*flushedRows;
+    file.seekp(base + static_cast<std::streamoff>(from));
+    file.write(&chunk[from], width*(row - flushedRows));
+}
+
+void FeatureStoreWriter::close() {
+    if( !file.is_open() ) {
+        return;
+    }
+    flush();
+    file.close();
+}
+
+unsigned long FeatureStoreWriter::rows() const {
+    return rowCount;
+}
+
+FeatureStoreReader::FeatureStoreReader() :
+    data(0), size(0), features(0), chunkRows(0), start(0), chunkCount(0), rowCount(0) {
+}
+
+FeatureStoreReader::~FeatureStoreReader() {
+    close();
+}
+
+bool FeatureStoreReader::open(const std::string &path, std::string &error) {
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if( fd < 0 ) {
+        return fail(error, "file can not be opened");
+    }
+    struct stat info;
+    if( ::fstat(fd, &info) != 0 || info.st_size < FeatureStoreHeaderSize ) {
+        ::close(fd);
+        return fail(error, "no feature store header");
+    }
+    void *mapped = ::mmap(0, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if( mapped == MAP_FAILED ) {
+        return fail(error, "file can not be mapped");
+    }
+    data = static_cast<const char *>(mapped);
+    size = info.st_size;
+
+    unsigned int mark;
+    std::memcpy(&mark, data + 8, 4);
+    std::memcpy(&features, data + 12, 4);
+    std::memcpy(&chunkRows, data + 16, 4);
+    std::memcpy(&start, data + 20, 8);
+    if( std::memcmp(data, "RTNF", 4) != 0 || data[4] != FeatureStoreVersion ) {
+        close();
+        return fail(error, "not a feature store");
+    }
+    if( mark != ByteOrderMark ) {
+        close();
+        return fail(error, "feature store written with another byte order");
+    }
+    if( features < 0 || features > LogRecord::MaxFeatures || chunkRows <= 0 || chunkRows % 64 != 0 ) {
+        close();
+        return fail(error, "corrupt feature store header");
+    }
+    chunkCount = (size - FeatureStoreHeaderSize)/featureStoreChunkSize(features, chunkRows);
+    ::madvise(mapped, size, MADV_SEQUENTIAL);
+    for( std::size_t i = 0; i < chunkCount; ++i ) {
+        unsigned int chunkRowCount;
+        std::memcpy(&chunkRowCount, chunkData(i), 4);
+        if( chunkRowCount > static_cast<unsigned int>(chunkRows) ) {
+            close();
+            return fail(error, "corrupt feature store chunk");
+        }
+        rowCount += chunkRowCount;
+    }
+    return true;
+}
+
+void FeatureStoreReader::close() {
+    if( data ) {
+        ::munmap(const_cast<char *>(data), size);
+    }
+    data = 0;
+    size = 0;
+    features = 0;
+    chunkRows = 0;
+    start = 0;
+    chunkCount = 0;
+    rowCount = 0;
+}
+
+int FeatureStoreReader::featureCount() const {
+    return features;
+}
+
+long long FeatureStoreReader::sessionStart() const {
+    return start;
+}
+
+std::size_t FeatureStoreReader::chunks() const {
+    return chunkCount;
+}
+
+std::size_t FeatureStoreReader::rows() const {
+    return rowCount;
+}
+
+const char *FeatureStoreReader::chunkData(std::size_t chunk) const {
+    return data + FeatureStoreHeaderSize + chunk*featureStoreChunkSize(features, chunkRows);
+}
+
+FeatureStoreReader::Column<long long> FeatureStoreReader::timestamps(std::size_t chunk) const {
+    const char *base = chunkData(chunk);
+    Column<long long> column;
+    column.data = reinterpret_cast<const long long *>(base + timestampOffset());
+    column.size = *reinterpret_cast<const unsigned int *>(base);
+    return column;
+}
+
+FeatureStoreReader::Column<signed char> FeatureStoreReader::classes(std::size_t chunk) const {
+    const char *base = chunkData(chunk);
+    Column<signed char> column;
+    column.data = reinterpret_cast<const signed char *>(base + classOffset(chunkRows));
+    column.size = *reinterpret_cast<const unsigned int *>(base);
+    return column;
+}
+
+FeatureStoreReader::Column<float> FeatureStoreReader::feature(std::size_t chunk, int index) const {
+    const char *base = chunkData(chunk);
+    Column<float> column;
+    column.data = reinterpret_cast<const float *>(base + featureOffset(chunkRows, index));
+    column.size = *reinterpret_cast<const unsigned int *>(base);
+    return column;
+}
+
+FeatureStatistics featureStatistics(const FeatureStoreReader &store, int column, int soundClass) {
+    FeatureStatistics statistics;
+    statistics.count = 0;
+    statistics.mean = 0;
+    statistics.deviation = 0;
+    statistics.min = std::numeric_limits<float>::infinity();
+    statistics.max = -std::numeric_limits<float>::infinity();
+    double sum = 0, squares = 0;
+    for( std::size_t chunk = 0; chunk < store.chunks(); ++chunk ) {
+        FeatureStoreReader::Column<float> values = store.feature(chunk, column);
+        FeatureStoreReader::Column<signed char> classes = store.classes(chunk);
+        // Plain loop over contiguous values, the compiler vectorises it
+        for( std::size_t i = 0; i < values.size; ++i ) {
+            float value = values.data[i];
+            if( value != value || (soundClass >= -1 && classes.data[i] != soundClass) ) {
+                continue;
+            }
+            sum += value;
+            squares += static_cast<double>(value)*value;
+            statistics.min = std::min(statistics.min, value);
+            statistics.max = std::max(statistics.max, value);
+            ++statistics.count;
+        }
+    }
+    if( statistics.count > 0 ) {
+        statistics.mean = sum/statistics.count;
+        double variance = squares/statistics.count - statistics.mean*statistics.mean;
+        statistics.deviation = variance > 0 ? std::sqrt(variance) : 0;
+    }
+    return statistics;
+}
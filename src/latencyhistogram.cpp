@@ -0,0 +1,159 @@
+#include "latencyhistogram.hpp"
+#include "monotonictime.hpp"
+#include <cstring>
+
+LatencyHistogram::LatencyHistogram() : total(0), sum(0), maximum(0) {
+    for( std::size_t i = 0; i < Buckets; ++i ) {
+        counts[i] = 0;
+    }
+}
+
+std::size_t LatencyHistogram::bucketOf(long long microseconds) {
+    if( microseconds < SubBuckets ) {
+        return microseconds < 0 ? 0 : static_cast<std::size_t>(microseconds);
+    }
+    // Power of two of the latency selects the group, the next three bits the bucket within it
+    int power = 63 - __builtin_clzll(static_cast<unsigned long long>(microseconds));
+    std::size_t bucket = SubBuckets + (power - 3)*SubBuckets + ((microseconds >> (power - 3)) - SubBuckets);
+    return bucket < Buckets ? bucket : Buckets - 1;
+}
+
+long long LatencyHistogram::bucketLimit(std::size_t bucket) {
+    if( bucket < SubBuckets ) {
+        return bucket;
+    }
+    int shift = static_cast<int>((bucket - SubBuckets)/SubBuckets);
+    long long lower = static_cast<long long>(SubBuckets + (bucket - SubBuckets)%SubBuckets) << shift;
+    return lower + (1LL << shift) - 1;
+}
+
+long long LatencyHistogram::now() {
+    return monotonicTime();
+}
+
+void LatencyHistogram::record(long long nanoseconds) {
+    long long microseconds = nanoseconds/1000;
+    __sync_fetch_and_add(&counts[bucketOf(microseconds)], 1);
+    __sync_fetch_and_add(&total, 1);
+    __sync_fetch_and_add(&sum, microseconds);
+    long long current = maximum;
+    while( microseconds > current ) {
+        long long previous = __sync_val_compare_and_swap(&maximum, current, microseconds);
+        if( previous == current ) {
+            break;
+        }
+        current = previous;
+    }
+}
+
+void LatencyHistogram::snapshot(Snapshot &snapshot, bool reset) {
+    // Counts are taken one by one, a latency recorded meanwhile may be missing from some of them
+    if( reset ) {
+        for( std::size_t i = 0; i < Buckets; ++i ) {
+            snapshot.buckets[i] = __sync_fetch_and_and(&counts[i], 0UL);
+        }
+        snapshot.count = __sync_fetch_and_and(&total, 0UL);
+        snapshot.sum = __sync_fetch_and_and(&sum, 0LL);
+        snapshot.max = __sync_fetch_and_and(&maximum, 0LL);
+    }
+    else {
+        for( std::size_t i = 0; i < Buckets; ++i ) {
+            snapshot.buckets[i] = __sync_fetch_and_add(&counts[i], 0UL);
+        }
+        snapshot.count = __sync_fetch_and_add(&total, 0UL);
+        snapshot.sum = __sync_fetch_and_add(&sum, 0LL);
+        snapshot.max = __sync_fetch_and_add(&maximum, 0LL);
+    }
+}
+
+double LatencyHistogram::Snapshot::mean() const {
+    return count > 0 ? static_cast<double>(sum)/count : 0;
+}
+
+double LatencyHistogram::Snapshot::percentile(double fraction) const {
+    unsigned long counted = 0;
+    for( std::size_t i = 0; i < Buckets; ++i ) {
+        counted += buckets[i];
+    }
+    unsigned long rank = static_cast<unsigned long>(fraction*counted + 0.5);
+    if( rank < 1 ) {
+        rank = 1;
+    }
+    unsigned long seen = 0;
+    for( std::size_t i = 0; i < Buckets; ++i ) {
+        seen += buckets[i];
+        if( seen >= rank ) {
+            // Largest latency is known exactly, the bucket limit can only overstate it
+            double limit = static_cast<double>(bucketLimit(i));
+            return limit < max ? limit : static_cast<double>(max);
+        }
+    }
+    return static_cast<double>(max);
+}
+
+LatencyHistogram &LatencyHistograms::add(const std::string &name) {
+    owned.push_back(boost::shared_ptr<LatencyHistogram>(new LatencyHistogram()));
+    attach(name, *owned.back());
+    return *owned.back();
+}
+
+void LatencyHistograms::attach(const std::string &name, LatencyHistogram &histogram) {
+    Entry entry;
+    entry.name = name;
+    entry.histogram = &histogram;
+    entries.push_back(entry);
+}
+
+AL::ALValue LatencyHistograms::toALValue(bool reset) {
+    AL::ALValue result;
+    result.arraySetSize(0);
+    LatencyHistogram::Snapshot snapshot;
+    for( std::size_t i = 0; i < entries.size(); ++i ) {
+        entries[i].histogram->snapshot(snapshot, reset);
+        AL::ALValue buckets;
+        buckets.arraySetSize(0);
+        for( std::size_t j = 0; j < LatencyHistogram::Buckets; ++j ) {
+            if( snapshot.buckets[j] > 0 ) {
+                AL::ALValue bucket;
+                bucket.arrayPush(static_cast<int>(LatencyHistogram::bucketLimit(j)));
+                bucket.arrayPush(static_cast<int>(snapshot.buckets[j]));
+                buckets.arrayPush(bucket);
+            }
+        }
+        AL::ALValue histogram;
+        histogram.arrayPush(entries[i].name);
+        histogram.arrayPush(static_cast<int>(snapshot.count));
+        // Sum of a busy histogram does not fit an int
+        histogram.arrayPush(static_cast<double>(snapshot.sum));
+        histogram.arrayPush(static_cast<int>(snapshot.max));
+        histogram.arrayPush(buckets);
+        result.arrayPush(histogram);
+    }
+    return result;
+}
+
+std::vector<LogRecord> LatencyHistograms::toLogRecords(long long timestamp) {
+    std::vector<LogRecord> records;
+    LatencyHistogram::Snapshot snapshot;
+    for( std::size_t i = 0; i < entries.size(); ++i ) {
+        entries[i].histogram->snapshot(snapshot);
+        if( snapshot.count == 0 ) {
+            continue;
+        }
+        LogRecord record;
+        record.event = LogLatency;
+        record.value = static_cast<int>(snapshot.count);
+        record.timestamp = timestamp;
+        record.duration = 0;
+        std::strncpy(record.name, entries[i].name.c_str(), LogRecord::MaxNameLength - 1);
+        record.name[LogRecord::MaxNameLength - 1] = '\0';
+        record.features[0] = static_cast<float>(snapshot.mean());
+        record.features[1] = static_cast<float>(snapshot.percentile(0.5));
+        record.features[2] = static_cast<float>(snapshot.percentile(0.9));
+        record.features[3] = static_cast<float>(snapshot.percentile(0.99));
+        record.features[4] = static_cast<float>(snapshot.max);
+        record.featureCount = 5;
+        records.push_back(record);
+    }
+    return records;
+}
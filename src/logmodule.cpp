@@ -5,19 +5,69 @@
  */
 
 #include "logmodule.hpp"
+#include "deadlinescheduler.hpp"
+#include "asynclogwriter.hpp"
+#include "eventdispatcher.hpp"
+#include "remotetransport.hpp"
+#include "concurrentsetup.hpp"
+#include "sessionstate.hpp"
+#include "sessioncheckpoint.hpp"
+#include "sessionlog.hpp"
+#include "audiofrontend.hpp"
+#include "classifiercontrol.hpp"
+#include "sessionmetrics.hpp"
+#include "facesampler.hpp"
+#include "facepresence.hpp"
+#include "cputime.hpp"
+#include "callprotocol.hpp"
+#include "latencyhistogram.hpp"
+#include "eventtime.hpp"
 #include <iostream>
 #include <fstream>
+#include <algorithm>
+#include <cstring>
+#include <ctime>
 #include <alvalue/alvalue.h>
 #include <alcommon/alproxy.h>
 #include <alcommon/albroker.h>
 #include <boost/date_time/posix_time/posix_time.hpp>
 #include <boost/thread.hpp>
+#include <boost/bind.hpp>
 #include <boost/lambda/lambda.hpp>
 #include <qi/log.hpp>
 #include <althread/alcriticalsection.h>
 
 struct ResponseToNameLogger::Impl {
 
+    /**
+      * Latency of every callback and proxy call, declared first as the other members record into it
+      */
+    LatencyHistograms latencies;
+    LatencyHistogram *startClassificationLatency;
+    LatencyHistogram *stopClassificationLatency;
+    LatencyHistogram *classifierStartLatency;
+    LatencyHistogram *classifierStopLatency;
+    LatencyHistogram *raiseEventLatency;
+    LatencyHistogram *processRemoteLatency;
+
+    /**
+      * Time from creating the module until it is warmed up, from the start of a session until the scheduler runs,
+      * and of each step of setting them up
+      */
+    LatencyHistogram *startupLatency;
+    LatencyHistogram *sessionStartLatency;
+    LatencyHistogram *connectLatency;
+    LatencyHistogram *prepareLogLatency;
+    LatencyHistogram *openLogLatency;
+    LatencyHistogram *loadProtocolLatency;
+    LatencyHistogram *subscribeLatency;
+    LatencyHistogram *resumeLatency;
+
+    /**
+      * Session left in the checkpoint is resumed if it was saved no longer ago than this, in nanoseconds
+      */
+    static const long long MaxResumeAge = 600000000000LL;
+
     /**
       * Proxy to ALMemory
       */
@@ -28,58 +78,223 @@ struct ResponseToNameLogger::Impl {
       */
     boost::shared_ptr<AL::ALProxy> classificationProxy;
 
+    /**
+      * Proxy to ALAudioDevice, which delivers the microphone buffers when sounds are classified by the Logger
+      */
+    boost::shared_ptr<AL::ALProxy> audioProxy;
+
+    /**
+      * Classifies sounds from the microphone buffers in the Logger, guarded by the audio lock
+      * Buffers only arrive from ALAudioDevice one at a time, the lock is contended only when classification starts
+      */
+    boost::shared_ptr<AudioFrontEnd> frontEnd;
+    boost::mutex audioLock;
+    std::vector<AudioFrontEnd::Sound> sounds;
+
+    /**
+      * Sounds are classified by the Logger instead of the sound classification module, set by the classifier parameter
+      * Client preferences are given to ALAudioDevice before the first subscription
+      */
+    bool internalClassifier;
+    volatile bool activeInternal;
+    bool audioPreferences;
+
+    /**
+      * Carries the calls to ALMemory and to the sound classification module, batched when the Logger is a remote binary
+      */
+    boost::shared_ptr<RemoteTransport> transport;
+
+    /**
+      * Routes subscribed events to the module, protecting the handlers from re-entry
+      */
+    boost::shared_ptr<EventDispatcher> dispatcher;
+
+    /**
+      * Reads FaceDetected at a fixed rate when faces are sampled instead of handled per event
+      */
+    boost::shared_ptr<FaceSampler> faceSampler;
+
+    /**
+      * Joins sampled faces into presence intervals, each interval is logged as a single FD record
+      */
+    FacePresenceTracker facePresence;
+
+    /**
+      * Call protocol, decides when the child is called and when the session ends
+      */
+    CallProtocol protocol;
+
+    /**
+      * Protects the protocol and the face presence tracker, never held while calling other modules
+      * Separate from the callback mutex because the sampler, which updates the protocol,
+      * is stopped while the callback mutex is held
+      */
+    boost::mutex protocolLock;
+
+    /**
+      * CPU time spent handling FaceDetected events during the session, in nanoseconds
+      */
+    volatile long long faceCpuTime;
+
     /**
       * Module object
       */
     ResponseToNameLogger &module;
 
     /**
-      * Mutex used to lock callback functions, making them thread safe
+      * Mutex serializing the start and end of sessions and parameter changes
+      * Event handlers do not take it, they enter the session state instead
       */
     boost::shared_ptr<AL::ALMutex> fCallbackMutex;
 
     /**
-      * Mutex used to lock the output file, making logging thread safe
+      * Session start, carried by StartSessionRTN so both modules count from the same moment, and the protocol state,
+      * published under the protocol lock and read without locking
       */
-    boost::mutex outputFileLock;
+    SessionState state;
 
     /**
-      * Boost thread, implementing continuous loop which schedules calls
+      * Checkpoint of the session, saved wherever the session state is published, set by the checkpoint parameter
+      * Session saved last and the CallChildRTN value of the call decided and not ended yet, both under the protocol lock
       */
-    boost::thread *t;
+    SessionCheckpoint checkpoint;
+    SessionCheckpoint::Session checkpointed;
+    int pendingCall;
 
     /**
-      * Time storing variables
+      * Log file writer, callbacks queue records and a background thread writes them
       */
-    boost::system_time lastFace;
-    boost::system_time lastCall;
-    boost::system_time sessionStart;
+    AsyncLogWriter logWriter;
 
     /**
-      * Log file
+      * Format of the log file, set by the logFormat parameter
       */
-    std::ofstream outputFile;
+    AsyncLogWriter::Format logFormat;
 
     /**
-      * Internal variables for storing the number of iterations, face appearances and sessions
+      * Rate at which FaceDetected is sampled, set by the faceSampling parameter
+      * 0 handles every FaceDetected event instead
       */
-    int iteration;
-    int faceCount;
-    int childCount;
-    bool ended;
+    int faceSamplingRate;
+    int activeSamplingRate;
+
+    /**
+      * Folder the session logs are written to, set by the logDirectory parameter
+      */
+    std::string logDirectory;
+
+    /**
+      * Sound features are also written to a columnar store next to the log, unless disabled by the featureStore parameter
+      */
+    bool featureStore;
+
+    /**
+      * Protocol of the sessions, name of a built-in protocol or path of a protocol file, set by the protocol parameter
+      * A file is read again at the start of every session
+      */
+    std::string protocolSource;
+
+    /**
+      * Thresholds of the response of the child, set by the responseDwell, responseGap and responseWindow parameters
+      */
+    ResponseDetector::Thresholds responseThresholds;
+
+    /**
+      * Size of the preallocated log segments and when logs are synced, set by the segmentSize and durability parameters
+      */
+    unsigned long long segmentSize;
+    LogStorage::Durability durability;
+
+    /**
+      * Deadline of the pending call, used to measure how late calls are made, only used by the scheduler
+      */
+    long long callDeadline;
 
     /**
       * Sound processing parameters
       */
     AL::ALValue parametriObrada, parametriSnimanje, parametri;
+
+    /**
+      * Sound classifiers, the external module and the Logger itself
+      */
+    enum Classifier { ExternalClassifier, InternalClassifier };
+
+    /**
+      * Starts and stops sound classification from a thread of its own, declared after everything it calls
+      * so the commands still queued are carried out before they are destroyed
+      */
+    boost::shared_ptr<ClassifierControl> classifierControl;
+
+    /**
+      * Monotonic time the module was created and how long it took until it was warmed up, in nanoseconds
+      */
+    long long created;
+    long long startupTime;
+
+    /**
+      * Creates the proxy to the sound classification module and prepares the log storage after init,
+      * every session waits for it before it starts
+      * Declared after everything it sets up, so it is joined before they are destroyed
+      */
+    ConcurrentSetup warmup;
+
+    /**
+      * Metrics of the session, kept up to date by the log writer thread with every record it writes, in order
+      * Metrics lock is only shared by the writer thread, the publisher and the start and end of a session,
+      * handlers never take it
+      * Published to ALMemory at most metricsRate times a second while they change, set by the metricsRate parameter
+      */
+    SessionMetricsTracker metrics;
+    boost::mutex metricsLock;
+    volatile int metricsChanged;
+    int metricsRate;
+    int activeMetricsRate;
+    long long metricsPublished;
+
+    /**
+      * Publishes the metrics from a thread of its own, woken when they change
+      */
+    DeadlineScheduler metricsPublisher;
+
+    /**
+      * Scheduler thread, sleeps until the next call is due or until woken by a callback
+      * Declared last so the worker is stopped before the rest of the object is destroyed
+      */
+    DeadlineScheduler scheduler;
+
     /**
       * Struct constructor, initializes module instance and callback mutex
       */
     Impl(ResponseToNameLogger &mod) : module(mod), fCallbackMutex(AL::ALMutex::createALMutex()) {
-        // Create proxy to ALMemory and sound classification module
+        created = monotonicTime();
+        startupTime = -1;
+        startClassificationLatency = &latencies.add("pocni_klasifikaciju");
+        stopClassificationLatency = &latencies.add("prekini_klasifikaciju");
+        classifierStartLatency = &latencies.add("Classifier.start");
+        classifierStopLatency = &latencies.add("Classifier.stop");
+        raiseEventLatency = &latencies.add("ALMemory.raiseEvent");
+        processRemoteLatency = &latencies.add("processRemote");
+        startupLatency = &latencies.add("Setup.startup");
+        sessionStartLatency = &latencies.add("Setup.sessionStart");
+        connectLatency = &latencies.add("Setup.classificationProxy");
+        prepareLogLatency = &latencies.add("Setup.prepareLog");
+        openLogLatency = &latencies.add("Setup.openLog");
+        loadProtocolLatency = &latencies.add("Setup.loadProtocol");
+        subscribeLatency = &latencies.add("Setup.subscribe");
+        resumeLatency = &latencies.add("Setup.resume");
+        pendingCall = 0;
+        metricsChanged = 0;
+        metricsRate = 2;
+        activeMetricsRate = 0;
+        metricsPublished = 0;
+        std::memset(&checkpointed, 0, sizeof(checkpointed));
+        latencies.attach("logWriter.write", logWriter.writeLatency());
+        logWriter.observe(boost::bind(&Impl::trackMetrics, this, _1));
+        // Create proxy to ALMemory, the sound classification module is not needed before the first session
         try {
             memoryProxy = boost::shared_ptr<AL::ALMemoryProxy>(new AL::ALMemoryProxy(mod.getParentBroker()));
-            classificationProxy = boost::shared_ptr<AL::ALProxy>(new AL::ALProxy(mod.getParentBroker(), "LRKlasifikacijaZvukova"));
+            warmup.run(boost::bind(&Impl::connectClassification, this), connectLatency);
         }
         catch (const AL::ALError& e) {
             qiLogError("ResponseToNameLogger") << "Error creating proxy to ALMemory" << e.toString() << std::endl;
@@ -88,8 +303,31 @@ struct ResponseToNameLogger::Impl {
         try {
             memoryProxy->declareEvent("CallChildRTN", "ResponseToNameLogger");
             memoryProxy->declareEvent("EndSessionRTN", "ResponseToNameLogger");
-            memoryProxy->subscribeToEvent("StartSessionRTN", "ResponseToNameLogger", "onStartLogger");
-            childCount = 0;
+            memoryProxy->declareEvent("SessionResumedRTN", "ResponseToNameLogger");
+#ifdef LOGGER_IS_REMOTE
+            transport = boost::shared_ptr<RemoteTransport>(new RemoteTransport(memoryProxy, "ResponseToNameLogger", RemoteTransport::Batched, &latencies));
+#else
+            transport = boost::shared_ptr<RemoteTransport>(new RemoteTransport(memoryProxy, "ResponseToNameLogger", RemoteTransport::Direct, &latencies));
+#endif
+            // Faces arriving while one is being handled carry no new information, every call end and sound is handled
+            dispatcher = boost::shared_ptr<EventDispatcher>(new EventDispatcher(transport, "ResponseToNameLogger", &latencies));
+            dispatcher->add("StartSessionRTN", "onStartLogger", boost::bind(&ResponseToNameLogger::startLogger, &mod, _1), EventDispatcher::Gate::Drop);
+            dispatcher->add("EndSessionRTN", "onStopLogger", boost::bind(&ResponseToNameLogger::stopLogger, &mod, _1), EventDispatcher::Gate::Drop);
+            dispatcher->add("FaceDetected", "onFaceDetected", boost::bind(&ResponseToNameLogger::faceDetected, &mod, _1), EventDispatcher::Gate::Drop);
+            dispatcher->add("ChildCalledRTN", "onChildCalled", boost::bind(&ResponseToNameLogger::childCalled, &mod, _1), EventDispatcher::Gate::Queue);
+            dispatcher->add("SoundClassified", "onSoundClassified", boost::bind(&ResponseToNameLogger::soundClassified, &mod, _1), EventDispatcher::Gate::Queue);
+            // Sessions are started for as long as the module lives
+            dispatcher->subscribe("StartSessionRTN");
+            callDeadline = monotonicTime();
+            logFormat = AsyncLogWriter::Text;
+            faceSamplingRate = 0;
+            logDirectory = "/home/nao/naoqi/modules/logs/";
+            featureStore = true;
+            protocolSource = ProtocolTable<StudyProtocol>::name;
+            segmentSize = LogStorage::DefaultSegmentSize;
+            durability = LogStorage::SessionSync;
+            activeSamplingRate = 0;
+            faceSampler = boost::shared_ptr<FaceSampler>(new FaceSampler(memoryProxy, &latencies.add("ALMemory.getData")));
             parametriObrada.arrayPush(10000); //granica glasnoce
             parametriObrada.arrayPush(5); //broj okvira koje kupim
             parametriObrada.arrayPush(5); //broj buffera po okviru
@@ -99,6 +337,28 @@ struct ResponseToNameLogger::Impl {
             parametriSnimanje.arrayPush(16384); //velicina buffera
             parametri.arrayPush(parametriObrada);
             parametri.arrayPush(parametriSnimanje);
+            internalClassifier = false;
+            activeInternal = false;
+            audioPreferences = false;
+            AudioFrontEnd::Parameters audio;
+            audio.loudness = parametriObrada[0];
+            audio.frames = parametriObrada[1];
+            audio.buffersPerFrame = parametriObrada[2];
+            audio.sampleRate = parametriSnimanje[0];
+            frontEnd = boost::shared_ptr<AudioFrontEnd>(new AudioFrontEnd(audio));
+            classifierControl = boost::shared_ptr<ClassifierControl>(new ClassifierControl(
+                boost::bind(&Impl::controlClassifier, this, _1, _2), classifierStartLatency, classifierStopLatency));
+#if defined(RTN_EVENT_BUS) && !defined(LOGGER_IS_REMOTE)
+            // Interface loaded into the same process talks to the Logger through the event bus
+            std::vector<std::string> busEvents;
+            busEvents.push_back("StartSessionRTN");
+            busEvents.push_back("EndSessionRTN");
+            busEvents.push_back("ChildCalledRTN");
+            dispatcher->connect(busEvents);
+#endif
+            // Index of the log directory is read and the next segment preallocated before the first session
+            warmup.run(boost::bind(&Impl::prepareLog, this, logDirectory, segmentSize, durability), prepareLogLatency);
+            openCheckpoint(logDirectory + "session.rtnc");
         }
         catch (const AL::ALError& e) {
             qiLogError("ResponseToNameLogger") << "Error setting up Logger" << e.toString() << std::endl;
@@ -107,161 +367,782 @@ struct ResponseToNameLogger::Impl {
     }
 
     /**
-      * Thread-safe logging function
+      * Destructor, no event arrives through the bus once the members start to go away
+      */
+    ~Impl() {
+        if( dispatcher ) {
+            dispatcher->disconnect();
+        }
+        // Writer thread feeds the metrics, the log is closed while they still exist
+        logWriter.close();
+    }
+
+    /**
+      * Warm-up step, creates the proxies to the sound classification module and to ALAudioDevice
+      */
+    void connectClassification() {
+        try {
+            classificationProxy = boost::shared_ptr<AL::ALProxy>(new AL::ALProxy(module.getParentBroker(), "LRKlasifikacijaZvukova"));
+        }
+        catch (const AL::ALError& e) {
+            qiLogError("ResponseToNameLogger") << "Error creating proxy to sound classification" << e.toString() << std::endl;
+        }
+        try {
+            audioProxy = boost::shared_ptr<AL::ALProxy>(new AL::ALProxy(module.getParentBroker(), "ALAudioDevice"));
+        }
+        catch (const AL::ALError& e) {
+            qiLogError("ResponseToNameLogger") << "Error creating proxy to ALAudioDevice" << e.toString() << std::endl;
+        }
+    }
+
+    /**
+      * Warm-up step, prepares the log storage for the next session, given the parameters as they were when it was started
+      */
+    void prepareLog(const std::string &directory, unsigned long long size, LogStorage::Durability policy) {
+        if( !logWriter.prepare(directory, size, policy) ) {
+            qiLogError("ResponseToNameLogger") << "Error preparing log storage in " << directory << std::endl;
+        }
+    }
+
+    /**
+      * Maps the checkpoint file, the log writer stores the position of the log into it, an empty path uses no checkpoint
       */
-    void log(std::string eventIdentifier, int value) {
-        // Take current time and calculate duration from the start of the session
-        boost::system_time now = boost::get_system_time();
-        boost::posix_time::time_duration duration = now - sessionStart;
-        // Log the data into file
-        outputFileLock.lock();
-        outputFile << eventIdentifier << "\t" << value << "\t" << duration.total_milliseconds()/1000.0 << "\n";
-        outputFileLock.unlock();
+    void openCheckpoint(const std::string &path) {
+        logWriter.track(0);
+        checkpoint.close();
+        if( path.empty() ) {
+            return;
+        }
+        if( !checkpoint.open(path) ) {
+            qiLogWarning("ResponseToNameLogger") << "Session checkpoint " << path << " can not be used, sessions are not resumed" << std::endl;
+            return;
+        }
+        logWriter.track(&checkpoint.progress());
+    }
+
+    /**
+      * Writes the settings of the session into the checkpoint before the session is saved active
+      */
+    void beginCheckpoint() {
+        pendingCall = 0;
+        if( !checkpoint.isOpen() ) {
+            return;
+        }
+        SessionCheckpoint::Settings &settings = checkpoint.settings();
+        std::strncpy(settings.logDirectory, logDirectory.c_str(), SessionCheckpoint::PathLength - 1);
+        settings.logDirectory[SessionCheckpoint::PathLength - 1] = '\0';
+        std::strncpy(settings.protocolSource, protocolSource.c_str(), SessionCheckpoint::PathLength - 1);
+        settings.protocolSource[SessionCheckpoint::PathLength - 1] = '\0';
+        settings.format = logFormat;
+        settings.faceSampling = activeSamplingRate;
+        settings.dwell = static_cast<int>(responseThresholds.dwell);
+        settings.gapTolerance = static_cast<int>(responseThresholds.gapTolerance);
+        settings.window = static_cast<int>(responseThresholds.window);
+        settings.segmentSize = segmentSize;
+        settings.durability = durability;
+        settings.classifier = activeInternal ? 1 : 0;
+        std::memset(&checkpointed, 0, sizeof(checkpointed));
+        checkpointed.log = logWriter.storageSession();
+    }
+
+    /**
+      * Saves the published state of an active session into the checkpoint with plain stores only
+      * Called with the protocol lock held
+      */
+    void saveCheckpoint(const SessionState::Snapshot &snapshot) {
+        if( !checkpoint.isOpen() || !snapshot.active ) {
+            return;
+        }
+        checkpointed.start = snapshot.start;
+        checkpointed.active = 1;
+        checkpointed.ended = snapshot.ended;
+        checkpointed.iteration = snapshot.iteration;
+        checkpointed.faces = snapshot.faces;
+        checkpointed.lastFace = snapshot.lastFace;
+        checkpointed.lastCall = snapshot.lastCall;
+        checkpointed.pendingCall = pendingCall;
+        checkpoint.save(checkpointed);
+    }
+
+    /**
+      * Marks the session in the checkpoint as being stopped, or as over once its log is closed
+      */
+    void markCheckpoint(bool over) {
+        boost::mutex::scoped_lock lock(protocolLock);
+        if( !checkpoint.isOpen() ) {
+            return;
+        }
+        checkpointed.stopped = 1;
+        checkpointed.active = over ? 0 : 1;
+        checkpoint.save(checkpointed);
+    }
+
+    /**
+      * Milliseconds from the start of the session, the time used by the protocol
+      */
+    long long sessionTime(long long time) const {
+        return (time - state.read().start)/1000000;
+    }
+
+    /**
+      * Microseconds from the start of the session, the time of the log records
+      */
+    long long logTime(long long time) const {
+        return (time - state.read().start)/1000;
+    }
+
+    /**
+      * Publishes the state of the protocol with the deadline of the next decision, the last one if not given
+      * Called with the protocol lock held, which serializes every publish
+      */
+    void publishProtocol(long long deadline = -1) {
+        SessionState::Snapshot snapshot = state.read();
+        snapshot.iteration = protocol.iteration();
+        snapshot.faces = protocol.faceCount();
+        snapshot.lastFace = protocol.lastFaceTime();
+        snapshot.lastCall = protocol.lastCallTime();
+        snapshot.ended = protocol.ended();
+        if( deadline >= 0 ) {
+            snapshot.deadline = deadline;
+        }
+        state.publish(snapshot);
+        saveCheckpoint(snapshot);
+    }
+
+    /**
+      * Thread-safe logging function, queues the record without blocking on the file
+      * Record is timestamped with the given monotonic time, the current time by default
+      */
+    void log(LogEvent event, int value, long long time = monotonicTime()) {
+        LogRecord record;
+        record.event = event;
+        record.featureCount = 0;
+        record.value = value;
+        record.timestamp = logTime(time);
+        record.duration = 0;
+        logWriter.push(record);
+    }
+
+    /**
+      * Logs a whole interval of face presence as a single FD record
+      */
+    void logFaceInterval(const FacePresenceTracker::Interval &interval) {
+        LogRecord record;
+        record.event = LogFaceInterval;
+        record.featureCount = 0;
+        record.value = interval.frames;
+        record.timestamp = interval.start*1000;
+        record.duration = static_cast<int>(interval.end - interval.start);
+        logWriter.push(record);
+    }
+
+    /**
+      * Observer of the log writer, adds a written record to the metrics of the session and wakes the publisher
+      * unless it is already due to publish
+      */
+    void trackMetrics(const LogRecord &record) {
+        {
+            boost::mutex::scoped_lock lock(metricsLock);
+            metrics.add(record);
+        }
+        if( activeMetricsRate > 0 && __sync_bool_compare_and_swap(&metricsChanged, 0, 1) ) {
+            metricsPublisher.wake();
+        }
+    }
+
+    /**
+      * Task of the metrics publisher, publishes the metrics once at least a period passed since they were published last
+      */
+    long long publishMetrics() {
+        long long now = monotonicTime();
+        long long next = metricsPublished + 1000000000LL/std::max(1, activeMetricsRate);
+        if( now < next ) {
+            return next;
+        }
+        // Changes made from now on are published next time
+        __sync_bool_compare_and_swap(&metricsChanged, 1, 0);
+        insertMetrics(state.read());
+        metricsPublished = now;
+        return DeadlineScheduler::Never;
+    }
+
+    /**
+      * Inserts the metrics of the session into ALMemory with a single call, times in milliseconds
+      */
+    void insertMetrics(const SessionState::Snapshot &snapshot) {
+        SessionMetrics current;
+        {
+            boost::mutex::scoped_lock lock(metricsLock);
+            current = metrics.metrics();
+        }
+        AL::ALValue between, faces;
+        for( std::size_t i = 0; i < current.soundsBetweenCalls.size(); ++i ) {
+            between.arrayPush(current.soundsBetweenCalls[i]);
+        }
+        for( std::size_t i = 0; i < current.faceLatencies.size(); ++i ) {
+            faces.arrayPush(current.faceLatencies[i] < 0 ? -1.0f : static_cast<float>(current.faceLatencies[i]/1000.0));
+        }
+        double mean = current.meanFaceLatency();
+        long long response = current.responseFaceLatency();
+        AL::ALValue list;
+        pushMetric(list, "Session", snapshot.session);
+        pushMetric(list, "Active", snapshot.active ? 1 : 0);
+        pushMetric(list, "NameCalls", current.nameCalls);
+        pushMetric(list, "PhraseCalls", current.phraseCalls);
+        pushMetric(list, "Sounds", current.sounds);
+        pushMetric(list, "SoundsBetweenCalls", between);
+        pushMetric(list, "FaceLatencies", faces);
+        pushMetric(list, "MeanFaceLatency", mean < 0 ? -1.0f : static_cast<float>(mean/1000.0));
+        pushMetric(list, "ResponseFaceLatency", response < 0 ? -1.0f : static_cast<float>(response/1000.0));
+        pushMetric(list, "Outcome", current.outcome);
+        pushMetric(list, "CallsToResponse", current.callsToResponse);
+        try {
+            memoryProxy->insertListData(list);
+        }
+        catch (const AL::ALError& e) {
+            qiLogError("ResponseToNameLogger") << "Error publishing session metrics" << e.toString() << std::endl;
+        }
+    }
+
+    static void pushMetric(AL::ALValue &list, const std::string &name, const AL::ALValue &value) {
+        AL::ALValue pair;
+        pair.arrayPush("ResponseToName/" + name);
+        pair.arrayPush(value);
+        list.arrayPush(pair);
+    }
+
+    /**
+      * Handles a batch of sampled faces, called by the face sampler
+      */
+    void facesSampled(const std::vector<long long> &faces, long long now) {
+        boost::mutex::scoped_lock lock(protocolLock);
+        FacePresenceTracker::Interval interval;
+        for( std::size_t i = 0; i < faces.size(); ++i ) {
+            if( facePresence.addFace(sessionTime(faces[i]), interval) ) {
+                logFaceInterval(interval);
+            }
+            protocol.faceDetected(sessionTime(faces[i]));
+        }
+        if( facePresence.advance(sessionTime(now), interval) ) {
+            logFaceInterval(interval);
+        }
+        publishProtocol();
+        // Call deadline moved and the child may have responded, let the scheduler decide again
+        if( !faces.empty() ) {
+            scheduler.wake();
+        }
     }
 
     /**
       * Function used for logging the features extracted by sound classification
+      * Numeric features following the class are copied into the record, nested lists are flattened
       */
-    void logFeatures(AL::ALValue val) {
-        boost::system_time now = boost::get_system_time();
-        boost::posix_time::time_duration duration = now - sessionStart;
-        outputFileLock.lock();
-        outputFile << "SC" << "\t" << val << std::endl;
-        outputFileLock.unlock();
+    void logFeatures(const AL::ALValue &val, int soundClass) {
+        LogRecord record;
+        record.event = LogSoundFeatures;
+        record.featureCount = 0;
+        record.duration = 0;
+        record.value = soundClass;
+        record.timestamp = logTime(monotonicTime());
+        // Class is kept as it was reported, the text log writes it back as it came
+        std::string reported = val.getSize() > 0 && val[0].isString() ? (std::string)val[0] : std::string();
+        std::size_t length = std::min<std::size_t>(reported.size(), LogRecord::MaxNameLength - 1);
+        reported.copy(record.name, length);
+        record.name[length] = '\0';
+        for( unsigned int i = 1; i < val.getSize(); ++i ) {
+            pushFeature(record, val[i]);
+        }
+        logWriter.push(record);
     }
 
     /**
-      * Function called by the SessionStart callback
-      * Initializes output file, resets internal variables
+      * Logs a sound classified by the front end, its class and then its features, as the sound classification module reports them
       */
-    void startLogger() {
-        // Open output file with timestamp
-        boost::posix_time::ptime now = boost::posix_time::second_clock::local_time();
-        std::stringstream filename;
+    void logSound(const AudioFrontEnd::Sound &sound) {
+        log(LogSoundClassified, sound.soundClass, sound.time);
+        LogRecord record;
+        record.event = LogSoundFeatures;
+        record.featureCount = 0;
+        record.duration = 0;
+        record.value = sound.soundClass;
+        record.timestamp = logTime(sound.time);
+        std::strcpy(record.name, sound.soundClass == 1 ? "Artikulirano" : "Neartikulirano");
+        for( int i = 0; i < AudioFrontEnd::FeatureCount && record.featureCount < LogRecord::MaxFeatures; ++i ) {
+            record.features[record.featureCount++] = sound.features[i];
+        }
+        logWriter.push(record);
+    }
 
-        filename << "/home/nao/naoqi/modules/logs/" << now.date().year() << "_" << static_cast<int>(now.date().month())
-                 << "_" << now.date().day() << "_" <<  now.time_of_day().hours() << now.time_of_day().minutes() << "_ResponseToName.txt";
-        outputFileLock.lock();
-        outputFile.open(filename.str().c_str(), std::ios::out);
-        outputFileLock.unlock();
+    /**
+      * Appends a numeric value, or every numeric value of a list, to the features of the record
+      */
+    static void pushFeature(LogRecord &record, const AL::ALValue &val) {
+        if( val.isArray() ) {
+            for( unsigned int i = 0; i < val.getSize(); ++i ) {
+                pushFeature(record, val[i]);
+            }
+        }
+        else if( record.featureCount < LogRecord::MaxFeatures ) {
+            if( val.isFloat() ) {
+                record.features[record.featureCount++] = (float)val;
+            }
+            else if( val.isInt() ) {
+                record.features[record.featureCount++] = (int)val;
+            }
+        }
+    }
+
+    /**
+      * Session start step, starts the session log in the storage
+      * Session gets the next ID of the log directory, so no session overwrites another
+      */
+    void openLog() {
+        logWriter.configure(logDirectory, segmentSize, durability);
+        if( logWriter.open(logFormat, std::time(NULL), featureStore) ) {
+            qiLogInfo("ResponseToNameLogger") << "Logging session " << logWriter.session() << " to " << logDirectory << std::endl;
+        }
+        else {
+            qiLogError("ResponseToNameLogger") << "Error opening log storage in " << logDirectory << std::endl;
+        }
+    }
+
+    /**
+      * Session start step, reads the protocol of the session
+      * Protocol is chosen before the session starts, a file which can not be used leaves the study protocol
+      */
+    void loadProtocol(CallProtocol::Table &table) {
+        std::string error;
+        if( !CallProtocol::load(protocolSource, table, error) ) {
+            qiLogError("ResponseToNameLogger") << "Protocol " << protocolSource << " not used, " << error << std::endl;
+            table = builtinTable<StudyProtocol>();
+        }
+    }
+
+    /**
+      * Session start step, subscribes to external events for the whole session
+      * Events arriving before the session state is published are ignored by their handlers
+      */
+    void subscribeSession() {
+        if( activeSamplingRate <= 0 ) {
+            dispatcher->subscribe("FaceDetected");
+        }
+        dispatcher->subscribe("ChildCalledRTN");
+        dispatcher->subscribe("EndSessionRTN");
+        if( !activeInternal ) {
+            dispatcher->subscribe("SoundClassified");
+        }
+    }
 
-        // Calculate sessionStart time, reset internal variables
-        sessionStart = boost::get_system_time();
-        iteration = 0;
-        faceCount = 0;
-        ended = false;
-        childCount++;
-        // Session is starting, subscribe to external events and start sound classification
+    /**
+      * Starts sound classification at the start of the session and after every call, without waiting for it
+      */
+    void startClassification() {
+        classifierControl->start(activeInternal ? InternalClassifier : ExternalClassifier);
+    }
+
+    /**
+      * Stops sound classification before a call and at the end of the session, without waiting for it
+      */
+    void stopClassification() {
+        classifierControl->stop(activeInternal ? InternalClassifier : ExternalClassifier);
+    }
+
+    /**
+      * Carries out a command of the classifier control on its thread, returns false if the classifier did not take it
+      * Logger classifying sounds itself subscribes to ALAudioDevice, a sound heard before the call is forgotten
+      * Calls of a remote Logger are taken once they are sent
+      */
+    bool controlClassifier(int classifier, bool run) {
         try {
-            memoryProxy->subscribeToEvent("FaceDetected", "ResponseToNameLogger", "onFaceDetected");
-            memoryProxy->subscribeToEvent("ChildCalledRTN", "ResponseToNameLogger", "onChildCalled");
-            memoryProxy->subscribeToEvent("EndSessionRTN", "ResponseToNameLogger", "onStopLogger");
-            memoryProxy->subscribeToEvent("SoundClassified", "ResponseToNameLogger", "onSoundClassified");
-            classificationProxy->callVoid("pocni_klasifikaciju", parametri);
+            ScopedLatency latency(run ? *startClassificationLatency : *stopClassificationLatency);
+            if( classifier == InternalClassifier && run ) {
+                {
+                    boost::mutex::scoped_lock lock(audioLock);
+                    frontEnd->reset();
+                }
+                if( !audioPreferences ) {
+                    // Channel of the recording parameters at the rate of the front end, interleaved (0) if there are several
+                    audioProxy->callVoid("setClientPreferences", std::string("ResponseToNameLogger"),
+                                         frontEnd->parameters().sampleRate, (int)parametriSnimanje[1], 0);
+                    audioPreferences = true;
+                }
+                transport->call(audioProxy, "subscribe", std::string("ResponseToNameLogger"));
+            }
+            else if( classifier == InternalClassifier ) {
+                transport->call(audioProxy, "unsubscribe", std::string("ResponseToNameLogger"));
+            }
+            else if( run ) {
+                transport->call(classificationProxy, "pocni_klasifikaciju", parametri);
+            }
+            else {
+                transport->call(classificationProxy, "prekini_klasifikaciju");
+            }
+            if( transport->mode() == RemoteTransport::Batched ) {
+                transport->flush();
+            }
+            return true;
         }
         catch (const AL::ALError& e) {
-            qiLogError("ResponseToNameLogger") << "Error subscribing to events" << e.toString() << std::endl;
+            qiLogError("ResponseToNameLogger") << "Error " << (run ? "starting" : "stopping") << " sound classification" << e.toString() << std::endl;
+            return false;
+        }
+    }
+
+    /**
+      * Classifies the sounds in a buffer of the microphones, times are monotonic
+      */
+    void processAudio(const short *samples, int channels, int count, long long start) {
+        boost::mutex::scoped_lock lock(audioLock);
+        sounds.clear();
+        frontEnd->process(samples, channels, count, start, sounds);
+        for( std::size_t i = 0; i < sounds.size(); ++i ) {
+            logSound(sounds[i]);
+        }
+    }
+
+    /**
+      * Function called by the SessionStart callback with the time the session started
+      * Opening the log, reading the protocol, subscribing and starting sound classification do not depend
+      * on each other and run concurrently, the protocol and the scheduler are started once they are done
+      */
+    void startLogger(long long start) {
+        // Proxy and storage are warmed up after init, a session started right away waits for them
+        long long warmed = warmup.wait();
+        if( startupTime < 0 && warmed > 0 ) {
+            startupTime = warmed - created;
+            startupLatency->record(startupTime);
+        }
+
+        faceCpuTime = 0;
+        activeSamplingRate = faceSamplingRate;
+        activeInternal = internalClassifier;
+        activeMetricsRate = metricsRate;
+        startClassification();
+        CallProtocol::Table table;
+        {
+            ConcurrentSetup setup;
+            setup.run(boost::bind(&Impl::openLog, this), openLogLatency);
+            setup.run(boost::bind(&Impl::loadProtocol, this, boost::ref(table)), loadProtocolLatency);
+            setup.run(boost::bind(&Impl::subscribeSession, this), subscribeLatency);
+            setup.wait();
+        }
+        // Checkpoint knows where the log is before the session is saved
+        beginCheckpoint();
+
+        // Session time counts from the start of the session, handlers act on events from the publish on
+        {
+            boost::mutex::scoped_lock lock(protocolLock);
+            protocol = CallProtocol(table, responseThresholds);
+            protocol.start(0);
+            SessionState::Snapshot snapshot;
+            snapshot.start = start;
+            snapshot.session = state.read().session + 1;
+            snapshot.active = true;
+            {
+                boost::mutex::scoped_lock lock(metricsLock);
+                metrics = SessionMetricsTracker();
+            }
+            state.publish(snapshot);
+            publishProtocol();
+        }
+        if( activeSamplingRate > 0 ) {
+            // Face is considered gone once no frame was seen for three sampling periods
+            facePresence = FacePresenceTracker(std::max(500, 3000/activeSamplingRate));
+            faceSampler->start(activeSamplingRate, 250, boost::bind(&Impl::facesSampled, this, _1, _2));
         }
 
         // Start scheduler thread
-        t = new boost::thread(boost::ref(*module.impl));
+        scheduler.start(boost::bind(&Impl::schedule, this));
+        startMetrics();
+        long long started = monotonicTime() - start;
+        sessionStartLatency->record(started);
+        qiLogInfo("ResponseToNameLogger") << "Session started " << started/1e6 << " ms after StartSessionRTN, module warmed up "
+                                          << startupTime/1e6 << " ms after it was created" << std::endl;
     }
 
     /**
       * Function used to stop the logger, called by the callback reacting to "EndSession" event
       */
     void stopLogger() {
-        // close the output file
-        qiLogFatal("Logger") << "Zatvaram file\n";
-        outputFileLock.lock();
-        outputFile.close();
-        outputFileLock.unlock();
+        // Handlers entering from now on do nothing, the ones still running finish before the session is torn down
+        {
+            boost::mutex::scoped_lock lock(protocolLock);
+            SessionState::Snapshot snapshot = state.read();
+            snapshot.active = false;
+            state.publish(snapshot);
+        }
+        state.quiesce();
+        markCheckpoint(false);
 
-        // stop scheduler thread
-        t->interrupt();
-        t->join();
+        // Stop the scheduler thread, it stays alive for the next session
+        stopScheduler();
+        stopFaceIngestion();
+        // Metrics are complete once the writer thread took every record of the session
+        logWriter.waitDrained();
+        stopMetrics();
 
+        // Session events are no longer of interest, stop sound classification without waiting for it
+        dispatcher->unsubscribe("FaceDetected");
+        dispatcher->unsubscribe("ChildCalledRTN");
+        dispatcher->unsubscribe("EndSessionRTN");
+        dispatcher->unsubscribe("SoundClassified");
+        stopClassification();
 
-        // unsubscribe from FaceDetected event
-        try {
-            memoryProxy->unsubscribeToEvent("FaceDetected", "ResponseToNameLogger");
+        // Metrics of the whole session are summed up in a single record
+        {
+            boost::mutex::scoped_lock lock(metricsLock);
+            logWriter.push(metrics.metrics().toLogRecord(logTime(monotonicTime())));
         }
-        catch (const AL::ALError& e) {
-            qiLogError("ResponseToNameLogger") << "Error unsubscribing from FaceDeteced" << e.toString() << std::endl;
+
+        // Latencies measured so far are written at the end of the log
+        std::vector<LogRecord> summaries = latencies.toLogRecords(logTime(monotonicTime()));
+        for( std::size_t i = 0; i < summaries.size(); ++i ) {
+            logWriter.push(summaries[i]);
         }
+
+        // close the output file, every queued record is written first
+        qiLogFatal("Logger") << "Zatvaram file\n";
+        logWriter.close();
+        markCheckpoint(true);
+        qiLogInfo("ResponseToNameLogger") << "Face ingestion used " << faceCpuTime/1000000.0 << " ms of CPU, log size "
+                                          << logWriter.bytesWritten() << " bytes" << std::endl;
+        qiLogInfo("ResponseToNameLogger") << "Classifier commands sent " << classifierControl->sent() << ", merged "
+                                          << classifierControl->merged() << ", failed " << classifierControl->failed() << std::endl;
     }
 
     /**
-      * Operator () implements scheduler thread
+      * Resumes the session left in the checkpoint by a Logger which was gone before the session ended
+      * Session continues in the same log with the settings it started with, the calls are the ones in its log,
+      * a call the log says was made and did not end ends now, a session whose end was logged or which was being
+      * stopped only has its log ended
+      * Returns false if there is no such session or its log can not be continued
       */
-    void operator()() {
-        // In the start, initialize lastFace time
-        lastFace = boost::get_system_time();
+    bool resumeSession() {
+        if( !checkpoint.isOpen() || state.read().active || !checkpoint.live(MaxResumeAge) ) {
+            return false;
+        }
+        long long begun = monotonicTime();
+        warmup.wait();
+        SessionCheckpoint::Session saved = checkpoint.load();
+        const SessionCheckpoint::Settings &settings = checkpoint.settings();
+        logDirectory = settings.logDirectory;
+        protocolSource = settings.protocolSource;
+        logFormat = settings.format == AsyncLogWriter::Binary ? AsyncLogWriter::Binary : AsyncLogWriter::Text;
+        faceSamplingRate = activeSamplingRate = settings.faceSampling;
+        responseThresholds.dwell = settings.dwell;
+        responseThresholds.gapTolerance = settings.gapTolerance;
+        responseThresholds.window = settings.window;
+        segmentSize = settings.segmentSize;
+        durability = static_cast<LogStorage::Durability>(settings.durability);
+        internalClassifier = activeInternal = settings.classifier != 0;
 
-        // Start thread loop
-        while( true ) {
+        // Log is read as far as it was written, the checkpoint may be ahead of it
+        AsyncLogWriter::Progress::Position position = checkpoint.progress().load();
+        SessionLogLocation location;
+        location.file = logDirectory + LogStorage::segmentName(saved.log.segment);
+        location.offset = saved.log.offset;
+        location.length = static_cast<long long>(position.length);
+        std::vector<LogRecord> records;
+        logWriter.configure(logDirectory, segmentSize, durability);
+        if( !readSessionLog(location, records) || !logWriter.resume(logFormat, saved.log, position) ) {
+            qiLogError("ResponseToNameLogger") << "Session " << saved.log.id << " in " << logDirectory
+                                               << " can not be resumed, its log can not be continued" << std::endl;
+            boost::mutex::scoped_lock lock(protocolLock);
+            checkpointed = saved;
+            checkpointed.active = 0;
+            checkpoint.save(checkpointed);
+            return false;
+        }
+        SessionCheckpoint::Resumed resumed = SessionCheckpoint::reconcile(saved, records);
+        if( resumed.ended || saved.stopped ) {
+            logWriter.close();
+            {
+                boost::mutex::scoped_lock lock(protocolLock);
+                checkpointed = saved;
+                checkpointed.active = 0;
+                checkpoint.save(checkpointed);
+            }
+            qiLogInfo("ResponseToNameLogger") << "Session " << saved.log.id << " had ended, its log is ended" << std::endl;
+            // Interface may still be waiting for the end it was never told about
+            if( resumed.ended ) {
+                dispatcher->raise("EndSessionRTN", timedEventValue(resumed.endValue, monotonicTime()));
+            }
+            return false;
+        }
 
-            // Do until thread_interrupted is raised
-            try {
-                // Child responded after being called at least once (response = 5 consecutive face appearances)
-                if( iteration >= 1 && faceCount >=2 && !ended) {
-                    // Log SE - session ended event with value 1 - child responded
-                    log("SE", 1);
-                    ended = true;
-                    // Raise EndSession event
-                    memoryProxy->raiseEvent("EndSessionRTN", AL::ALValue(1));
+        CallProtocol::Table table;
+        loadProtocol(table);
+        faceCpuTime = 0;
+        {
+            boost::mutex::scoped_lock lock(protocolLock);
+            protocol = CallProtocol(table, responseThresholds);
+            protocol.resume(resumed.iterations, resumed.lastCall, resumed.lastFace);
+            for( std::size_t i = 0; i < resumed.faces.size(); ++i ) {
+                protocol.faceDetected(resumed.faces[i]);
+            }
+            checkpointed = saved;
+            checkpointed.log = logWriter.storageSession();
+            pendingCall = resumed.callPending ? saved.pendingCall : 0;
+            SessionState::Snapshot snapshot;
+            snapshot.start = saved.start;
+            snapshot.session = state.read().session + 1;
+            snapshot.active = true;
+            {
+                // Metrics go on from what the log recorded
+                boost::mutex::scoped_lock lock(metricsLock);
+                metrics = SessionMetricsTracker();
+                for( std::size_t i = 0; i < records.size(); ++i ) {
+                    metrics.add(records[i]);
                 }
+            }
+            state.publish(snapshot);
+            publishProtocol();
+        }
+        // Call was made before the Logger was gone and its end was missed, it is taken to end now
+        if( resumed.callPending ) {
+            long long now = monotonicTime();
+            int iteration;
+            {
+                boost::mutex::scoped_lock lock(protocolLock);
+                iteration = protocol.callEnded(sessionTime(now));
+                pendingCall = 0;
+                publishProtocol();
+            }
+            log(LogCallEnded, iteration, now);
+        }
 
-                // Calculate durations from lastFace and lastCall
-                boost::system_time now = boost::get_system_time();
-                boost::posix_time::time_duration timeDiff = now - lastFace;
-                long long sinceLastFace = timeDiff.total_milliseconds();
-                timeDiff = now - lastCall;
-                long long sinceLastCall = timeDiff.total_milliseconds();
-
-                // Check if five seconds have past from last call or last face appearance
-                if( sinceLastFace >= 5000 && sinceLastCall >= 5000 && !ended){
-                    // robot will call the child, stop sound classification
-                    classificationProxy->callVoid("prekini_klasifikaciju");
-                    // For first five iterations
-                    if( iteration < 5 ) {
-                        // Log that the call should have started - CS = call started
-                        log("CS", iteration+1);
-                        // Reset face counter
-                        faceCount = 0;
-                        // Raise event CallChild with value 1 meaning "Call by name"
-                        memoryProxy->raiseEvent("CallChildRTN", AL::ALValue(1));
-                        // Update the time of the last call
-                        lastCall = boost::get_system_time();
-                    }
-                    // Sixth and seventh iteration
-                    else if( iteration < 7 ) {
-                        // Log that the call using special phrase started - PS = phrase started
-                        log("PS", iteration-4);
-                        // Reset face counter
-                        faceCount = 0;
-                        // Raise CallChild event with value 2 meaning "Use special phrase"
-                        memoryProxy->raiseEvent("CallChildRTN", AL::ALValue(2));
-                        // Update the time of the last call
-                        lastCall = boost::get_system_time();
-                    }
-                    // Child did not respond at all, end session
-                    else {
-                        // Log "EndSession" event with value -1 meaning child did not respond
-                        log("SE", -1);
-                        ended = true;
-                        // Raise EndSession event with value -1
-                        memoryProxy->raiseEvent("EndSessionRTN", AL::ALValue(-1));
-                    }
-                }
-                boost::this_thread::sleep(boost::posix_time::milliseconds(100));
+        int calls = state.read().iteration;
+
+        subscribeSession();
+        startClassification();
+        if( activeSamplingRate > 0 ) {
+            facePresence = FacePresenceTracker(std::max(500, 3000/activeSamplingRate));
+            faceSampler->start(activeSamplingRate, 250, boost::bind(&Impl::facesSampled, this, _1, _2));
+        }
+        scheduler.start(boost::bind(&Impl::schedule, this));
+        activeMetricsRate = metricsRate;
+        startMetrics();
+        // Interface started again as well learns the session goes on, with the time it started
+        dispatcher->raise("SessionResumedRTN", timedEventValue(calls, saved.start));
+        long long resumedIn = monotonicTime() - begun;
+        resumeLatency->record(resumedIn);
+        qiLogInfo("ResponseToNameLogger") << "Session " << saved.log.id << " resumed in " << resumedIn/1e6 << " ms after "
+                                          << calls << " calls, " << records.size() << " records logged" << std::endl;
+        return true;
+    }
+
+    /**
+      * Stops the face sampler and logs the interval of presence still open
+      */
+    void stopFaceIngestion() {
+        if( activeSamplingRate <= 0 ) {
+            return;
+        }
+        faceSampler->stop();
+        boost::mutex::scoped_lock lock(protocolLock);
+        FacePresenceTracker::Interval interval;
+        if( facePresence.flush(interval) ) {
+            logFaceInterval(interval);
+        }
+        faceCpuTime = faceSampler->cpuTime();
+        qiLogInfo("ResponseToNameLogger") << "Sampled FaceDetected " << faceSampler->samples() << " times, "
+                                          << faceSampler->frames() << " new frames" << std::endl;
+    }
+
+    /**
+      * Starts publishing the metrics of the session, the publisher publishes them at once
+      */
+    void startMetrics() {
+        if( activeMetricsRate <= 0 ) {
+            return;
+        }
+        metricsPublished = 0;
+        metricsPublisher.start(boost::bind(&Impl::publishMetrics, this));
+    }
+
+    /**
+      * Stops the publisher and publishes the metrics of the ended session, whatever was published last
+      */
+    void stopMetrics() {
+        if( activeMetricsRate <= 0 ) {
+            return;
+        }
+        metricsPublisher.stop();
+        insertMetrics(state.read());
+    }
+
+    /**
+      * Stops the scheduler thread and reports how often it woke up during the session
+      */
+    void stopScheduler() {
+        scheduler.stop();
+        qiLogInfo("ResponseToNameLogger") << "Scheduler woke " << scheduler.wakeups() << " times in "
+                                          << (monotonicTime() - state.read().start)/1e9 << " s" << std::endl;
+    }
+
+    /**
+      * Implements one step of the scheduler thread
+      * Lets the protocol decide whether the session ended or the child should be called,
+      * carries out the decision and returns the time of the next one
+      * Raised events carry the time of the decision, the same time the decision is logged with
+      */
+    long long schedule() {
+        long long now = monotonicTime();
+        CallProtocol::Decision decision;
+        ResponseDetector response;
+        {
+            boost::mutex::scoped_lock lock(protocolLock);
+            decision = protocol.step(sessionTime(now));
+            response = protocol.response();
+            if( decision.action == CallProtocol::CallByName ) pendingCall = 1;
+            else if( decision.action == CallProtocol::CallWithPhrase ) pendingCall = 2;
+            publishProtocol(decision.deadline);
+        }
+
+        try {
+            if( decision.action == CallProtocol::CallByName || decision.action == CallProtocol::CallWithPhrase ) {
+                qiLogVerbose("ResponseToNameLogger") << "Call decided " << (now - callDeadline)/1000
+                                                     << " us after its deadline" << std::endl;
+                // robot will call the child, stop sound classification
+                stopClassification();
             }
-            // Catch thread_interrupted
-            catch(boost::thread_interrupted&) {
-                // Exit
-                return;
+            if( decision.action == CallProtocol::CallByName ) {
+                // Log that the call should have started - CS = call started
+                log(LogCallStarted, decision.value, now);
+                // Raise event CallChild with value 1 meaning "Call by name"
+                ScopedLatency latency(*raiseEventLatency);
+                dispatcher->raise("CallChildRTN", timedEventValue(1, now));
+            }
+            else if( decision.action == CallProtocol::CallWithPhrase ) {
+                // Log that the call using special phrase started - PS = phrase started
+                log(LogPhraseStarted, decision.value, now);
+                // Raise CallChild event with value 2 meaning "Use special phrase"
+                ScopedLatency latency(*raiseEventLatency);
+                dispatcher->raise("CallChildRTN", timedEventValue(2, now));
+            }
+            else if( decision.action == CallProtocol::EndSession ) {
+                if( decision.value == 1 ) {
+                    qiLogInfo("ResponseToNameLogger") << "Child responded " << response.responseLatency()
+                                                      << " ms after the call, first face after " << response.firstFaceLatency()
+                                                      << " ms, face stayed " << response.dwell() << " ms" << std::endl;
+                }
+                // Log SE - session ended event, 1 if child responded, -1 if child did not respond
+                log(LogSessionEnded, decision.value, now);
+                // Raise EndSession event
+                ScopedLatency latency(*raiseEventLatency);
+                dispatcher->raise("EndSessionRTN", timedEventValue(decision.value, now));
             }
         }
+        catch (const AL::ALError& e) {
+            qiLogError("ResponseToNameLogger") << "Error in scheduler" << e.toString() << std::endl;
+        }
+
+        // Nothing more to decide, sleep until the next session
+        if( decision.deadline == CallProtocol::Never ) {
+            return DeadlineScheduler::Never;
+        }
+        callDeadline = state.read().start + decision.deadline*1000000LL;
+        return callDeadline;
     }
 };
 
@@ -283,6 +1164,27 @@ ResponseToNameLogger::ResponseToNameLogger(boost::shared_ptr<AL::ALBroker> pBrok
 
     functionName("onSoundClassified", getName(), "Callback for ChildCalled event");
     BIND_METHOD(ResponseToNameLogger::onSoundClassified);
+
+    functionName("processRemote", getName(), "Receives a buffer of the microphones from ALAudioDevice");
+    addParam("nbOfChannels", "Number of channels in the buffer");
+    addParam("nbOfSamplesByChannel", "Number of samples of each channel");
+    addParam("timeStamp", "Time of the buffer as given by ALAudioDevice");
+    addParam("buffer", "Samples of the buffer, 16 bits each");
+    BIND_METHOD(ResponseToNameLogger::processRemote);
+
+    functionName("setParameter", getName(), "Sets a Logger parameter, applied from the next session on");
+    addParam("name", "Name of the parameter: logFormat, faceSampling, logDirectory, featureStore, segmentSize, durability, protocol, responseDwell, responseGap, responseWindow, checkpoint, classifier or metricsRate");
+    addParam("value", "New value of the parameter, logFormat is either text or binary, faceSampling is the sampling rate in Hz or 0 to handle every FaceDetected event, logDirectory is the folder of the session logs, featureStore is false to write sound features to the log only, segmentSize is the size of log segments in MB, durability is none, periodic or session, protocol is study or the path of a protocol file, responseDwell, responseGap and responseWindow are the response thresholds in ms, checkpoint is the path of the session checkpoint, a session left there is resumed, classifier is external to use the sound classification module or internal to classify sounds in the Logger, metricsRate is the highest rate in Hz the session metrics are published to ALMemory at or 0 to publish none");
+    BIND_METHOD(ResponseToNameLogger::setParameter);
+
+    functionName("getLatencyHistograms", getName(), "Returns the latency histograms of every callback and proxy call");
+    addParam("reset", "True to clear the histograms once they are read");
+    setReturn("histograms", "[name, count, sum, max, [[limit, count], ...]] for each histogram, times in microseconds");
+    BIND_METHOD(ResponseToNameLogger::getLatencyHistograms);
+
+    functionName("getSessionState", getName(), "Returns the state of the session, read without waiting for the module");
+    setReturn("state", "[session, active, calls, faces since the last call, last face ms, last call end ms, ended]");
+    BIND_METHOD(ResponseToNameLogger::getSessionState);
 }
 
 ResponseToNameLogger::~ResponseToNameLogger() {
@@ -296,6 +1198,8 @@ void ResponseToNameLogger::init() {
         impl = boost::shared_ptr<Impl>(new Impl(*this));
         // Initialize ALModule
         AL::ALModule::init();
+        // Session left by a Logger which was restarted goes on
+        resumeSession();
     }
     catch (const AL::ALError& e) {
         qiLogError("ResponseToNameLogger") << e.what() << std::endl;
@@ -303,102 +1207,235 @@ void ResponseToNameLogger::init() {
     qiLogVerbose("ResponseToNameLogger") << "ResponseToName Logger initialized" << std::endl;
 }
 
-void ResponseToNameLogger::onFaceDetected() {
-    // Code is thread safe as long as ALCriticalSection object exists
+void ResponseToNameLogger::onFaceDetected(const std::string &key, const AL::ALValue &value, const AL::ALValue &msg) {
+    long long start = threadCpuTime();
+    impl->dispatcher->dispatch("FaceDetected", value);
+    __sync_fetch_and_add(&impl->faceCpuTime, threadCpuTime() - start);
+}
+
+void ResponseToNameLogger::onStartLogger(const std::string &key, const AL::ALValue &value, const AL::ALValue &msg) {
+    impl->dispatcher->dispatch("StartSessionRTN", value);
+}
+
+void ResponseToNameLogger::onStopLogger(const std::string &key, const AL::ALValue &value, const AL::ALValue &msg) {
+    impl->dispatcher->dispatch("EndSessionRTN", value);
+}
+
+void ResponseToNameLogger::onChildCalled(const std::string &key, const AL::ALValue &value, const AL::ALValue &msg) {
+    impl->dispatcher->dispatch("ChildCalledRTN", value);
+}
+
+void ResponseToNameLogger::onSoundClassified(const std::string &key, const AL::ALValue &value, const AL::ALValue &msg) {
+    impl->dispatcher->dispatch("SoundClassified", value);
+}
+
+void ResponseToNameLogger::resumeSession() {
     AL::ALCriticalSection section(impl->fCallbackMutex);
-    // Obtain FaceDetected data to check validity of the face
-    // Must be called before the unsubscribeToEvent method
-    AL::ALValue face = impl->memoryProxy->getData("FaceDetected");
-    // Unsubscribe to prevent repetitive callbackss
-    impl->memoryProxy->unsubscribeToEvent("FaceDetected", "ResponseToNameLogger");
-    // Update the lastFace time
-    impl->lastFace = boost::get_system_time();
-
-    // Check validity of the face
+    impl->resumeSession();
+}
+
+void ResponseToNameLogger::faceDetected(const AL::ALValue &face) {
+    // Faces only count while a session is active, which does not end before the handler returns
+    SessionState::Handler handler(impl->state);
+    if( !handler.active() ) {
+        return;
+    }
+    long long now = monotonicTime();
+
+    // Check validity of the face, FaceDetected data comes with the event
     if( face.getSize() < 2 ) {
         qiLogError("ResponseToNameLogger") << "Face detected but data is invalid, size " << face.getSize() << std::endl;
+        return;
     }
-    else {
-        // Log the appearance of the face
-        impl->log("FD", ++impl->faceCount);
+    // Update the lastFace time and the number of faces
+    int faceCount;
+    {
+        boost::mutex::scoped_lock lock(impl->protocolLock);
+        faceCount = impl->protocol.faceDetected(impl->sessionTime(now));
+        impl->publishProtocol();
     }
-    // Subscribe to FaceDetected
-    impl->memoryProxy->subscribeToEvent("FaceDetected", "ResponseToNameLogger", "onFaceDetected");
+    // Log the appearance of the face
+    impl->log(LogFaceDetected, faceCount, now);
+    // Call deadline moved and the child may have responded, let the scheduler decide again
+    impl->scheduler.wake();
 }
 
-void ResponseToNameLogger::onStartLogger() {
+void ResponseToNameLogger::startLogger(const AL::ALValue &value) {
     // Thread safety of the callback
     AL::ALCriticalSection section(impl->fCallbackMutex);
-    // Unsubscribe from event, maybe this can be omitted
-    impl->memoryProxy->unsubscribeToEvent("StartSessionRTN", "ResponseToNameLogger");
+    // Session already in progress
+    if( impl->state.read().active ) {
+        return;
+    }
 
     // Session is starting, initialize logger module and start scheduler thread
-    impl->startLogger();
-
-    // During the session this module must react to ChildCalled event
-    impl->memoryProxy->subscribeToEvent("ChildCalledRTN", "ResponseToNameLogger", "onChildCalled");
+    // Session counts from when the Interface started it, not from when the event was delivered
+    impl->startLogger(eventTime(value, monotonicTime()));
 }
 
-void ResponseToNameLogger::onStopLogger(const std::string &key, const AL::ALValue &value, const AL::ALValue &msg) {
+void ResponseToNameLogger::stopLogger(const AL::ALValue &value) {
     // Thread safety of the callback
     AL::ALCriticalSection section(impl->fCallbackMutex);
-    // Unsubscriptions
-    impl->memoryProxy->unsubscribeToEvent("EndSessionRTN", "ResponseToNameLogger");
-    // Interupt the execution of the scheduler thread
-    impl->t->interrupt();
-    // Wait for thread to exit
-    impl->t->join();
-
-    // Event subscription management, stop sound classification
-    try {
-        impl->memoryProxy->unsubscribeToEvent("FaceDetected", "ResponseToNameLogger");
-        impl->memoryProxy->unsubscribeToEvent("ChildCalledRTN", "ResponseToNameLogger");
-        impl->memoryProxy->subscribeToEvent("StartSessionRTN", "ResponseToNameLogger", "onStartLogger");
-        impl->classificationProxy->callVoid("prekini_klasifikaciju");
-        impl->memoryProxy->unsubscribeToEvent("SoundClassified", "ResponseToNameLogger");
+    if( !impl->state.read().active ) {
+        return;
     }
-    catch (const AL::ALError& e) {
-        qiLogError("ResponseToNameLogger") << "Error managing events" << e.toString() << std::endl;
+    impl->stopLogger();
+}
+
+void ResponseToNameLogger::childCalled(const AL::ALValue &value) {
+    // Call ends only count while a session is active, classification is not restarted once it ended
+    SessionState::Handler handler(impl->state);
+    if( !handler.active() ) {
+        return;
     }
+    // Call ended when the Interface module says, not when the event was delivered
+    long long ended = eventTime(value, monotonicTime());
+    // Update the time of the last call, increase iteration number, reset number of faces
+    int iteration;
+    {
+        boost::mutex::scoped_lock lock(impl->protocolLock);
+        iteration = impl->protocol.callEnded(impl->sessionTime(ended));
+        impl->pendingCall = 0;
+        impl->publishProtocol();
+    }
+    // Log that the Interface module has ended the call
+    impl->log(LogCallEnded, iteration, ended);
+    // Next call is now due five seconds from the end of this one
+    impl->scheduler.wake();
+    // Robot has finished making sounds, restart sound classification
+    impl->startClassification();
+}
 
-    // Close the output file
-    qiLogFatal("Logger") << "Zatvaram file\n";
-    impl->outputFileLock.lock();
-    impl->outputFile.close();
-    impl->outputFileLock.unlock();
+void ResponseToNameLogger::soundClassified(const AL::ALValue &value) {
+    // Sounds only count while a session is active
+    SessionState::Handler handler(impl->state);
+    if( !handler.active() ) {
+        return;
+    }
+    // Log that the sound classification module has detected sounds
+    std::string klasa = (std::string)value[0];
+    int soundClass = -1;
+    if(klasa=="Neartikulirano") soundClass = 0;
+    else if( klasa=="Artikulirano") soundClass = 1;
+    if( soundClass >= 0 ) impl->log(LogSoundClassified, soundClass);
+    impl->logFeatures(value, soundClass);
+}
 
+void ResponseToNameLogger::processRemote(const int &nbOfChannels, const int &nbOfSamplesByChannel, const AL::ALValue &timeStamp, const AL::ALValue &buffer) {
+    long long received = monotonicTime();
+    // Sounds only count while a session is active and the Logger classifies them
+    SessionState::Handler handler(impl->state);
+    if( !handler.active() || !impl->activeInternal ) {
+        return;
+    }
+    ScopedLatency latency(*impl->processRemoteLatency);
+    if( !buffer.isBinary() || nbOfChannels < 1 || nbOfSamplesByChannel < 0
+        || buffer.getSize() < sizeof(short)*nbOfChannels*nbOfSamplesByChannel ) {
+        qiLogError("ResponseToNameLogger") << "Audio buffer is invalid, size " << buffer.getSize() << std::endl;
+        return;
+    }
+    // Buffer is delivered once its last sample is recorded, channels are interleaved and the front end analyses the first
+    long long start = received - nbOfSamplesByChannel*1000000000LL/impl->frontEnd->parameters().sampleRate;
+    impl->processAudio(static_cast<const short *>(buffer.GetBinary()), nbOfChannels, nbOfSamplesByChannel, start);
 }
 
-void ResponseToNameLogger::onChildCalled(const std::string &key, const AL::ALValue &value, const AL::ALValue &msg) {
+void ResponseToNameLogger::setParameter(const std::string &name, const AL::ALValue &value) {
     // Thread safety of the callback
     AL::ALCriticalSection section(impl->fCallbackMutex);
-    // Unsubscription
-    impl->memoryProxy->unsubscribeToEvent("ChildCalledRTN", "ResponseToNameLogger");
-    // Update the time of the last call
-    impl->lastCall = boost::get_system_time();
-    // Increase iteration number, reset number of faces
-    impl->iteration++;
-    impl->faceCount = 0;
-    // Log that the Interface module has ended the call
-    impl->log("CE", (int)impl->iteration);
-    // Robot has finished making sounds, restart the sound classification module
-    impl->classificationProxy->callVoid("pocni_klasifikaciju", impl->parametri);
-    // Subscribe back to the same event
-    impl->memoryProxy->subscribeToEvent("ChildCalledRTN", "ResponseToNameLogger", "onChildCalled");
+    try {
+        if( name == "logFormat" ) {
+            std::string format = (std::string)value;
+            if( format == "text" ) impl->logFormat = AsyncLogWriter::Text;
+            else if( format == "binary" ) impl->logFormat = AsyncLogWriter::Binary;
+            else qiLogError("ResponseToNameLogger") << "Unknown log format " << format << std::endl;
+        }
+        else if( name == "faceSampling" ) {
+            int rate = (int)value;
+            if( rate >= 0 && rate <= 100 ) impl->faceSamplingRate = rate;
+            else qiLogError("ResponseToNameLogger") << "Face sampling rate out of range " << rate << std::endl;
+        }
+        else if( name == "logDirectory" ) {
+            std::string directory = (std::string)value;
+            if( !directory.empty() && directory[directory.size() - 1] != '/' ) directory += '/';
+            impl->logDirectory = directory;
+            impl->warmup.run(boost::bind(&Impl::prepareLog, impl.get(), directory, impl->segmentSize, impl->durability),
+                             impl->prepareLogLatency);
+        }
+        else if( name == "featureStore" ) {
+            impl->featureStore = (bool)value;
+        }
+        else if( name == "segmentSize" ) {
+            int megabytes = (int)value;
+            if( megabytes >= 1 && megabytes <= 1024 ) impl->segmentSize = static_cast<unsigned long long>(megabytes)*1024*1024;
+            else qiLogError("ResponseToNameLogger") << "Segment size out of range " << megabytes << std::endl;
+        }
+        else if( name == "durability" ) {
+            std::string policy = (std::string)value;
+            if( policy == "none" ) impl->durability = LogStorage::NoSync;
+            else if( policy == "periodic" ) impl->durability = LogStorage::PeriodicSync;
+            else if( policy == "session" ) impl->durability = LogStorage::SessionSync;
+            else qiLogError("ResponseToNameLogger") << "Unknown durability " << policy << std::endl;
+        }
+        else if( name == "protocol" ) {
+            // Checked now so a mistake shows before the session, the file is read again when the session starts
+            std::string source = (std::string)value;
+            CallProtocol::Table table;
+            std::string error;
+            if( CallProtocol::load(source, table, error) ) impl->protocolSource = source;
+            else qiLogError("ResponseToNameLogger") << "Protocol " << source << " not used, " << error << std::endl;
+        }
+        else if( name == "responseDwell" || name == "responseGap" || name == "responseWindow" ) {
+            int milliseconds = (int)value;
+            if( milliseconds < 0 || milliseconds > 60000 ) {
+                qiLogError("ResponseToNameLogger") << "Response threshold out of range " << milliseconds << std::endl;
+            }
+            else if( name == "responseDwell" ) impl->responseThresholds.dwell = milliseconds;
+            else if( name == "responseGap" ) impl->responseThresholds.gapTolerance = milliseconds;
+            else impl->responseThresholds.window = milliseconds;
+        }
+        else if( name == "checkpoint" ) {
+            // Checkpoint of the session in progress stays until it ends
+            if( impl->state.read().active ) {
+                qiLogError("ResponseToNameLogger") << "Checkpoint can not be changed during a session" << std::endl;
+            }
+            else {
+                impl->openCheckpoint((std::string)value);
+                impl->resumeSession();
+            }
+        }
+        else if( name == "classifier" ) {
+            std::string classifier = (std::string)value;
+            if( classifier == "external" ) impl->internalClassifier = false;
+            else if( classifier == "internal" ) impl->internalClassifier = true;
+            else qiLogError("ResponseToNameLogger") << "Unknown classifier " << classifier << std::endl;
+        }
+        else if( name == "metricsRate" ) {
+            int rate = (int)value;
+            if( rate >= 0 && rate <= 50 ) impl->metricsRate = rate;
+            else qiLogError("ResponseToNameLogger") << "Metrics rate out of range " << rate << std::endl;
+        }
+        else {
+            qiLogError("ResponseToNameLogger") << "Unknown parameter " << name << std::endl;
+        }
+    }
+    catch (const AL::ALError& e) {
+        qiLogError("ResponseToNameLogger") << "Invalid value for parameter " << name << e.toString() << std::endl;
+    }
 }
 
-void ResponseToNameLogger::onSoundClassified(const std::string &key, const AL::ALValue &value, const AL::ALValue &msg) {
-    // Thread safety of the callback
-    AL::ALCriticalSection section(impl->fCallbackMutex);
-    // Unsubscription
-    impl->memoryProxy->unsubscribeToEvent("SoundClassified", "ResponseToNameLogger");
-    qiLogWarning("Logger") << "Sound detected, reading value" << std::endl;
-    // Log that the sound classification module has detected sounds
-    std::string klasa = (std::string)value[0];
-    qiLogWarning("Logger") << "Klasa = " << klasa << std::endl;
-    if(klasa=="Neartikulirano") impl->log("SC", 0);
-    else if( klasa=="Artikulirano") impl->log("SC", 1);
-    impl->logFeatures(value);
-    // Subscribe back to the same event
-    impl->memoryProxy->subscribeToEvent("SoundClassified", "ResponseToNameLogger", "onSoundClassified");
+AL::ALValue ResponseToNameLogger::getLatencyHistograms(const bool &reset) {
+    return impl->latencies.toALValue(reset);
+}
+
+AL::ALValue ResponseToNameLogger::getSessionState() {
+    SessionState::Snapshot snapshot = impl->state.read();
+    AL::ALValue state;
+    state.arrayPush(snapshot.session);
+    state.arrayPush(snapshot.active);
+    state.arrayPush(snapshot.iteration);
+    state.arrayPush(snapshot.faces);
+    state.arrayPush(static_cast<int>(snapshot.lastFace));
+    state.arrayPush(static_cast<int>(snapshot.lastCall));
+    state.arrayPush(snapshot.ended);
+    return state;
 }
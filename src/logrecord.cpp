@@ -0,0 +1,101 @@
+#include "logrecord.hpp"
+#include <cstdio>
+
+namespace
+{
+  const char *eventNames[LogEventCount] = { "FD", "CS", "PS", "CE", "SE", "SC", "SC", "FD", "LT", "SM" };
+
+  /**
+    * Sound classes reported by the sound classification module, indexed by the SC value
+    * Used for feature records of logs written before the class was kept with them
+    */
+  const char *soundClassName(int value) {
+      if( value == 0 ) return "Neartikulirano";
+      if( value == 1 ) return "Artikulirano";
+      return "Nepoznato";
+  }
+
+  /**
+    * snprintf returns the length it wanted to write, clamp it to what was actually written
+    */
+  std::size_t clamp(int written, std::size_t size) {
+      if( written < 0 ) return 0;
+      if( static_cast<std::size_t>(written) >= size ) return size - 1;
+      return static_cast<std::size_t>(written);
+  }
+}
+
+const char *logEventName(LogEvent event) {
+    if( event < 0 || event >= LogEventCount ) {
+        return "??";
+    }
+    return eventNames[event];
+}
+
+std::size_t formatLogRecord(const LogRecord &record, char *buffer, std::size_t size) {
+    if( size == 0 ) {
+        return 0;
+    }
+    const char *name = logEventName(static_cast<LogEvent>(record.event));
+
+    // Interval lines carry the length of the interval after its start
+    if( record.event == LogFaceInterval ) {
+        return clamp(std::snprintf(buffer, size, "%s\t%d\t%.6f\t%g\n", name, record.value, record.timestamp/1000000.0, record.duration/1000.0), size);
+    }
+
+    // Latency lines, count followed by the summary of the histogram in microseconds
+    if( record.event == LogLatency ) {
+        return clamp(std::snprintf(buffer, size, "%s\t%.*s\t%d\t%g\t%g\t%g\t%g\t%g\n", name,
+                                   static_cast<int>(LogRecord::MaxNameLength), record.name, record.value,
+                                   record.features[0], record.features[1], record.features[2], record.features[3],
+                                   record.features[4]), size);
+    }
+
+    // Summary lines, outcome and time followed by the metrics
+    if( record.event == LogSummary ) {
+        std::size_t length = clamp(std::snprintf(buffer, size, "%s\t%d\t%.6f", name, record.value, record.timestamp/1000000.0), size);
+        for( unsigned int i = 0; i < record.featureCount && i < LogRecord::MaxFeatures; ++i ) {
+            length += clamp(std::snprintf(buffer + length, size - length, "\t%g", record.features[i]), size - length);
+        }
+        length += clamp(std::snprintf(buffer + length, size - length, "\n"), size - length);
+        return length;
+    }
+
+    // Event lines, time is written in seconds down to the microsecond
+    if( record.event != LogSoundFeatures ) {
+        return clamp(std::snprintf(buffer, size, "%s\t%d\t%.6f\n", name, record.value, record.timestamp/1000000.0), size);
+    }
+
+    // Feature lines, written as a list starting with the class of the sound
+    const char *soundClass = record.name[0] ? record.name : soundClassName(record.value);
+    std::size_t length = clamp(std::snprintf(buffer, size, "%s\t[%.*s", name,
+                                             static_cast<int>(LogRecord::MaxNameLength), soundClass), size);
+    for( unsigned int i = 0; i < record.featureCount && i < LogRecord::MaxFeatures; ++i ) {
+        length += clamp(std::snprintf(buffer + length, size - length, ", %g", record.features[i]), size - length);
+    }
+    length += clamp(std::snprintf(buffer + length, size - length, "]\n"), size - length);
+    return length;
+}
+
+std::size_t formatLegacyLogRecord(const LogRecord &record, char *buffer, std::size_t size) {
+    if( size == 0 || record.event == LogLatency || record.event == LogSummary ) {
+        return 0;
+    }
+    const char *name = logEventName(static_cast<LogEvent>(record.event));
+
+    // Event lines, streams printed the milliseconds divided by 1000.0 with six significant digits
+    if( record.event != LogSoundFeatures ) {
+        long long milliseconds = record.timestamp/1000;
+        return clamp(std::snprintf(buffer, size, "%s\t%d\t%g\n", name, record.value, milliseconds/1000.0), size);
+    }
+
+    // Feature lines, the list as ALValue prints it, the class quoted
+    const char *soundClass = record.name[0] ? record.name : soundClassName(record.value);
+    std::size_t length = clamp(std::snprintf(buffer, size, "%s\t[\"%.*s\"", name,
+                                             static_cast<int>(LogRecord::MaxNameLength), soundClass), size);
+    for( unsigned int i = 0; i < record.featureCount && i < LogRecord::MaxFeatures; ++i ) {
+        length += clamp(std::snprintf(buffer + length, size - length, ", %g", record.features[i]), size - length);
+    }
+    length += clamp(std::snprintf(buffer + length, size - length, "]\n"), size - length);
+    return length;
+}
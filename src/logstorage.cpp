@@ -0,0 +1,294 @@
+#include "logstorage.hpp"
+#include "monotonictime.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+const char *LogStorage::IndexName = "sessions.idx";
+
+LogStorage::LogStorage() :
+    directory("/home/nao/naoqi/modules/logs/"), segmentSize(DefaultSegmentSize), durability(SessionSync),
+    syncInterval(5000000000LL), segmentFd(-1), segment(0), segmentEnd(0), indexFd(-1),
+    nextId(1), recovered(false), active(false), lastSync(0), syncCount(0) {
+    std::memset(&current, 0, sizeof(current));
+}
+
+LogStorage::~LogStorage() {
+    end();
+    closeSegment();
+    if( indexFd >= 0 ) {
+        ::close(indexFd);
+    }
+}
+
+void LogStorage::configure(const std::string &newDirectory, unsigned long long newSegmentSize,
+                           Durability newDurability, unsigned int newSyncInterval) {
+    std::string folder = newDirectory;
+    if( !folder.empty() && folder[folder.size() - 1] != '/' ) {
+        folder += '/';
+    }
+    // Another directory has its own index and segments
+    if( folder != directory ) {
+        closeSegment();
+        if( indexFd >= 0 ) {
+            ::close(indexFd);
+            indexFd = -1;
+        }
+        recovered = false;
+        directory = folder;
+    }
+    segmentSize = newSegmentSize;
+    durability = newDurability;
+    syncInterval = newSyncInterval*1000000LL;
+}
+
+std::string LogStorage::sessionName(unsigned long id) {
+    char name[32];
+    std::sprintf(name, "session_%06lu", id);
+    return name;
+}
+
+std::string LogStorage::segmentName(unsigned long number) {
+    char name[32];
+    std::sprintf(name, "segment_%06lu.rtns", number);
+    return name;
+}
+
+std::string LogStorage::path(const std::string &name) const {
+    return directory + name;
+}
+
+const LogStorage::Session &LogStorage::session() const {
+    return current;
+}
+
+unsigned long LogStorage::syncs() const {
+    return syncCount;
+}
+
+bool LogStorage::readIndex(const std::string &folder, std::vector<Session> &sessions) {
+    std::FILE *index = std::fopen((folder + "/" + IndexName).c_str(), "r");
+    if( !index ) {
+        return false;
+    }
+    // Later lines of a session replace the earlier ones
+    std::map<unsigned long, Session> entries;
+    char line[256];
+    while( std::fgets(line, sizeof(line), index) ) {
+        Session entry;
+        char length[32];
+        if( std::sscanf(line, "%lu\t%lld\t%lu\t%llu\t%31s", &entry.id, &entry.start, &entry.segment, &entry.offset, length) != 5 ) {
+            continue;
+        }
+        entry.complete = length[0] != '-';
+        entry.length = entry.complete ? std::strtoull(length, 0, 10) : 0;
+        entries[entry.id] = entry;
+    }
+    std::fclose(index);
+    sessions.clear();
+    for( std::map<unsigned long, Session>::const_iterator it = entries.begin(); it != entries.end(); ++it ) {
+        sessions.push_back(it->second);
+    }
+    return true;
+}
+
+void LogStorage::recover() {
+    std::vector<Session> sessions;
+    nextId = 1;
+    segment = 0;
+    segmentEnd = 0;
+    if( readIndex(directory, sessions) && !sessions.empty() ) {
+        const Session &last = sessions.back();
+        nextId = last.id + 1;
+        for( std::size_t i = 0; i < sessions.size(); ++i ) {
+            segment = std::max(segment, sessions[i].segment);
+        }
+        // Continue after the last session, unless it did not end and its length is unknown
+        if( last.complete && last.segment == segment ) {
+            segmentEnd = last.offset + last.length;
+        }
+        else {
+            ++segment;
+        }
+    }
+    if( indexFd < 0 ) {
+        indexFd = openFile(path(IndexName), O_WRONLY | O_APPEND);
+    }
+    recovered = true;
+}
+
+bool LogStorage::openSegment(unsigned long number, unsigned long long offset) {
+    closeSegment();
+    segmentFd = openFile(path(segmentName(number)), O_WRONLY);
+    if( segmentFd < 0 ) {
+        return false;
+    }
+    segment = number;
+    segmentEnd = offset;
+    // Blocks are allocated once for the whole segment instead of with every write
+    // Segment that can not be preallocated, e.g. on a full storage, is still written and grows as before
+    struct stat info;
+    if( ::fstat(segmentFd, &info) == 0 && static_cast<unsigned long long>(info.st_size) < segmentSize ) {
+        ::posix_fallocate(segmentFd, 0, static_cast<off_t>(segmentSize));
+    }
+    return true;
+}
+
+int LogStorage::openFile(const std::string &file, int flags) {
+    int fd = ::open(file.c_str(), flags | O_CREAT | O_EXCL, 0644);
+    if( fd >= 0 ) {
+        // New file is only found after a power cut once its entry in the directory is on the storage as well
+        if( durability != NoSync ) {
+            int folder = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+            if( folder >= 0 ) {
+                ::fsync(folder);
+                ::close(folder);
+            }
+        }
+        return fd;
+    }
+    return errno == EEXIST ? ::open(file.c_str(), flags) : -1;
+}
+
+void LogStorage::closeSegment() {
+    if( segmentFd >= 0 ) {
+        ::close(segmentFd);
+        segmentFd = -1;
+    }
+}
+
+bool LogStorage::prepare() {
+    // Session in progress already has its segment
+    if( active ) {
+        return true;
+    }
+    if( !recovered ) {
+        recover();
+    }
+    if( indexFd < 0 ) {
+        return false;
+    }
+    // First session continues the segment the last run left off in, a full segment is left for the next one
+    if( segmentFd < 0 || segmentEnd >= segmentSize ) {
+        unsigned long number = segment;
+        unsigned long long offset = segmentEnd;
+        if( segmentEnd >= segmentSize ) {
+            ++number;
+            offset = 0;
+        }
+        if( !openSegment(number, offset) ) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool LogStorage::begin(long long sessionStart) {
+    end();
+    if( !prepare() ) {
+        return false;
+    }
+    current.id = nextId++;
+    current.start = sessionStart;
+    current.segment = segment;
+    current.offset = segmentEnd;
+    current.length = 0;
+    current.complete = false;
+    if( !appendIndex(current) ) {
+        return false;
+    }
+    lastSync = monotonicTime();
+    active = true;
+    return true;
+}
+
+bool LogStorage::resume(const Session &session, unsigned long long length) {
+    end();
+    if( !recovered ) {
+        recover();
+    }
+    if( indexFd < 0 || session.id + 1 != nextId ) {
+        return false;
+    }
+    // Anything written after the given length was not recorded as written and is overwritten
+    if( segmentFd < 0 || segment != session.segment ) {
+        if( !openSegment(session.segment, session.offset + length) ) {
+            return false;
+        }
+    }
+    segmentEnd = session.offset + length;
+    current = session;
+    current.length = length;
+    current.complete = false;
+    lastSync = monotonicTime();
+    active = true;
+    return true;
+}
+
+bool LogStorage::write(const char *data, std::size_t length) {
+    if( !active ) {
+        return false;
+    }
+    while( length > 0 ) {
+        ssize_t written = ::pwrite(segmentFd, data, length, static_cast<off_t>(segmentEnd));
+        if( written < 0 ) {
+            if( errno == EINTR ) {
+                continue;
+            }
+            return false;
+        }
+        data += written;
+        length -= written;
+        segmentEnd += written;
+        current.length += written;
+    }
+    return true;
+}
+
+void LogStorage::flush() {
+    if( active && durability == PeriodicSync && monotonicTime() - lastSync >= syncInterval ) {
+        sync(segmentFd);
+    }
+}
+
+void LogStorage::end() {
+    if( !active ) {
+        return;
+    }
+    active = false;
+    // Session is on the storage before the index says it ended
+    if( durability != NoSync ) {
+        sync(segmentFd);
+    }
+    current.complete = true;
+    appendIndex(current);
+    if( durability != NoSync ) {
+        sync(indexFd);
+    }
+}
+
+bool LogStorage::appendIndex(const Session &entry) {
+    char line[128];
+    int length;
+    if( entry.complete ) {
+        length = std::sprintf(line, "%lu\t%lld\t%lu\t%llu\t%llu\n", entry.id, entry.start, entry.segment, entry.offset, entry.length);
+    }
+    else {
+        length = std::sprintf(line, "%lu\t%lld\t%lu\t%llu\t-\n", entry.id, entry.start, entry.segment, entry.offset);
+    }
+    // Index is opened for appending, a line is written at once
+    return ::write(indexFd, line, length) == length;
+}
+
+void LogStorage::sync(int fd) {
+    // Segment blocks are preallocated, so syncing the data does not have to update the file size
+    ::fdatasync(fd);
+    lastSync = monotonicTime();
+    ++syncCount;
+}
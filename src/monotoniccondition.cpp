@@ -0,0 +1,34 @@
+#include "monotoniccondition.hpp"
+#include <cerrno>
+#include <time.h>
+
+MonotonicCondition::MonotonicCondition() {
+    pthread_condattr_t attributes;
+    pthread_condattr_init(&attributes);
+    pthread_condattr_setclock(&attributes, CLOCK_MONOTONIC);
+    pthread_cond_init(&condition, &attributes);
+    pthread_condattr_destroy(&attributes);
+}
+
+MonotonicCondition::~MonotonicCondition() {
+    pthread_cond_destroy(&condition);
+}
+
+void MonotonicCondition::notify_one() {
+    pthread_cond_signal(&condition);
+}
+
+void MonotonicCondition::notify_all() {
+    pthread_cond_broadcast(&condition);
+}
+
+void MonotonicCondition::wait(boost::mutex::scoped_lock &lock) {
+    pthread_cond_wait(&condition, lock.mutex()->native_handle());
+}
+
+bool MonotonicCondition::waitUntil(boost::mutex::scoped_lock &lock, long long deadline) {
+    timespec until;
+    until.tv_sec = static_cast<time_t>(deadline/1000000000LL);
+    until.tv_nsec = static_cast<long>(deadline%1000000000LL);
+    return pthread_cond_timedwait(&condition, lock.mutex()->native_handle(), &until) != ETIMEDOUT;
+}
@@ -0,0 +1,124 @@
+#include "playbackqueue.hpp"
+#include <alerror/alerror.h>
+#include <boost/bind.hpp>
+#include <qi/log.hpp>
+
+PlaybackQueue::PlaybackQueue(boost::shared_ptr<SoundBank> soundBank, const Notify &startedCall, const Notify &finishedCall,
+                             LatencyHistograms *latencies, LatencyHistogram *postLatencyHistogram) :
+    sounds(soundBank), started(startedCall), finished(finishedCall),
+    queueLatency(latencies ? &latencies->add("playback.dispatch") : 0), postLatency(postLatencyHistogram),
+    playing(false), task(-1), cancelled(false), shutdown(false) {
+}
+
+PlaybackQueue::~PlaybackQueue() {
+    cancel();
+    {
+        boost::mutex::scoped_lock lock(mutex);
+        shutdown = true;
+        condition.notify_all();
+    }
+    if( worker.joinable() ) {
+        worker.join();
+    }
+}
+
+void PlaybackQueue::push(SoundBank::Sound sound, int value) {
+    Call call;
+    call.sound = sound;
+    call.value = value;
+    call.queued = LatencyHistogram::now();
+    boost::mutex::scoped_lock lock(mutex);
+    // Worker thread survives between sessions, it is only created once
+    if( !worker.joinable() ) {
+        worker = boost::thread(boost::bind(&PlaybackQueue::run, this));
+    }
+    calls.push_back(call);
+    condition.notify_all();
+}
+
+void PlaybackQueue::cancel() {
+    int playingTask;
+    {
+        boost::mutex::scoped_lock lock(mutex);
+        calls.clear();
+        if( !playing ) {
+            return;
+        }
+        cancelled = true;
+        playingTask = task;
+    }
+    // Call that has not started yet is stopped by the worker as soon as it starts
+    if( playingTask >= 0 ) {
+        try {
+            sounds->stop(playingTask);
+        }
+        catch (const AL::ALError& e) {
+            qiLogError("PlaybackQueue") << "Error stopping the call" << e.toString() << std::endl;
+        }
+    }
+}
+
+void PlaybackQueue::run() {
+    boost::mutex::scoped_lock lock(mutex);
+    while( !shutdown ) {
+        if( calls.empty() ) {
+            condition.wait(lock);
+            continue;
+        }
+        Call call = calls.front();
+        calls.pop_front();
+        playing = true;
+        task = -1;
+        cancelled = false;
+        lock.unlock();
+
+        // Player is driven without the queue lock, so calls can be queued and cancelled meanwhile
+        int playTask = -1;
+        try {
+            long long posted = LatencyHistogram::now();
+            playTask = sounds->post(call.sound);
+            if( postLatency ) {
+                postLatency->record(LatencyHistogram::now() - posted);
+            }
+        }
+        catch (const AL::ALError& e) {
+            qiLogError("PlaybackQueue") << "Error starting the call" << e.toString() << std::endl;
+        }
+        // Call counts as started once the player accepted it, which is before its first sample is heard
+        long long start = LatencyHistogram::now();
+        if( queueLatency ) {
+            queueLatency->record(start - call.queued);
+        }
+
+        lock.lock();
+        task = playTask;
+        bool stopped = cancelled;
+        lock.unlock();
+
+        if( playTask >= 0 ) {
+            if( !stopped ) {
+                started(call.value, start);
+            }
+            try {
+                if( stopped ) {
+                    sounds->stop(playTask);
+                }
+                sounds->wait(playTask);
+            }
+            catch (const AL::ALError& e) {
+                qiLogError("PlaybackQueue") << "Error playing the call" << e.toString() << std::endl;
+            }
+        }
+        long long end = LatencyHistogram::now();
+
+        lock.lock();
+        playing = false;
+        task = -1;
+        // Call that could not be played is still reported, so the session goes on without it
+        if( !cancelled ) {
+            lock.unlock();
+            finished(call.value, end);
+            lock.lock();
+        }
+    }
+}
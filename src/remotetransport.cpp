@@ -0,0 +1,245 @@
+#include "remotetransport.hpp"
+#include <boost/bind.hpp>
+#include <qi/log.hpp>
+
+RemoteTransport::RemoteTransport(boost::shared_ptr<AL::ALMemoryProxy> memory, const std::string &module, Mode mode,
+                                 LatencyHistograms *latencies) :
+    memoryProxy(memory), moduleName(module), transportMode(mode), queueLatency(0),
+    sending(false), shutdown(false), sentCount(0), batchCount(0), coalescedCount(0) {
+    if( transportMode == Batched ) {
+        if( latencies ) {
+            queueLatency = &latencies->add("RemoteTransport.queue");
+        }
+        memoryTarget = memoryProxy->getGenericProxy();
+        sender = boost::thread(boost::bind(&RemoteTransport::run, this));
+    }
+}
+
+RemoteTransport::~RemoteTransport() {
+    {
+        boost::mutex::scoped_lock lock(mutex);
+        shutdown = true;
+        condition.notify_all();
+    }
+    if( sender.joinable() ) {
+        sender.join();
+    }
+}
+
+RemoteTransport::Mode RemoteTransport::mode() const {
+    return transportMode;
+}
+
+boost::shared_ptr<AL::ALMemoryProxy> RemoteTransport::memory() const {
+    return memoryProxy;
+}
+
+void RemoteTransport::raiseEvent(const std::string &event, const AL::ALValue &value) {
+    Request request;
+    request.kind = Raise;
+    request.name = event;
+    request.value = value;
+    push(request);
+}
+
+void RemoteTransport::subscribe(const std::string &event, const std::string &callback) {
+    Request request;
+    request.kind = Subscribe;
+    request.name = event;
+    request.callback = callback;
+    push(request);
+}
+
+void RemoteTransport::unsubscribe(const std::string &event) {
+    Request request;
+    request.kind = Unsubscribe;
+    request.name = event;
+    push(request);
+}
+
+void RemoteTransport::call(boost::shared_ptr<AL::ALProxy> proxy, const std::string &method) {
+    Request request;
+    request.kind = Call;
+    request.name = method;
+    request.proxy = proxy;
+    push(request);
+}
+
+void RemoteTransport::call(boost::shared_ptr<AL::ALProxy> proxy, const std::string &method, const AL::ALValue &argument) {
+    Request request;
+    request.kind = CallWithArgument;
+    request.name = method;
+    request.value = argument;
+    request.proxy = proxy;
+    push(request);
+}
+
+void RemoteTransport::push(const Request &request) {
+    // Direct calls are made by the caller, errors reach it as they always did
+    if( transportMode == Direct ) {
+        send(request);
+        return;
+    }
+    boost::mutex::scoped_lock lock(mutex);
+    queue.push_back(request);
+    queue.back().queued = LatencyHistogram::now();
+    condition.notify_one();
+}
+
+void RemoteTransport::flush() {
+    boost::mutex::scoped_lock lock(mutex);
+    while( !queue.empty() || sending ) {
+        idle.wait(lock);
+    }
+}
+
+unsigned long RemoteTransport::sent() const {
+    return sentCount;
+}
+
+unsigned long RemoteTransport::batches() const {
+    return batchCount;
+}
+
+unsigned long RemoteTransport::coalesced() const {
+    return coalescedCount;
+}
+
+bool RemoteTransport::isSubscribed(const std::string &event) const {
+    boost::mutex::scoped_lock lock(subscriptionLock);
+    std::map<std::string, bool>::const_iterator state = subscriptions.find(event);
+    return state != subscriptions.end() && state->second;
+}
+
+void RemoteTransport::run() {
+    boost::mutex::scoped_lock lock(mutex);
+    while( true ) {
+        if( queue.empty() ) {
+            // Nothing left to post, the transport is idle once the posts still running finished
+            if( !pending.empty() ) {
+                lock.unlock();
+                finish();
+                lock.lock();
+                continue;
+            }
+            sending = false;
+            idle.notify_all();
+            if( shutdown ) {
+                break;
+            }
+            condition.wait(lock);
+            continue;
+        }
+        // Everything queued while the last batch was being posted goes out as the next batch
+        std::vector<Request> batch(queue.begin(), queue.end());
+        queue.clear();
+        sending = true;
+        lock.unlock();
+
+        long long now = LatencyHistogram::now();
+        for( std::size_t i = 0; i < batch.size() && queueLatency; ++i ) {
+            queueLatency->record(now - batch[i].queued);
+        }
+        coalesce(batch);
+        for( std::size_t i = 0; i < batch.size(); ++i ) {
+            post(batch[i]);
+        }
+        __sync_fetch_and_add(&batchCount, 1);
+
+        lock.lock();
+    }
+}
+
+void RemoteTransport::post(const Request &request) {
+    bool change = request.kind == Subscribe || request.kind == Unsubscribe;
+    if( change && isSubscribed(request.name) == (request.kind == Subscribe) ) {
+        __sync_fetch_and_add(&coalescedCount, 1);
+        return;
+    }
+    // Requests on an event stay in order, as do calls to a module, everything else is not waited for
+    Order order(request.proxy ? request.proxy.get() : memoryTarget.get(), request.proxy ? std::string() : request.name);
+    std::map<Order, Task>::iterator last = pending.find(order);
+    if( last != pending.end() ) {
+        wait(last->second.first, last->second.second);
+        pending.erase(last);
+    }
+    try {
+        int task = send(request);
+        if( task != 0 ) {
+            pending[order] = Task(request.proxy ? request.proxy : memoryTarget, task);
+        }
+    }
+    catch (const AL::ALError& e) {
+        qiLogError(moduleName.c_str()) << "Error sending " << request.name << e.toString() << std::endl;
+    }
+}
+
+void RemoteTransport::finish() {
+    for( std::map<Order, Task>::iterator last = pending.begin(); last != pending.end(); ++last ) {
+        wait(last->second.first, last->second.second);
+    }
+    pending.clear();
+}
+
+void RemoteTransport::coalesce(std::vector<Request> &batch) {
+    std::size_t kept = 0;
+    for( std::size_t i = 0; i < batch.size(); ++i ) {
+        const Request &request = batch[i];
+        if( request.kind == Subscribe || request.kind == Unsubscribe ) {
+            // Changes of the same event later in the same run of subscription changes override this one, a raise
+            // or a call ends the run as it may depend on the subscription
+            bool overridden = false;
+            for( std::size_t j = i + 1; j < batch.size() && !overridden; ++j ) {
+                if( batch[j].kind != Subscribe && batch[j].kind != Unsubscribe ) {
+                    break;
+                }
+                overridden = batch[j].name == request.name;
+            }
+            if( overridden ) {
+                __sync_fetch_and_add(&coalescedCount, 1);
+                continue;
+            }
+        }
+        if( kept != i ) {
+            batch[kept] = request;
+        }
+        ++kept;
+    }
+    batch.resize(kept);
+}
+
+int RemoteTransport::send(const Request &request) {
+    bool batched = transportMode == Batched;
+    int task = 0;
+    if( request.kind == Raise ) {
+        if( batched ) task = memoryProxy->post.raiseEvent(request.name, request.value);
+        else memoryProxy->raiseEvent(request.name, request.value);
+    }
+    else if( request.kind == Subscribe || request.kind == Unsubscribe ) {
+        // Subscription changes are rare and made at once in both modes, so the state only changes once ALMemory made it
+        if( request.kind == Subscribe ) memoryProxy->subscribeToEvent(request.name, moduleName, request.callback);
+        else memoryProxy->unsubscribeToEvent(request.name, moduleName);
+        boost::mutex::scoped_lock lock(subscriptionLock);
+        subscriptions[request.name] = request.kind == Subscribe;
+    }
+    else if( request.kind == Call ) {
+        if( batched ) task = request.proxy->pCall(request.name);
+        else request.proxy->callVoid(request.name);
+    }
+    else if( request.kind == CallWithArgument ) {
+        if( batched ) task = request.proxy->pCall(request.name, request.value);
+        else request.proxy->callVoid(request.name, request.value);
+    }
+    __sync_fetch_and_add(&sentCount, 1);
+    return task;
+}
+
+void RemoteTransport::wait(boost::shared_ptr<AL::ALProxy> proxy, int task) {
+    try {
+        // Timeout of 0 waits until the task is done
+        proxy->wait(task, 0);
+    }
+    catch (const AL::ALError& e) {
+        qiLogError(moduleName.c_str()) << "Error waiting for a posted call" << e.toString() << std::endl;
+    }
+}
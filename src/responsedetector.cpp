@@ -0,0 +1,74 @@
+#include "responsedetector.hpp"
+#include <algorithm>
+
+ResponseDetector::Thresholds::Thresholds() : dwell(0), gapTolerance(500), window(0) {
+}
+
+ResponseDetector::ResponseDetector(const Thresholds &thresholds) : limits(thresholds) {
+    start();
+}
+
+void ResponseDetector::start() {
+    opened = false;
+    callEnd = 0;
+    facesNeeded = 0;
+    faceCount = 0;
+    firstFace = presenceStart = lastFace = -1;
+    longestPresence = 0;
+    respondedAt = -1;
+}
+
+void ResponseDetector::open(long long end, int faces) {
+    start();
+    opened = true;
+    callEnd = end;
+    facesNeeded = faces;
+}
+
+void ResponseDetector::close() {
+    opened = false;
+}
+
+void ResponseDetector::faceDetected(long long time) {
+    // Faces during the call, or after its window passed, do not count
+    if( !opened || time < callEnd || (limits.window > 0 && time > callEnd + limits.window) ) {
+        return;
+    }
+    ++faceCount;
+    if( firstFace < 0 ) {
+        firstFace = time;
+    }
+    // Gap longer than the tolerance starts a new presence
+    if( presenceStart < 0 || time - lastFace > limits.gapTolerance ) {
+        presenceStart = time;
+    }
+    lastFace = time;
+    longestPresence = std::max(longestPresence, lastFace - presenceStart);
+    if( respondedAt < 0 && facesNeeded > 0 && faceCount >= facesNeeded && longestPresence >= limits.dwell ) {
+        respondedAt = time;
+    }
+}
+
+bool ResponseDetector::responded() const {
+    return opened && respondedAt >= 0;
+}
+
+long long ResponseDetector::firstFaceLatency() const {
+    return firstFace < 0 ? -1 : firstFace - callEnd;
+}
+
+long long ResponseDetector::responseLatency() const {
+    return respondedAt < 0 ? -1 : respondedAt - callEnd;
+}
+
+long long ResponseDetector::dwell() const {
+    return longestPresence;
+}
+
+int ResponseDetector::faces() const {
+    return faceCount;
+}
+
+const ResponseDetector::Thresholds &ResponseDetector::thresholds() const {
+    return limits;
+}
@@ -0,0 +1,178 @@
+#include "sessioncheckpoint.hpp"
+#include "monotonictime.hpp"
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+namespace
+{
+  const char Magic[8] = { 'R', 'T', 'N', 'C', 'K', 'P', 'T', '1' };
+
+  /**
+    * Wall-clock time in microseconds, read through the vDSO like the monotonic clock
+    */
+  long long wallTime() {
+      timeval tv;
+      gettimeofday(&tv, 0);
+      return tv.tv_sec*1000000LL + tv.tv_usec;
+  }
+}
+
+/**
+  * Layout of the checkpoint file, its size tells a checkpoint of another build apart
+  */
+struct SessionCheckpoint::Data {
+    char magic[8];
+    unsigned int size;
+    unsigned int padding;
+    Settings settings;
+    volatile unsigned long sequence;
+    Session sessions[2];
+    AsyncLogWriter::Progress progress;
+};
+
+SessionCheckpoint::SessionCheckpoint() : data(0), fd(-1) {
+}
+
+SessionCheckpoint::~SessionCheckpoint() {
+    close();
+}
+
+bool SessionCheckpoint::open(const std::string &path) {
+    close();
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if( fd < 0 ) {
+        return false;
+    }
+    struct stat info;
+    bool fresh = ::fstat(fd, &info) != 0 || info.st_size != static_cast<off_t>(sizeof(Data));
+    if( fresh && ::ftruncate(fd, sizeof(Data)) != 0 ) {
+        close();
+        return false;
+    }
+    void *mapped = ::mmap(0, sizeof(Data), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if( mapped == MAP_FAILED ) {
+        close();
+        return false;
+    }
+    data = static_cast<Data *>(mapped);
+    if( fresh || std::memcmp(data->magic, Magic, sizeof(Magic)) != 0 || data->size != sizeof(Data) ) {
+        std::memset(data, 0, sizeof(Data));
+        std::memcpy(data->magic, Magic, sizeof(Magic));
+        data->size = sizeof(Data);
+    }
+    filePath = path;
+    return true;
+}
+
+void SessionCheckpoint::close() {
+    if( data ) {
+        ::munmap(data, sizeof(Data));
+        data = 0;
+    }
+    if( fd >= 0 ) {
+        ::close(fd);
+        fd = -1;
+    }
+    filePath.clear();
+}
+
+bool SessionCheckpoint::isOpen() const {
+    return data != 0;
+}
+
+const std::string &SessionCheckpoint::path() const {
+    return filePath;
+}
+
+SessionCheckpoint::Settings &SessionCheckpoint::settings() {
+    return data->settings;
+}
+
+void SessionCheckpoint::save(const Session &session) {
+    Session &next = data->sessions[(data->sequence + 1) & 1];
+    next = session;
+    next.saved = monotonicTime();
+    next.savedWall = wallTime();
+    // Session is complete before the sequence points to it
+    __sync_synchronize();
+    data->sequence = data->sequence + 1;
+}
+
+SessionCheckpoint::Session SessionCheckpoint::load() const {
+    if( !data ) {
+        Session none;
+        std::memset(&none, 0, sizeof(none));
+        return none;
+    }
+    return data->sessions[data->sequence & 1];
+}
+
+bool SessionCheckpoint::live(long long maxAge) const {
+    Session session = load();
+    if( !session.active ) {
+        return false;
+    }
+    // Monotonic clock starts again at boot, so after a reboot it either went back or moved apart from the wall clock
+    long long age = monotonicTime() - session.saved;
+    long long wallAge = (wallTime() - session.savedWall)*1000;
+    long long drift = wallAge > age ? wallAge - age : age - wallAge;
+    return age >= 0 && age <= maxAge && drift <= SameBootTolerance*1000000LL;
+}
+
+AsyncLogWriter::Progress &SessionCheckpoint::progress() {
+    return data->progress;
+}
+
+SessionCheckpoint::Resumed SessionCheckpoint::reconcile(const Session &saved, const std::vector<LogRecord> &records) {
+    Resumed resumed;
+    resumed.iterations = 0;
+    resumed.lastCall = 0;
+    resumed.callPending = false;
+    resumed.ended = false;
+    resumed.endValue = 0;
+    resumed.lastFace = 0;
+    for( std::size_t i = 0; i < records.size(); ++i ) {
+        const LogRecord &record = records[i];
+        long long time = record.timestamp/1000;
+        if( record.event == LogCallStarted || record.event == LogPhraseStarted ) {
+            resumed.callPending = true;
+            resumed.lastCall = std::max(resumed.lastCall, time);
+            resumed.faces.clear();
+        }
+        else if( record.event == LogCallEnded ) {
+            ++resumed.iterations;
+            resumed.callPending = false;
+            resumed.lastCall = std::max(resumed.lastCall, time);
+            resumed.faces.clear();
+        }
+        else if( record.event == LogSessionEnded ) {
+            resumed.ended = true;
+            resumed.endValue = record.value;
+        }
+        else if( record.event == LogFaceDetected ) {
+            resumed.faces.push_back(time);
+            resumed.lastFace = std::max(resumed.lastFace, time);
+        }
+        else if( record.event == LogFaceInterval && record.value > 0 ) {
+            // Frames of the interval are spread over it, as they were sampled
+            for( int frame = 0; frame < record.value; ++frame ) {
+                resumed.faces.push_back(time + record.duration*frame/std::max(1, record.value - 1));
+            }
+            resumed.lastFace = std::max(resumed.lastFace, time + record.duration);
+        }
+    }
+    // Faces saved after the last record was written count as well, as long as the call they follow is the same
+    if( saved.iteration == resumed.iterations && (saved.pendingCall != 0) == resumed.callPending ) {
+        for( int i = static_cast<int>(resumed.faces.size()); i < saved.faces && !resumed.callPending; ++i ) {
+            resumed.faces.push_back(saved.lastFace);
+        }
+        resumed.lastFace = std::max(resumed.lastFace, saved.lastFace);
+        resumed.lastCall = std::max(resumed.lastCall, saved.lastCall);
+    }
+    return resumed;
+}
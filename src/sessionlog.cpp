@@ -0,0 +1,278 @@
+#include "sessionlog.hpp"
+#include "binarylog.hpp"
+#include "logstorage.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+  bool endsWith(const std::string &text, const char *suffix) {
+      std::size_t length = std::strlen(suffix);
+      return text.size() >= length && text.compare(text.size() - length, length, suffix) == 0;
+  }
+
+  /**
+    * Event of a two letter identifier, LogEventCount if unknown
+    */
+  LogEvent eventOf(const char *name) {
+      static const char *names[] = { "FD", "CS", "PS", "CE", "SE", "SC" };
+      for( int i = 0; i < 6; ++i ) {
+          if( name[0] == names[i][0] && name[1] == names[i][1] ) {
+              return static_cast<LogEvent>(i);
+          }
+      }
+      if( name[0] == 'S' && name[1] == 'M' ) {
+          return LogSummary;
+      }
+      return LogEventCount;
+  }
+
+  long long toMicroseconds(double seconds) {
+      return static_cast<long long>(std::floor(seconds*1000000.0 + 0.5));
+  }
+
+  int toMilliseconds(double seconds) {
+      return static_cast<int>(std::floor(seconds*1000.0 + 0.5));
+  }
+
+  /**
+    * Parses the feature list of an SC line, [Class, feature, feature, ...]
+    * Class may be quoted, nested lists are flattened
+    */
+  void parseFeatures(const char *begin, const char *end, LogRecord &record) {
+      std::string line(begin, end);
+      const char *p = line.c_str();
+      while( *p == '[' || *p == ' ' || *p == '"' ) ++p;
+      const char *label = p;
+      while( *p && *p != ',' && *p != ']' && *p != '"' ) ++p;
+      std::string name(label, p);
+      record.value = name == "Neartikulirano" ? 0 : (name == "Artikulirano" ? 1 : -1);
+      std::size_t nameLength = std::min<std::size_t>(name.size(), LogRecord::MaxNameLength - 1);
+      name.copy(record.name, nameLength);
+      record.name[nameLength] = '\0';
+      record.featureCount = 0;
+      while( *p && record.featureCount < LogRecord::MaxFeatures ) {
+          char *next;
+          float feature = static_cast<float>(std::strtod(p, &next));
+          if( next == p ) {
+              ++p;
+              continue;
+          }
+          record.features[record.featureCount++] = feature;
+          p = next;
+      }
+  }
+}
+
+void parseSessionLogText(const char *begin, const char *end, std::vector<LogRecord> &records) {
+    long long lastTimestamp = 0;
+    const char *line = begin;
+    while( line < end ) {
+        const char *lineEnd = static_cast<const char *>(std::memchr(line, '\n', end - line));
+        if( !lineEnd ) {
+            lineEnd = end;
+        }
+        LogEvent event = lineEnd - line > 3 && line[2] == '\t' ? eventOf(line) : LogEventCount;
+        if( event != LogEventCount ) {
+            LogRecord record;
+            record.event = event;
+            record.featureCount = 0;
+            record.duration = 0;
+            record.value = 0;
+            record.timestamp = lastTimestamp;
+            record.name[0] = '\0';
+            const char *p = line + 3;
+            if( event == LogSoundClassified && *p == '[' ) {
+                record.event = LogSoundFeatures;
+                parseFeatures(p, lineEnd, record);
+                records.push_back(record);
+            }
+            else {
+                // Columns are value, time and, for face intervals, the length of the interval
+                std::string columns(p, lineEnd);
+                char *next;
+                record.value = static_cast<int>(std::strtol(columns.c_str(), &next, 10));
+                const char *time = next;
+                double seconds = std::strtod(time, &next);
+                if( next != time ) {
+                    record.timestamp = toMicroseconds(seconds);
+                    const char *duration = next;
+                    double length = std::strtod(duration, &next);
+                    if( event == LogFaceDetected && next != duration ) {
+                        record.event = LogFaceInterval;
+                        record.duration = toMilliseconds(length);
+                    }
+                    // Summary lines carry the metrics after the time
+                    while( event == LogSummary && next != duration && record.featureCount < LogRecord::MaxFeatures ) {
+                        record.features[record.featureCount++] = static_cast<float>(length);
+                        duration = next;
+                        length = std::strtod(duration, &next);
+                    }
+                    lastTimestamp = record.timestamp;
+                    records.push_back(record);
+                }
+            }
+        }
+        line = lineEnd + 1;
+    }
+}
+
+bool parseSessionLogBinary(const char *begin, const char *end, std::vector<LogRecord> &records) {
+    BinaryLogDecoder decoder;
+    if( decoder.decodeHeader(begin, end) != BinaryLogDecoder::Decoded ) {
+        return false;
+    }
+    LogRecord record;
+    BinaryLogDecoder::Result result;
+    while( (result = decoder.decode(begin, end, record)) == BinaryLogDecoder::Decoded ) {
+        records.push_back(record);
+    }
+    return result != BinaryLogDecoder::Corrupt;
+}
+
+namespace
+{
+  /**
+    * Maps length bytes of the file from offset, or the whole file if length is negative, and parses them
+    */
+  bool readLogRange(const std::string &path, unsigned long long offset, long long length, std::vector<LogRecord> &records) {
+      int fd = ::open(path.c_str(), O_RDONLY);
+      if( fd < 0 ) {
+          return false;
+      }
+      struct stat info;
+      if( ::fstat(fd, &info) != 0 ) {
+          ::close(fd);
+          return false;
+      }
+      if( length < 0 ) {
+          length = info.st_size;
+      }
+      if( offset + length > static_cast<unsigned long long>(info.st_size) ) {
+          ::close(fd);
+          return false;
+      }
+      // Session stopped before anything was logged
+      if( length == 0 ) {
+          ::close(fd);
+          return true;
+      }
+      // Mapping has to start at a page boundary
+      unsigned long long skip = offset % ::sysconf(_SC_PAGESIZE);
+      std::size_t mapped = static_cast<std::size_t>(length + skip);
+      void *data = ::mmap(0, mapped, PROT_READ, MAP_PRIVATE, fd, static_cast<off_t>(offset - skip));
+      ::close(fd);
+      if( data == MAP_FAILED ) {
+          return false;
+      }
+      ::madvise(data, mapped, MADV_SEQUENTIAL);
+      const char *begin = static_cast<const char *>(data) + skip;
+      const char *end = begin + length;
+
+      bool ok = true;
+      if( length >= 4 && std::memcmp(begin, "RTNB", 4) == 0 ) {
+          ok = parseSessionLogBinary(begin, end, records);
+      }
+      else {
+          parseSessionLogText(begin, end, records);
+      }
+      ::munmap(data, mapped);
+      return ok;
+  }
+}
+
+bool locateSessionLog(const std::string &path, std::string &file, unsigned long long &offset, long long &length) {
+    std::string::size_type mark = path.rfind('#');
+    std::string::size_type slash = path.rfind('/');
+    std::string::size_type name = slash == std::string::npos ? 0 : slash + 1;
+    if( mark == std::string::npos || mark < name || path.compare(name, mark - name, LogStorage::IndexName) != 0 ) {
+        file = path;
+        offset = 0;
+        length = -1;
+        return true;
+    }
+    // Session stored in a segment, found through the index
+    std::string directory = slash == std::string::npos ? "." : path.substr(0, slash);
+    unsigned long id = std::strtoul(path.c_str() + mark + 1, 0, 10);
+    std::vector<LogStorage::Session> sessions;
+    if( !LogStorage::readIndex(directory, sessions) ) {
+        return false;
+    }
+    for( std::size_t i = 0; i < sessions.size(); ++i ) {
+        if( sessions[i].id == id && sessions[i].complete ) {
+            file = directory + "/" + LogStorage::segmentName(sessions[i].segment);
+            offset = sessions[i].offset;
+            length = static_cast<long long>(sessions[i].length);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool readSessionLog(const std::string &path, std::vector<LogRecord> &records) {
+    std::string file;
+    unsigned long long offset;
+    long long length;
+    return locateSessionLog(path, file, offset, length) && readLogRange(file, offset, length, records);
+}
+
+bool readSessionLog(const SessionLogLocation &location, std::vector<LogRecord> &records) {
+    return readLogRange(location.file, location.offset, location.length, records);
+}
+
+std::vector<std::string> listSessionLogs(const std::string &directory) {
+    std::vector<SessionLogLocation> locations = locateSessionLogs(directory);
+    std::vector<std::string> logs;
+    for( std::size_t i = 0; i < locations.size(); ++i ) {
+        logs.push_back(locations[i].path);
+    }
+    return logs;
+}
+
+std::vector<SessionLogLocation> locateSessionLogs(const std::string &directory) {
+    std::vector<SessionLogLocation> logs;
+    DIR *dir = ::opendir(directory.c_str());
+    if( !dir ) {
+        return logs;
+    }
+    std::vector<std::string> names;
+    while( struct dirent *entry = ::readdir(dir) ) {
+        std::string name = entry->d_name;
+        if( endsWith(name, "_ResponseToName.txt") || endsWith(name, "_ResponseToName.rtnb") ) {
+            names.push_back(directory + "/" + name);
+        }
+    }
+    ::closedir(dir);
+    std::sort(names.begin(), names.end());
+    for( std::size_t i = 0; i < names.size(); ++i ) {
+        SessionLogLocation log;
+        log.path = log.file = names[i];
+        log.offset = 0;
+        log.length = -1;
+        logs.push_back(log);
+    }
+    // Sessions of the log storage follow in the order of their IDs, only those which ended
+    std::vector<LogStorage::Session> sessions;
+    LogStorage::readIndex(directory, sessions);
+    for( std::size_t i = 0; i < sessions.size(); ++i ) {
+        if( sessions[i].complete ) {
+            char id[32];
+            std::sprintf(id, "#%lu", sessions[i].id);
+            SessionLogLocation log;
+            log.path = directory + "/" + LogStorage::IndexName + id;
+            log.file = directory + "/" + LogStorage::segmentName(sessions[i].segment);
+            log.offset = sessions[i].offset;
+            log.length = static_cast<long long>(sessions[i].length);
+            logs.push_back(log);
+        }
+    }
+    return logs;
+}
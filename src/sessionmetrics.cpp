@@ -0,0 +1,115 @@
+#include "sessionmetrics.hpp"
+
+SessionMetrics::SessionMetrics() :
+    outcome(0), nameCalls(0), phraseCalls(0), callsToResponse(-1), sounds(0) {
+}
+
+double SessionMetrics::meanFaceLatency() const {
+    long long sum = 0;
+    int count = 0;
+    for( std::size_t i = 0; i < faceLatencies.size(); ++i ) {
+        if( faceLatencies[i] >= 0 ) {
+            sum += faceLatencies[i];
+            ++count;
+        }
+    }
+    return count > 0 ? static_cast<double>(sum)/count : -1.0;
+}
+
+long long SessionMetrics::responseFaceLatency() const {
+    if( outcome != 1 || faceLatencies.empty() ) {
+        return -1;
+    }
+    return faceLatencies.back();
+}
+
+LogRecord SessionMetrics::toLogRecord(long long timestamp) const {
+    LogRecord record;
+    record.event = LogSummary;
+    record.value = outcome;
+    record.timestamp = timestamp;
+    record.duration = 0;
+    double mean = meanFaceLatency();
+    long long response = responseFaceLatency();
+    record.features[0] = static_cast<float>(nameCalls);
+    record.features[1] = static_cast<float>(phraseCalls);
+    record.features[2] = static_cast<float>(callsToResponse);
+    record.features[3] = static_cast<float>(sounds);
+    record.features[4] = static_cast<float>(mean < 0 ? -1.0 : mean/1000.0);
+    record.features[5] = static_cast<float>(response < 0 ? -1.0 : response/1000.0);
+    record.featureCount = 6;
+    for( std::size_t i = 0; i < soundsBetweenCalls.size() && record.featureCount < LogRecord::MaxFeatures; ++i ) {
+        record.features[record.featureCount++] = static_cast<float>(soundsBetweenCalls[i]);
+    }
+    return record;
+}
+
+SessionMetricsTracker::SessionMetricsTracker() :
+    calling(false), waitingForFace(false), callEnd(0), sounds(0) {
+}
+
+void SessionMetricsTracker::add(const LogRecord &record) {
+    if( current.outcome != 0 ) {
+        return;
+    }
+    if( record.event == LogCallStarted || record.event == LogPhraseStarted ) {
+        if( record.event == LogCallStarted ) {
+            ++current.nameCalls;
+        }
+        else {
+            ++current.phraseCalls;
+        }
+        if( waitingForFace ) {
+            current.faceLatencies.push_back(-1);
+            waitingForFace = false;
+        }
+        if( !calling ) {
+            current.soundsBetweenCalls.push_back(sounds);
+            sounds = 0;
+        }
+        calling = true;
+    }
+    else if( record.event == LogCallEnded && calling ) {
+        calling = false;
+        waitingForFace = true;
+        callEnd = record.timestamp;
+    }
+    else if( record.event == LogFaceDetected || record.event == LogFaceInterval ) {
+        // Face interval which started during the call counts from the end of the call
+        if( waitingForFace && record.timestamp + record.duration*1000LL >= callEnd ) {
+            current.faceLatencies.push_back(record.timestamp > callEnd ? record.timestamp - callEnd : 0);
+            waitingForFace = false;
+        }
+    }
+    else if( record.event == LogSoundClassified ) {
+        ++current.sounds;
+        if( !calling ) {
+            ++sounds;
+        }
+    }
+    else if( record.event == LogSessionEnded ) {
+        current.outcome = record.value;
+    }
+}
+
+SessionMetrics SessionMetricsTracker::metrics() const {
+    SessionMetrics metrics = current;
+    if( waitingForFace ) {
+        metrics.faceLatencies.push_back(-1);
+    }
+    if( !calling ) {
+        metrics.soundsBetweenCalls.push_back(sounds);
+    }
+    if( metrics.outcome == 1 ) {
+        metrics.callsToResponse = metrics.nameCalls + metrics.phraseCalls;
+    }
+    return metrics;
+}
+
+SessionMetrics sessionMetrics(const std::vector<LogRecord> &log) {
+    SessionMetricsTracker tracker;
+    for( std::size_t i = 0; i < log.size(); ++i ) {
+        tracker.add(log[i]);
+    }
+    return tracker.metrics();
+}
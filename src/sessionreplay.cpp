@@ -0,0 +1,137 @@
+#include "sessionreplay.hpp"
+#include <algorithm>
+
+namespace
+{
+  /**
+    * Record of a decision made at the given millisecond of the virtual clock
+    */
+  LogRecord decisionRecord(LogEvent event, int value, long long time) {
+      LogRecord record;
+      record.event = event;
+      record.featureCount = 0;
+      record.value = value;
+      record.timestamp = time*1000;
+      record.duration = 0;
+      return record;
+  }
+
+  /**
+    * Times of all faces in the log in milliseconds, face intervals are spread evenly over their length
+    */
+  std::vector<long long> faceTimes(const std::vector<LogRecord> &log) {
+      std::vector<long long> faces;
+      for( std::size_t i = 0; i < log.size(); ++i ) {
+          const LogRecord &record = log[i];
+          if( record.event == LogFaceDetected ) {
+              faces.push_back(record.timestamp/1000);
+          }
+          else if( record.event == LogFaceInterval ) {
+              int frames = std::max(record.value, 1);
+              for( int frame = 0; frame < frames; ++frame ) {
+                  long long offset = frames > 1 ? static_cast<long long>(record.duration)*frame/(frames - 1) : 0;
+                  faces.push_back(record.timestamp/1000 + offset);
+              }
+          }
+      }
+      std::stable_sort(faces.begin(), faces.end());
+      return faces;
+  }
+}
+
+SessionReplay::Result::Result() :
+    recordedOutcome(0), replayedOutcome(0), recordedEnd(-1), replayedEnd(-1), recordedCalls(0), replayedCalls(0),
+    stalled(false) {
+}
+
+SessionReplay::SessionReplay(const CallProtocol::Parameters &parameters, long long callDuration,
+                             const ResponseDetector::Thresholds &response) :
+    table(CallProtocol::tableOf(parameters)), callDuration(callDuration), response(response) {
+}
+
+SessionReplay::SessionReplay(const CallProtocol::Table &protocolTable, long long callDuration,
+                             const ResponseDetector::Thresholds &response) :
+    table(protocolTable), callDuration(callDuration), response(response) {
+}
+
+long long SessionReplay::estimateCallDuration(const std::vector<LogRecord> &log) {
+    std::vector<long long> durations;
+    long long callStart = -1;
+    for( std::size_t i = 0; i < log.size(); ++i ) {
+        if( log[i].event == LogCallStarted || log[i].event == LogPhraseStarted ) {
+            callStart = log[i].timestamp;
+        }
+        else if( log[i].event == LogCallEnded && callStart >= 0 ) {
+            durations.push_back((log[i].timestamp - callStart)/1000);
+            callStart = -1;
+        }
+    }
+    if( durations.empty() ) {
+        return 1500;
+    }
+    std::nth_element(durations.begin(), durations.begin() + durations.size()/2, durations.end());
+    return durations[durations.size()/2];
+}
+
+SessionReplay::Result SessionReplay::run(const std::vector<LogRecord> &log) const {
+    Result result;
+    for( std::size_t i = 0; i < log.size(); ++i ) {
+        if( log[i].event == LogCallStarted || log[i].event == LogPhraseStarted ) {
+            result.recordedCalls++;
+        }
+        else if( log[i].event == LogSessionEnded ) {
+            result.recordedOutcome = log[i].value;
+            result.recordedEnd = log[i].timestamp/1000;
+        }
+    }
+
+    const std::vector<long long> faces = faceTimes(log);
+    const long long duration = callDuration >= 0 ? callDuration : estimateCallDuration(log);
+
+    CallProtocol protocol(table, response);
+    protocol.start(0);
+    std::size_t nextFace = 0;
+    long long callEnd = CallProtocol::Never;
+    long long now = 0;
+
+    // Each pass advances the virtual clock to the next input or deadline, whichever comes first
+    while( true ) {
+        CallProtocol::Decision decision = protocol.step(now);
+        if( decision.action == CallProtocol::CallByName || decision.action == CallProtocol::CallWithPhrase ) {
+            LogEvent event = decision.action == CallProtocol::CallByName ? LogCallStarted : LogPhraseStarted;
+            result.decisions.push_back(decisionRecord(event, decision.value, now));
+            result.replayedCalls++;
+            callEnd = now + duration;
+        }
+        else if( decision.action == CallProtocol::EndSession ) {
+            result.decisions.push_back(decisionRecord(LogSessionEnded, decision.value, now));
+            result.replayedOutcome = decision.value;
+            result.replayedEnd = now;
+            break;
+        }
+        // Virtual clock only moves forward to the next deadline, one at the same time would decide the same again
+        if( decision.action != CallProtocol::None && decision.deadline <= now ) {
+            result.stalled = true;
+            break;
+        }
+
+        long long faceTime = nextFace < faces.size() ? faces[nextFace] : CallProtocol::Never;
+        long long next = std::min(decision.deadline, std::min(faceTime, callEnd));
+        if( next == CallProtocol::Never ) {
+            break;
+        }
+        now = std::max(now, next);
+
+        // Call ending at the same time as a face is applied first, as the face then counts toward the response
+        if( callEnd <= next ) {
+            int iteration = protocol.callEnded(now);
+            result.decisions.push_back(decisionRecord(LogCallEnded, iteration, now));
+            callEnd = CallProtocol::Never;
+        }
+        else if( faceTime <= next ) {
+            protocol.faceDetected(now);
+            nextFace++;
+        }
+    }
+    return result;
+}
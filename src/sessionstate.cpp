@@ -0,0 +1,97 @@
+#include "sessionstate.hpp"
+#include <boost/thread/thread.hpp>
+
+/**
+  * Words of the state are loaded and stored atomically where the compiler can, so thread sanitizers see no race,
+  * older compilers rely on the sequence alone to discard torn copies
+  */
+#if defined(__ATOMIC_RELAXED)
+#define STATE_LOAD(word) __atomic_load_n(&(word), __ATOMIC_RELAXED)
+#define STATE_STORE(word, value) __atomic_store_n(&(word), (value), __ATOMIC_RELAXED)
+#else
+#define STATE_LOAD(word) (word)
+#define STATE_STORE(word, value) ((word) = (value))
+#endif
+
+SessionState::Snapshot::Snapshot() :
+    start(0), lastFace(0), lastCall(0), deadline(0), session(0), iteration(0), faces(0), active(false), ended(false) {
+}
+
+SessionState::Handler::Handler(SessionState &sessionState) : state(sessionState), entered(false) {
+    // Handlers of an inactive session leave the count alone, so a flood of late events can not hold quiesce up
+    if( !state.read().active ) {
+        return;
+    }
+    // Count is raised before the state is read again, so quiesce either sees the handler or the handler sees the end
+    __sync_fetch_and_add(&state.handlers, 1);
+    entered = state.read().active;
+    if( !entered ) {
+        __sync_fetch_and_sub(&state.handlers, 1);
+    }
+}
+
+SessionState::Handler::~Handler() {
+    if( entered ) {
+        __sync_fetch_and_sub(&state.handlers, 1);
+    }
+}
+
+bool SessionState::Handler::active() const {
+    return entered;
+}
+
+SessionState::SessionState() : sequence(0), handlers(0), retryCount(0) {
+    publish(Snapshot());
+}
+
+void SessionState::publish(const Snapshot &snapshot) {
+    unsigned long next = STATE_LOAD(sequence) + 1;
+    STATE_STORE(sequence, next);
+    __sync_synchronize();
+    STATE_STORE(words[0], snapshot.start);
+    STATE_STORE(words[1], snapshot.lastFace);
+    STATE_STORE(words[2], snapshot.lastCall);
+    STATE_STORE(words[3], snapshot.deadline);
+    STATE_STORE(words[4], static_cast<long long>(snapshot.session));
+    STATE_STORE(words[5], static_cast<long long>(snapshot.iteration));
+    STATE_STORE(words[6], static_cast<long long>(snapshot.faces));
+    STATE_STORE(words[7], static_cast<long long>(snapshot.active));
+    STATE_STORE(words[8], static_cast<long long>(snapshot.ended));
+    __sync_synchronize();
+    STATE_STORE(sequence, next + 1);
+}
+
+SessionState::Snapshot SessionState::read() const {
+    Snapshot snapshot;
+    while( true ) {
+        unsigned long before = STATE_LOAD(sequence);
+        if( (before & 1) == 0 ) {
+            __sync_synchronize();
+            snapshot.start = STATE_LOAD(words[0]);
+            snapshot.lastFace = STATE_LOAD(words[1]);
+            snapshot.lastCall = STATE_LOAD(words[2]);
+            snapshot.deadline = STATE_LOAD(words[3]);
+            snapshot.session = static_cast<int>(STATE_LOAD(words[4]));
+            snapshot.iteration = static_cast<int>(STATE_LOAD(words[5]));
+            snapshot.faces = static_cast<int>(STATE_LOAD(words[6]));
+            snapshot.active = STATE_LOAD(words[7]) != 0;
+            snapshot.ended = STATE_LOAD(words[8]) != 0;
+            __sync_synchronize();
+            if( STATE_LOAD(sequence) == before ) {
+                return snapshot;
+            }
+        }
+        __sync_fetch_and_add(&retryCount, 1);
+    }
+}
+
+void SessionState::quiesce() const {
+    __sync_synchronize();
+    while( STATE_LOAD(handlers) != 0 ) {
+        boost::this_thread::yield();
+    }
+}
+
+unsigned long SessionState::retries() const {
+    return STATE_LOAD(retryCount);
+}
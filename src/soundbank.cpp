@@ -0,0 +1,111 @@
+#include "soundbank.hpp"
+#include <qi/log.hpp>
+
+SoundBank::SoundBank(boost::shared_ptr<AL::ALAudioPlayerProxy> audioPlayer, LatencyHistograms *latencies) :
+    player(audioPlayer), loadLatency(latencies ? &latencies->add("ALAudioPlayer.loadFile") : 0),
+    directory("/home/nao/naoqi/modules/sounds/") {
+    for( int i = 0; i < SoundCount; ++i ) {
+        ids[i] = -1;
+    }
+}
+
+SoundBank::~SoundBank() {
+    unload();
+}
+
+const char *SoundBank::fileName(Sound sound) {
+    static const char *names[SoundCount] = { "name.wav", "phrase.wav", "bravo.wav" };
+    return names[sound];
+}
+
+void SoundBank::setDirectory(const std::string &newDirectory) {
+    std::string folder = newDirectory;
+    if( !folder.empty() && folder[folder.size() - 1] != '/' ) {
+        folder += '/';
+    }
+    bool changed;
+    {
+        boost::mutex::scoped_lock lock(mutex);
+        changed = folder != directory;
+    }
+    // Sounds of another directory are no longer of use
+    if( changed ) {
+        unload();
+        boost::mutex::scoped_lock lock(mutex);
+        directory = folder;
+    }
+}
+
+bool SoundBank::load() {
+    boost::mutex::scoped_lock lock(mutex);
+    bool loaded = true;
+    for( int i = 0; i < SoundCount; ++i ) {
+        if( ids[i] >= 0 ) {
+            continue;
+        }
+        std::string file = directory + fileName(static_cast<Sound>(i));
+        std::string error;
+        if( !readWavInfo(file, info[i], error) ) {
+            qiLogError("SoundBank") << "Sound " << file << " can not be played: " << error << std::endl;
+            loaded = false;
+            continue;
+        }
+        try {
+            long long start = LatencyHistogram::now();
+            ids[i] = player->loadFile(file);
+            if( loadLatency ) {
+                loadLatency->record(LatencyHistogram::now() - start);
+            }
+            qiLogInfo("SoundBank") << "Loaded " << file << ", " << info[i].duration() << " ms at "
+                                   << info[i].sampleRate << " Hz" << std::endl;
+        }
+        catch (const AL::ALError& e) {
+            qiLogError("SoundBank") << "Error loading " << file << e.toString() << std::endl;
+            loaded = false;
+        }
+    }
+    return loaded;
+}
+
+void SoundBank::unload() {
+    boost::mutex::scoped_lock lock(mutex);
+    for( int i = 0; i < SoundCount; ++i ) {
+        if( ids[i] < 0 ) {
+            continue;
+        }
+        try {
+            player->unloadFile(ids[i]);
+        }
+        catch (const AL::ALError& e) {
+            qiLogError("SoundBank") << "Error unloading " << fileName(static_cast<Sound>(i)) << e.toString() << std::endl;
+        }
+        ids[i] = -1;
+    }
+}
+
+int SoundBank::id(Sound sound) {
+    boost::mutex::scoped_lock lock(mutex);
+    return ids[sound];
+}
+
+std::string SoundBank::path(Sound sound) {
+    boost::mutex::scoped_lock lock(mutex);
+    return directory + fileName(sound);
+}
+
+int SoundBank::post(Sound sound) {
+    int soundId = id(sound);
+    if( soundId >= 0 ) {
+        return player->post.play(soundId);
+    }
+    return player->post.playFile(path(sound));
+}
+
+void SoundBank::wait(int task) {
+    // No timeout, the task ends with the sound
+    player->wait(task, 0);
+}
+
+void SoundBank::stop(int task) {
+    player->stop(task);
+}
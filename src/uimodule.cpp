@@ -5,6 +5,13 @@
  */
 
 #include "uimodule.hpp"
+#include "eventdispatcher.hpp"
+#include "remotetransport.hpp"
+#include "concurrentsetup.hpp"
+#include "latencyhistogram.hpp"
+#include "soundbank.hpp"
+#include "playbackqueue.hpp"
+#include "eventtime.hpp"
 #include <iostream>
 #include <fstream>
 #include <alvalue/alvalue.h>
@@ -12,12 +19,31 @@
 #include <alcommon/albroker.h>
 #include <boost/date_time/posix_time/posix_time.hpp>
 #include <boost/thread.hpp>
+#include <boost/bind.hpp>
 #include <boost/lambda/lambda.hpp>
 #include <qi/log.hpp>
 #include <althread/alcriticalsection.h>
 
 struct ResponseToNameInterface::Impl {
 
+    /**
+      * Latency of every callback and proxy call, declared first as the other members record into it
+      */
+    LatencyHistograms latencies;
+    LatencyHistogram *postPlayLatency;
+    LatencyHistogram *fadeLatency;
+    LatencyHistogram *raiseEventLatency;
+
+    /**
+      * Time from creating the module until it is warmed up, from the touch until StartSessionRTN is raised,
+      * and of each step of setting them up
+      */
+    LatencyHistogram *startupLatency;
+    LatencyHistogram *sessionStartLatency;
+    LatencyHistogram *connectLatency;
+    LatencyHistogram *loadSoundsLatency;
+    LatencyHistogram *subscribeLatency;
+
     /**
       * Proxy to ALMemory
       */
@@ -31,6 +57,36 @@ struct ResponseToNameInterface::Impl {
       */
     boost::shared_ptr<AL::ALLedsProxy> ledProxy;
 
+    /**
+      * Carries the calls to ALMemory, batched when the Interface is a remote binary
+      */
+    boost::shared_ptr<RemoteTransport> transport;
+
+    /**
+      * Session recordings, loaded into the player before the session starts
+      */
+    boost::shared_ptr<SoundBank> sounds;
+
+    /**
+      * Folder of the recordings, set by the soundDirectory parameter
+      */
+    std::string soundDirectory;
+
+    /**
+      * Recordings are loaded into the player unless disabled by the soundBank parameter, otherwise played from the files
+      */
+    bool useSoundBank;
+
+    /**
+      * Plays the calls on its own thread, declared after the proxies so it is stopped before them
+      */
+    boost::shared_ptr<PlaybackQueue> playback;
+
+    /**
+      * Routes subscribed events to the module, protecting the handlers from re-entry
+      */
+    boost::shared_ptr<EventDispatcher> dispatcher;
+
     /**
       * Module object
       */
@@ -43,23 +99,189 @@ struct ResponseToNameInterface::Impl {
 
     bool started;
 
+    /**
+      * Session is running, from its start or resume until EndSessionRTN
+      */
+    bool inSession;
+
+    /**
+      * Monotonic time at which the session in progress started, carried to the Logger by StartSessionRTN
+      */
+    long long sessionStart;
+
+    /**
+      * Monotonic time the module was created and how long it took until it was warmed up, in nanoseconds
+      */
+    long long created;
+    long long startupTime;
+
+    /**
+      * Loads the recordings after init, every session and parameter change waits for it
+      * Declared last, so it is joined before anything it uses is destroyed
+      */
+    ConcurrentSetup warmup;
+
     /**
       * Struct constructor, initializes module instance and callback mutex
       */
     Impl(ResponseToNameInterface &mod) : module(mod), fCallbackMutex(AL::ALMutex::createALMutex()) {
-        // Create proxies
-        try {
-            memoryProxy = boost::shared_ptr<AL::ALMemoryProxy>(new AL::ALMemoryProxy(mod.getParentBroker()));
-            playerProxy = boost::shared_ptr<AL::ALAudioPlayerProxy>(new AL::ALAudioPlayerProxy(mod.getParentBroker()));
-            ledProxy = boost::shared_ptr<AL::ALLedsProxy>(new AL::ALLedsProxy(mod.getParentBroker()));
-        }
-        catch (const AL::ALError& e) {
-            qiLogError("ResponseToNameInterface") << "Error creating proxies" << e.toString() << std::endl;
+        postPlayLatency = &latencies.add("ALAudioPlayer.post.play");
+        fadeLatency = &latencies.add("ALLeds.post.fadeRGB");
+        raiseEventLatency = &latencies.add("ALMemory.raiseEvent");
+        startupLatency = &latencies.add("Setup.startup");
+        sessionStartLatency = &latencies.add("Setup.sessionStart");
+        connectLatency = &latencies.add("Setup.proxy");
+        loadSoundsLatency = &latencies.add("Setup.loadSounds");
+        subscribeLatency = &latencies.add("Setup.subscribe");
+        created = monotonicTime();
+        startupTime = -1;
+        // Create proxies, each one waits for its module to answer, so they are created concurrently
+        {
+            ConcurrentSetup proxies;
+            proxies.run(boost::bind(&Impl::createProxy<AL::ALMemoryProxy>, this, &memoryProxy), connectLatency);
+            proxies.run(boost::bind(&Impl::createProxy<AL::ALAudioPlayerProxy>, this, &playerProxy), connectLatency);
+            proxies.run(boost::bind(&Impl::createProxy<AL::ALLedsProxy>, this, &ledProxy), connectLatency);
+            proxies.wait();
         }
+        sounds = boost::shared_ptr<SoundBank>(new SoundBank(playerProxy, &latencies));
+        soundDirectory = "/home/nao/naoqi/modules/sounds/";
+        useSoundBank = true;
+        playback = boost::shared_ptr<PlaybackQueue>(new PlaybackQueue(sounds, boost::bind(&Impl::callStarted, this, _1, _2),
+                                                                      boost::bind(&Impl::callFinished, this, _1, _2),
+                                                                      &latencies, postPlayLatency));
         // Declare events that are generated by this module
         memoryProxy->declareEvent("StartSessionRTN");
+        memoryProxy->declareEvent("CallStartedRTN");
         memoryProxy->declareEvent("ChildCalledRTN");
+        // Calls are queued for playback at once, a repeated touch or session end is ignored
+#ifdef INTERFACE_IS_REMOTE
+        transport = boost::shared_ptr<RemoteTransport>(new RemoteTransport(memoryProxy, "ResponseToNameInterface", RemoteTransport::Batched, &latencies));
+#else
+        transport = boost::shared_ptr<RemoteTransport>(new RemoteTransport(memoryProxy, "ResponseToNameInterface", RemoteTransport::Direct, &latencies));
+#endif
+        dispatcher = boost::shared_ptr<EventDispatcher>(new EventDispatcher(transport, "ResponseToNameInterface", &latencies));
+        dispatcher->add("FrontTactilTouched", "onTactilTouched", boost::bind(&ResponseToNameInterface::tactilTouched, &mod, _1), EventDispatcher::Gate::Drop);
+        dispatcher->add("CallChildRTN", "callChild", boost::bind(&ResponseToNameInterface::playCall, &mod, _1), EventDispatcher::Gate::Drop);
+        dispatcher->add("EndSessionRTN", "endSession", boost::bind(&ResponseToNameInterface::resetSession, &mod, _1), EventDispatcher::Gate::Drop);
+        dispatcher->add("SessionResumedRTN", "sessionResumed", boost::bind(&ResponseToNameInterface::joinSession, &mod, _1), EventDispatcher::Gate::Drop);
+        // Logger may resume a session at any time
+        dispatcher->subscribe("SessionResumedRTN");
         started = false;
+        inSession = false;
+        sessionStart = monotonicTime();
+#if defined(RTN_EVENT_BUS) && !defined(INTERFACE_IS_REMOTE)
+        // Logger loaded into the same process talks to the Interface through the event bus
+        std::vector<std::string> busEvents;
+        busEvents.push_back("CallChildRTN");
+        busEvents.push_back("EndSessionRTN");
+        busEvents.push_back("SessionResumedRTN");
+        dispatcher->connect(busEvents);
+#endif
+        // Recordings are loaded before the first session
+        warmup.run(boost::bind(&Impl::loadSounds, this), loadSoundsLatency);
+    }
+
+    /**
+      * Destructor, no event arrives through the bus once the members start to go away
+      */
+    ~Impl() {
+        dispatcher->disconnect();
+    }
+
+    /**
+      * Creates the proxy to the module the proxy class stands for
+      */
+    template<class Proxy>
+    void createProxy(boost::shared_ptr<Proxy> *proxy) {
+        try {
+            *proxy = boost::shared_ptr<Proxy>(new Proxy(module.getParentBroker()));
+        }
+        catch (const AL::ALError& e) {
+            qiLogError("ResponseToNameInterface") << "Error creating proxy" << e.toString() << std::endl;
+        }
+    }
+
+    /**
+      * Session start step, subscribes to events which can be triggered during the session
+      */
+    void subscribeSession() {
+        dispatcher->subscribe("CallChildRTN");
+        dispatcher->subscribe("EndSessionRTN");
+    }
+
+    /**
+      * Starts the session touched at the given monotonic time
+      * Recordings are loaded while the session events are subscribed to, StartSessionRTN is raised once both are done
+      */
+    void startSession(long long touched) {
+        long long warmed = warmup.wait();
+        if( startupTime < 0 && warmed > 0 ) {
+            startupTime = warmed - created;
+            startupLatency->record(startupTime);
+        }
+        {
+            ConcurrentSetup setup;
+            setup.run(boost::bind(&Impl::loadSounds, this), loadSoundsLatency);
+            setup.run(boost::bind(&Impl::subscribeSession, this), subscribeLatency);
+            setup.wait();
+        }
+        // Signal the start of the session by changing eye color (unblocking call)
+        {
+            ScopedLatency latency(*fadeLatency);
+            ledProxy->post.fadeRGB("FaceLeds", 0x00FF00, 1.5);
+        }
+        // Raise event that the session should start, its time is the start of the session for both modules
+        sessionStart = monotonicTime();
+        inSession = true;
+        {
+            ScopedLatency latency(*raiseEventLatency);
+            dispatcher->raise("StartSessionRTN", timedEventValue(1, sessionStart));
+        }
+        long long started = monotonicTime() - touched;
+        sessionStartLatency->record(started);
+        qiLogInfo("ResponseToNameInterface") << "Session started " << started/1e6 << " ms after the touch, module warmed up "
+                                             << startupTime/1e6 << " ms after it was created" << std::endl;
+    }
+
+    /**
+      * Loads the recordings ahead of the session, so no call waits for its file
+      * Sounds already loaded are kept, so this is cheap from the second session on
+      */
+    void loadSounds() {
+        sounds->setDirectory(soundDirectory);
+        if( useSoundBank ) {
+            sounds->load();
+        }
+        else {
+            sounds->unload();
+        }
+    }
+
+    /**
+      * Called by the playback worker once the player accepted the call, value of CallChildRTN is passed on with the time
+      */
+    void callStarted(int value, long long time) {
+        qiLogVerbose("ResponseToNameInterface") << "Call dispatched " << (time - sessionStart)/1000 << " us into the session" << std::endl;
+        try {
+            ScopedLatency latency(*raiseEventLatency);
+            dispatcher->raise("CallStartedRTN", timedEventValue(value, time));
+        }
+        catch (const AL::ALError& e) {
+            qiLogError("ResponseToNameInterface") << "Error raising CallStartedRTN" << e.toString() << std::endl;
+        }
+    }
+
+    /**
+      * Called by the playback worker once the call ended, notifies the Logger module that the child was called
+      */
+    void callFinished(int value, long long time) {
+        try {
+            ScopedLatency latency(*raiseEventLatency);
+            dispatcher->raise("ChildCalledRTN", timedEventValue(value, time));
+        }
+        catch (const AL::ALError& e) {
+            qiLogError("ResponseToNameInterface") << "Error raising ChildCalledRTN" << e.toString() << std::endl;
+        }
     }
 };
 
@@ -79,6 +301,19 @@ ResponseToNameInterface::ResponseToNameInterface(boost::shared_ptr<AL::ALBroker>
 
     functionName("endSession", getName(), "EndSession callback, resets the Interface");
     BIND_METHOD(ResponseToNameInterface::endSession);
+
+    functionName("sessionResumed", getName(), "SessionResumed callback, joins the session resumed by the Logger");
+    BIND_METHOD(ResponseToNameInterface::sessionResumed);
+
+    functionName("getLatencyHistograms", getName(), "Returns the latency histograms of every callback and proxy call");
+    addParam("reset", "True to clear the histograms once they are read");
+    setReturn("histograms", "[name, count, sum, max, [[limit, count], ...]] for each histogram, times in microseconds");
+    BIND_METHOD(ResponseToNameInterface::getLatencyHistograms);
+
+    functionName("setParameter", getName(), "Sets an Interface parameter, applied from the next session on");
+    addParam("name", "Name of the parameter: soundDirectory or soundBank");
+    addParam("value", "New value of the parameter, soundDirectory is the folder of name.wav, phrase.wav and bravo.wav, soundBank is false to play the recordings from their files");
+    BIND_METHOD(ResponseToNameInterface::setParameter);
 }
 
 ResponseToNameInterface::~ResponseToNameInterface() {
@@ -104,87 +339,125 @@ void ResponseToNameInterface::startTask(const std::string& todo) {
         return;
     }
     impl->started = true;
+    long long requested = monotonicTime();
+    {
+        AL::ALCriticalSection section(impl->fCallbackMutex);
+        impl->warmup.wait();
+        impl->loadSounds();
+    }
     if(todo == "start") {
-        // Subscribe to events which can be triggered during the session
-        try {
-            impl->memoryProxy->subscribeToEvent("CallChildRTN", "ResponseToNameInterface", "callChild");
-            impl->memoryProxy->subscribeToEvent("EndSessionRTN", "ResponseToNameInterface", "endSession");
-        }
-        catch (const AL::ALError& e) {
-            qiLogError("ResponseToNameInterface") << "Error subscribing to events" << e.toString() << std::endl;
-        }
-        // Signal the start of the session by changing eye color (unblocking call)
-        impl->ledProxy->post.fadeRGB("FaceLeds", 0x00FF00, 1.5);
-        // Raise event that the session should start
-        impl->memoryProxy->raiseEvent("StartSessionRTN", AL::ALValue(1));
-
+        impl->startSession(requested);
     }
     else if(todo == "enable") {
         // Subscribe to event FronTactilTouched, which signals the start of the session
-        impl->memoryProxy->subscribeToEvent("FrontTactilTouched", "ResponseToNameInterface", "onTactilTouched");
+        impl->dispatcher->subscribe("FrontTactilTouched");
     }
 }
 
-void ResponseToNameInterface::onTactilTouched() {
+void ResponseToNameInterface::onTactilTouched(const std::string &key, const AL::ALValue &value, const AL::ALValue &msg) {
+    impl->dispatcher->dispatch("FrontTactilTouched", value);
+}
+
+void ResponseToNameInterface::callChild(const std::string &key, const AL::ALValue &value, const AL::ALValue &msg) {
+    impl->dispatcher->dispatch("CallChildRTN", value);
+}
+
+void ResponseToNameInterface::endSession(const std::string &key, const AL::ALValue &value, const AL::ALValue &msg) {
+    impl->dispatcher->dispatch("EndSessionRTN", value);
+}
+
+void ResponseToNameInterface::sessionResumed(const std::string &key, const AL::ALValue &value, const AL::ALValue &msg) {
+    impl->dispatcher->dispatch("SessionResumedRTN", value);
+}
+
+void ResponseToNameInterface::tactilTouched(const AL::ALValue &value) {
     // Callback is thread safe as long as ALCriticalSection object exists
     AL::ALCriticalSection section(impl->fCallbackMutex);
-    // Unsubscribe from the event
-    impl->memoryProxy->unsubscribeToEvent("FrontTactilTouched", "ResponseToNameInterface");
-    // Subscribe to events which can be triggered during the session
-    try {
-        impl->memoryProxy->subscribeToEvent("CallChildRTN", "ResponseToNameInterface", "callChild");
-        impl->memoryProxy->subscribeToEvent("EndSessionRTN", "ResponseToNameInterface", "endSession");
-    }
-    catch (const AL::ALError& e) {
-        qiLogError("ResponseToNameInterface") << "Error subscribing to events" << e.toString() << std::endl;
-    }
-    // Signal the start of the session by changing eye color (unblocking call)
-    impl->ledProxy->post.fadeRGB("FaceLeds", 0x00FF00, 1.5);
-    // Raise event that the session should start
-    impl->memoryProxy->raiseEvent("StartSessionRTN", AL::ALValue(1));
+    long long touched = monotonicTime();
+    // One touch starts one session, stop listening to the sensor
+    impl->dispatcher->unsubscribe("FrontTactilTouched");
+    // Recordings are ready before the first call is made
+    impl->startSession(touched);
 }
 
-void ResponseToNameInterface::callChild(const std::string &key, const AL::ALValue &value, const AL::ALValue &msg) {
+void ResponseToNameInterface::playCall(const AL::ALValue &value) {
     // Thread safety
     AL::ALCriticalSection section(impl->fCallbackMutex);
-    // Unsubscribing
-    impl->memoryProxy->unsubscribeToEvent("CallChildRTN", "ResponseToNameInterface");
 
-    // Reproduce the sound using ALAudioDevice proxy
-    if( (int)value == 1 ) {
+    // Queue the preloaded recording, the playback worker notifies the Logger module once the call ended
+    int call = eventValue(value);
+    if( call == 1 ) {
         // If event is raised with value 1, call child by name
         qiLogVerbose("ResponseToNameInterface") << "Calling with name\n";
-        // TODO: enable the player by uncommenting following line
-        impl->playerProxy->playFile("/home/nao/naoqi/modules/sounds/name.wav");
+        impl->playback->push(SoundBank::Name, 1);
     }
-    else if ( (int)value == 2 ) {
+    else if ( call == 2 ) {
         // Event is raised with value 2, use special phrase
         qiLogVerbose("ResponseToNameInterface") << "Calling with special phrase\n";
-        // TODO: enable the player by uncommenting following line
-        impl->playerProxy->playFile("/home/nao/naoqi/modules/sounds/phrase.wav");
+        impl->playback->push(SoundBank::Phrase, 2);
     }
-    // Notify the Logger module that child was called
-    impl->memoryProxy->raiseEvent("ChildCalledRTN", value);
-
-    // Subscribe to the CallChild event again
-    impl->memoryProxy->subscribeToEvent("CallChildRTN", "ResponseToNameInterface", "callChild");
 }
 
-void ResponseToNameInterface::endSession() {
+void ResponseToNameInterface::resetSession(const AL::ALValue &value) {
     // Thread safety
     AL::ALCriticalSection section(impl->fCallbackMutex);
-    // Unsubscribe
-    impl->memoryProxy->unsubscribeToEvent("EndSessionRTN", "ResponseToNameInterface");
+    // Session is over, stop listening to session events
+    impl->dispatcher->unsubscribe("EndSessionRTN");
+    impl->dispatcher->unsubscribe("CallChildRTN");
+    // Session may have ended while the child was being called
+    impl->playback->cancel();
     // play bravo, unblocking call
-    impl->playerProxy->post.playFile("/home/nao/naoqi/modules/sounds/bravo.wav");
+    {
+        ScopedLatency latency(*impl->postPlayLatency);
+        impl->sounds->post(SoundBank::Bravo);
+    }
     // Signal the end of the session by changing eye color (unblocking call)
-    impl->ledProxy->post.fadeRGB("FaceLeds", 0x0000FF, 1.5);
-    // Reset subscriptions
+    {
+        ScopedLatency latency(*impl->fadeLatency);
+        impl->ledProxy->post.fadeRGB("FaceLeds", 0x0000FF, 1.5);
+    }
+    impl->started = false;
+    impl->inSession = false;
+}
+
+void ResponseToNameInterface::joinSession(const AL::ALValue &value) {
+    // Thread safety
+    AL::ALCriticalSection section(impl->fCallbackMutex);
+    // Interface which went on with the session has nothing to catch up on
+    if( impl->inSession ) {
+        return;
+    }
+    // No new session is started by touch while the resumed one runs
+    impl->dispatcher->unsubscribe("FrontTactilTouched");
+    impl->warmup.wait();
+    impl->loadSounds();
+    impl->subscribeSession();
+    impl->sessionStart = eventTime(value, monotonicTime());
+    impl->started = true;
+    impl->inSession = true;
+    qiLogInfo("ResponseToNameInterface") << "Joined the session resumed after " << eventValue(value) << " calls" << std::endl;
+}
+
+AL::ALValue ResponseToNameInterface::getLatencyHistograms(const bool &reset) {
+    return impl->latencies.toALValue(reset);
+}
+
+void ResponseToNameInterface::setParameter(const std::string &name, const AL::ALValue &value) {
+    // Thread safety of the callback, recordings being loaded in the background read the parameters
+    AL::ALCriticalSection section(impl->fCallbackMutex);
+    impl->warmup.wait();
     try {
-        impl->memoryProxy->unsubscribeToEvent("CallChildRTN", "ResponseToNameInterface");
+        if( name == "soundDirectory" ) {
+            impl->soundDirectory = (std::string)value;
+        }
+        else if( name == "soundBank" ) {
+            impl->useSoundBank = (bool)value;
+        }
+        else {
+            qiLogError("ResponseToNameInterface") << "Unknown parameter " << name << std::endl;
+        }
     }
     catch (const AL::ALError& e) {
-        qiLogError("Interface") << "Error managing events while reseting" << e.toString() << std::endl;
+        qiLogError("ResponseToNameInterface") << "Invalid value for parameter " << name << e.toString() << std::endl;
     }
-    impl->started = false;
 }
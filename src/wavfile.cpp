@@ -0,0 +1,107 @@
+#include "wavfile.hpp"
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+  unsigned long littleEndian(const unsigned char *bytes, int count) {
+      unsigned long value = 0;
+      for( int i = count - 1; i >= 0; --i ) {
+          value = (value << 8) | bytes[i];
+      }
+      return value;
+  }
+
+  bool fail(std::string &error, const char *reason) {
+      error = reason;
+      return false;
+  }
+}
+
+long WavInfo::duration() const {
+    long bytesPerSecond = static_cast<long>(sampleRate)*channels*(bitsPerSample/8);
+    return bytesPerSecond > 0 ? static_cast<long>(static_cast<long long>(dataSize)*1000/bytesPerSecond) : 0;
+}
+
+bool readWavInfo(const std::string &path, WavInfo &info, std::string &error) {
+    std::FILE *file = std::fopen(path.c_str(), "rb");
+    if( !file ) {
+        return fail(error, "file can not be opened");
+    }
+    std::fseek(file, 0, SEEK_END);
+    long fileSize = std::ftell(file);
+    std::fseek(file, 0, SEEK_SET);
+
+    unsigned char header[12];
+    if( std::fread(header, 1, sizeof(header), file) != sizeof(header) ||
+        std::memcmp(header, "RIFF", 4) != 0 || std::memcmp(header + 8, "WAVE", 4) != 0 ) {
+        std::fclose(file);
+        return fail(error, "not a RIFF WAVE file");
+    }
+
+    // Chunks follow one another, fmt has to come before data
+    bool format = false;
+    long offset = sizeof(header);
+    while( true ) {
+        unsigned char chunk[8];
+        if( std::fread(chunk, 1, sizeof(chunk), file) != sizeof(chunk) ) {
+            std::fclose(file);
+            return fail(error, "no data chunk");
+        }
+        unsigned long size = littleEndian(chunk + 4, 4);
+        offset += sizeof(chunk);
+        if( std::memcmp(chunk, "fmt ", 4) == 0 ) {
+            unsigned char fmt[16];
+            if( size < sizeof(fmt) || std::fread(fmt, 1, sizeof(fmt), file) != sizeof(fmt) ) {
+                std::fclose(file);
+                return fail(error, "truncated fmt chunk");
+            }
+            // 1 is integer PCM, 0xFFFE the extensible format used for more than two channels
+            unsigned long tag = littleEndian(fmt, 2);
+            info.channels = static_cast<int>(littleEndian(fmt + 2, 2));
+            info.sampleRate = static_cast<int>(littleEndian(fmt + 4, 4));
+            info.bitsPerSample = static_cast<int>(littleEndian(fmt + 14, 2));
+            if( tag != 1 && tag != 0xFFFE ) {
+                std::fclose(file);
+                return fail(error, "not PCM");
+            }
+            if( info.channels < 1 || info.channels > 8 || info.sampleRate < 8000 || info.sampleRate > 96000 ||
+                (info.bitsPerSample != 8 && info.bitsPerSample != 16 && info.bitsPerSample != 24 && info.bitsPerSample != 32) ) {
+                std::fclose(file);
+                return fail(error, "unsupported PCM format");
+            }
+            format = true;
+            std::fseek(file, static_cast<long>(size - sizeof(fmt)), SEEK_CUR);
+        }
+        else if( std::memcmp(chunk, "data", 4) == 0 ) {
+            std::fclose(file);
+            if( !format ) {
+                return fail(error, "data chunk before fmt chunk");
+            }
+            info.dataOffset = offset;
+            info.dataSize = static_cast<long>(size);
+            if( size == 0 ) {
+                return fail(error, "no samples");
+            }
+            if( offset + info.dataSize > fileSize ) {
+                return fail(error, "truncated data chunk");
+            }
+            if( info.dataSize % (info.channels*(info.bitsPerSample/8)) != 0 ) {
+                return fail(error, "data chunk does not hold whole frames");
+            }
+            return true;
+        }
+        else {
+            std::fseek(file, static_cast<long>(size), SEEK_CUR);
+        }
+        // Chunks are padded to an even length
+        offset += static_cast<long>(size + (size & 1));
+        if( size & 1 ) {
+            std::fseek(file, 1, SEEK_CUR);
+        }
+        if( offset >= fileSize ) {
+            std::fclose(file);
+            return fail(error, "no data chunk");
+        }
+    }
+}
@@ -0,0 +1,310 @@
+/**
+ * Computes the response metrics of recorded sessions, per session and per child, in parallel
+ *
+ * Usage: rtnanalyze [options] <log | directory>...
+ *   --children=file        lines of log,child giving the child of each session, the log by its path or file name
+ *                          sessions not listed belong to the log or directory argument they were found under
+ *   --threads=n            sessions analyzed at once (number of cores)
+ *   --out=file             writes the CSV to the file instead of the standard output
+ *
+ * Writes one CSV row per session, in the order the logs were given, followed by one row per child:
+ *   level              session or child
+ *   child, log
+ *   sessions           1, or the number of sessions of the child
+ *   outcome            value of SE, empty if the session has no end
+ *   responded          1 if the session ended with SE 1, or the number of such sessions of the child
+ *   name_calls         CS records, total for the child
+ *   phrase_calls       PS records, total for the child
+ *   calls_to_response  calls made before SE 1, mean for the child
+ *   face_latency_ms    mean time from CE to the first FD after it
+ *   response_latency_ms  time from the last CE to the first FD of a session ending with SE 1, mean for the child
+ *   sounds             SC records, total for the child
+ *   sounds_between_calls  SC records before the first call, between calls and after the last call, separated by ;
+ * Empty values have no data, e.g. a latency when no face followed any call
+ */
+
+#include "sessionlog.hpp"
+#include "sessionmetrics.hpp"
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+
+namespace
+{
+  struct Session {
+      SessionLogLocation log;
+      std::string child;
+      bool ok;
+      SessionMetrics metrics;
+  };
+
+  /**
+    * Metrics summed over the sessions of one child
+    */
+  struct Child {
+      Child() : sessions(0), responded(0), nameCalls(0), phraseCalls(0), callsToResponse(0),
+                faceLatency(0), faceLatencies(0), responseLatency(0), responseLatencies(0), sounds(0) {}
+      int sessions;
+      int responded;
+      int nameCalls;
+      int phraseCalls;
+      long callsToResponse;
+      double faceLatency;
+      int faceLatencies;
+      double responseLatency;
+      int responseLatencies;
+      long sounds;
+  };
+
+  bool isDirectory(const char *path) {
+      struct stat info;
+      return ::stat(path, &info) == 0 && S_ISDIR(info.st_mode);
+  }
+
+  /**
+    * Value of --name=value, 0 if the argument is another option
+    */
+  const char *option(const char *argument, const char *name) {
+      std::size_t length = std::strlen(name);
+      if( std::strncmp(argument, name, length) == 0 && argument[length] == '=' ) {
+          return argument + length + 1;
+      }
+      return 0;
+  }
+
+  std::string baseName(const std::string &path) {
+      std::string::size_type slash = path.rfind('/');
+      return slash == std::string::npos ? path : path.substr(slash + 1);
+  }
+
+  /**
+    * Reads the log,child lines of the children file, returns false if it can not be read
+    */
+  bool readChildren(const char *path, std::map<std::string, std::string> &children) {
+      std::FILE *file = std::fopen(path, "r");
+      if( !file ) {
+          return false;
+      }
+      char line[1024];
+      while( std::fgets(line, sizeof(line), file) ) {
+          line[std::strcspn(line, "\r\n")] = '\0';
+          char *comma = std::strchr(line, ',');
+          if( comma ) {
+              *comma = '\0';
+              children[line] = comma + 1;
+          }
+      }
+      std::fclose(file);
+      return true;
+  }
+
+  /**
+    * Worker, takes the next session not yet taken until there are none left
+    * Sessions differ in length, so the workers share one counter and take a session at a time
+    * instead of each being handed a fixed range
+    */
+  void analyzeSessions(std::vector<Session> &sessions, volatile long &next) {
+      std::vector<LogRecord> records;
+      while( true ) {
+          long index = __sync_fetch_and_add(&next, 1);
+          if( index >= static_cast<long>(sessions.size()) ) {
+              return;
+          }
+          Session &session = sessions[index];
+          records.clear();
+          session.ok = readSessionLog(session.log, records);
+          if( session.ok ) {
+              session.metrics = sessionMetrics(records);
+          }
+      }
+  }
+
+  /**
+    * Value of a CSV column, quoted if it holds a comma or a quote
+    */
+  std::string field(const std::string &value) {
+      if( value.find_first_of(",\"\n") == std::string::npos ) {
+          return value;
+      }
+      std::string quoted = "\"";
+      for( std::size_t i = 0; i < value.size(); ++i ) {
+          if( value[i] == '"' ) {
+              quoted += '"';
+          }
+          quoted += value[i];
+      }
+      return quoted + "\"";
+  }
+
+  /**
+    * Number as a CSV column, empty if it is negative, i.e. there is no data
+    */
+  std::string number(double value) {
+      if( value < 0 ) {
+          return "";
+      }
+      char text[32];
+      std::snprintf(text, sizeof(text), "%.10g", value);
+      return text;
+  }
+
+  void writeSession(std::FILE *out, const Session &session) {
+      const SessionMetrics &metrics = session.metrics;
+      std::string sounds;
+      for( std::size_t i = 0; i < metrics.soundsBetweenCalls.size(); ++i ) {
+          sounds += (i > 0 ? ";" : "") + number(metrics.soundsBetweenCalls[i]);
+      }
+      char outcome[16] = "";
+      if( metrics.outcome != 0 ) {
+          std::snprintf(outcome, sizeof(outcome), "%d", metrics.outcome);
+      }
+      std::fprintf(out, "session,%s,%s,1,%s,%d,%d,%d,%s,%s,%s,%d,%s\n",
+                   field(session.child).c_str(), field(session.log.path).c_str(),
+                   outcome, metrics.outcome == 1,
+                   metrics.nameCalls, metrics.phraseCalls, number(metrics.callsToResponse).c_str(),
+                   number(metrics.meanFaceLatency()/1000.0).c_str(), number(metrics.responseFaceLatency()/1000.0).c_str(),
+                   metrics.sounds, sounds.c_str());
+  }
+
+  void writeChild(std::FILE *out, const std::string &name, const Child &child) {
+      std::fprintf(out, "child,%s,,%d,,%d,%d,%d,%s,%s,%s,%ld,\n", field(name).c_str(),
+                   child.sessions, child.responded, child.nameCalls, child.phraseCalls,
+                   number(child.responded > 0 ? static_cast<double>(child.callsToResponse)/child.responded : -1).c_str(),
+                   number(child.faceLatencies > 0 ? child.faceLatency/child.faceLatencies/1000.0 : -1).c_str(),
+                   number(child.responseLatencies > 0 ? child.responseLatency/child.responseLatencies/1000.0 : -1).c_str(),
+                   child.sounds);
+  }
+}
+
+int main(int argc, char *argv[]) {
+    unsigned int threads = boost::thread::hardware_concurrency();
+    std::string outPath;
+    std::map<std::string, std::string> children;
+    std::vector<Session> sessions;
+
+    for( int i = 1; i < argc; ++i ) {
+        const char *value;
+        if( (value = option(argv[i], "--children")) ) {
+            if( !readChildren(value, children) ) {
+                std::perror(value);
+                return 2;
+            }
+        }
+        else if( (value = option(argv[i], "--threads")) ) {
+            threads = std::atoi(value);
+        }
+        else if( (value = option(argv[i], "--out")) ) {
+            outPath = value;
+        }
+        else if( argv[i][0] == '-' && argv[i][1] == '-' ) {
+            std::fprintf(stderr, "%s: unknown option %s\n", argv[0], argv[i]);
+            return 2;
+        }
+        else {
+            // Index of a directory is read once here, not by every session of it
+            std::vector<SessionLogLocation> logs;
+            if( isDirectory(argv[i]) ) {
+                logs = locateSessionLogs(argv[i]);
+            }
+            else {
+                // Session which can not be located is reported as unreadable with the rest
+                SessionLogLocation log;
+                log.path = argv[i];
+                if( !locateSessionLog(log.path, log.file, log.offset, log.length) ) {
+                    log.file.clear();
+                }
+                logs.push_back(log);
+            }
+            for( std::size_t j = 0; j < logs.size(); ++j ) {
+                Session session;
+                session.log = logs[j];
+                session.child = argv[i];
+                session.ok = false;
+                sessions.push_back(session);
+            }
+        }
+    }
+    if( sessions.empty() ) {
+        std::fprintf(stderr, "Usage: %s [options] <log | directory>...\n", argv[0]);
+        return 2;
+    }
+    if( !children.empty() ) {
+        for( std::size_t i = 0; i < sessions.size(); ++i ) {
+            std::map<std::string, std::string>::const_iterator child = children.find(sessions[i].log.path);
+            if( child == children.end() ) {
+                child = children.find(baseName(sessions[i].log.path));
+            }
+            if( child != children.end() ) {
+                sessions[i].child = child->second;
+            }
+        }
+    }
+
+    // Sessions are independent, each worker reads and analyzes whole sessions
+    volatile long next = 0;
+    threads = std::max(1u, std::min(threads, static_cast<unsigned int>(sessions.size())));
+    boost::thread_group workers;
+    for( unsigned int i = 0; i < threads; ++i ) {
+        workers.create_thread(boost::bind(analyzeSessions, boost::ref(sessions), boost::ref(next)));
+    }
+    workers.join_all();
+
+    std::FILE *out = stdout;
+    if( !outPath.empty() && !(out = std::fopen(outPath.c_str(), "w")) ) {
+        std::perror(outPath.c_str());
+        return 2;
+    }
+    int status = 0;
+    std::map<std::string, Child> perChild;
+    std::vector<std::string> childOrder;
+    std::fprintf(out, "level,child,log,sessions,outcome,responded,name_calls,phrase_calls,calls_to_response,"
+                      "face_latency_ms,response_latency_ms,sounds,sounds_between_calls\n");
+    for( std::size_t i = 0; i < sessions.size(); ++i ) {
+        const Session &session = sessions[i];
+        if( !session.ok ) {
+            std::fprintf(stderr, "%s: not a readable session log\n", session.log.path.c_str());
+            status = 1;
+            continue;
+        }
+        writeSession(out, session);
+
+        const SessionMetrics &metrics = session.metrics;
+        if( perChild.find(session.child) == perChild.end() ) {
+            childOrder.push_back(session.child);
+        }
+        Child &child = perChild[session.child];
+        child.sessions++;
+        child.nameCalls += metrics.nameCalls;
+        child.phraseCalls += metrics.phraseCalls;
+        child.sounds += metrics.sounds;
+        if( metrics.outcome == 1 ) {
+            child.responded++;
+            child.callsToResponse += metrics.callsToResponse;
+        }
+        for( std::size_t j = 0; j < metrics.faceLatencies.size(); ++j ) {
+            if( metrics.faceLatencies[j] >= 0 ) {
+                child.faceLatency += metrics.faceLatencies[j];
+                child.faceLatencies++;
+            }
+        }
+        if( metrics.responseFaceLatency() >= 0 ) {
+            child.responseLatency += metrics.responseFaceLatency();
+            child.responseLatencies++;
+        }
+    }
+    for( std::size_t i = 0; i < childOrder.size(); ++i ) {
+        writeChild(out, childOrder[i], perChild[childOrder[i]]);
+    }
+    if( out != stdout && std::fclose(out) != 0 ) {
+        std::perror(outPath.c_str());
+        status = 1;
+    }
+    return status;
+}
@@ -0,0 +1,175 @@
+/**
+ * Converts binary session logs written by the Logger module to the tab-separated text layout
+ *
+ * Usage: rtnlog2tsv [--extended] <input.rtnb | directory/sessions.idx#id | -> [output.txt]
+ * Files are memory mapped, "-" streams the log from the standard input
+ * A session of the log storage is given by the index of its directory and its ID
+ *
+ * Sessions are written in the layout of the text log the analysis scripts read, the one the Logger wrote before
+ * the binary format, text sessions as well; --extended writes the layout of the current text log instead,
+ * with times in microseconds, face intervals, latency and summary lines, and copies text sessions as they are
+ */
+
+#include "binarylog.hpp"
+#include "sessionlog.hpp"
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+  std::size_t (*format)(const LogRecord &, char *, std::size_t) = formatLegacyLogRecord;
+
+  /**
+    * Decodes as many complete records as the buffer holds and writes them out
+    * Returns false if the log is corrupt
+    */
+  bool convert(BinaryLogDecoder &decoder, const char *&begin, const char *end, std::FILE *out) {
+      LogRecord record;
+      char line[LogRecord::MaxLineLength];
+      BinaryLogDecoder::Result result;
+      while( (result = decoder.decode(begin, end, record)) == BinaryLogDecoder::Decoded ) {
+          std::fwrite(line, 1, format(record, line, sizeof(line)), out);
+      }
+      return result != BinaryLogDecoder::Corrupt;
+  }
+
+  /**
+    * Writes a session stored as text in the legacy layout
+    */
+  void convertText(const char *begin, const char *end, std::FILE *out) {
+      std::vector<LogRecord> records;
+      parseSessionLogText(begin, end, records);
+      char line[LogRecord::MaxLineLength];
+      for( std::size_t i = 0; i < records.size(); ++i ) {
+          std::fwrite(line, 1, format(records[i], line, sizeof(line)), out);
+      }
+  }
+
+  int convertMapped(const char *path, std::FILE *out) {
+      std::string file;
+      unsigned long long offset;
+      long long length;
+      if( !locateSessionLog(path, file, offset, length) ) {
+          std::fprintf(stderr, "%s: no such session in the index\n", path);
+          return 1;
+      }
+      int fd = ::open(file.c_str(), O_RDONLY);
+      if( fd < 0 ) {
+          std::perror(file.c_str());
+          return 1;
+      }
+      struct stat info;
+      if( length < 0 ) {
+          length = ::fstat(fd, &info) == 0 ? info.st_size : 0;
+      }
+      if( length == 0 ) {
+          std::fprintf(stderr, "%s: empty or unreadable file\n", path);
+          ::close(fd);
+          return 1;
+      }
+      // Mapping has to start at a page boundary
+      unsigned long long skip = offset % ::sysconf(_SC_PAGESIZE);
+      std::size_t mapped = static_cast<std::size_t>(length + skip);
+      void *data = ::mmap(0, mapped, PROT_READ, MAP_PRIVATE, fd, static_cast<off_t>(offset - skip));
+      ::close(fd);
+      if( data == MAP_FAILED ) {
+          std::perror(path);
+          return 1;
+      }
+      ::madvise(data, mapped, MADV_SEQUENTIAL);
+
+      const char *begin = static_cast<const char *>(data) + skip;
+      const char *end = begin + length;
+      BinaryLogDecoder decoder;
+      int status = 0;
+      bool stored = file != path;
+      if( stored && (length < 4 || std::memcmp(begin, "RTNB", 4) != 0) ) {
+          // Stored session written as text
+          if( format == formatLogRecord ) {
+              std::fwrite(begin, 1, end - begin, out);
+          }
+          else {
+              convertText(begin, end, out);
+          }
+      }
+      else if( decoder.decodeHeader(begin, end) != BinaryLogDecoder::Decoded ) {
+          std::fprintf(stderr, "%s: not a binary session log\n", path);
+          status = 1;
+      }
+      else if( !convert(decoder, begin, end, out) ) {
+          std::fprintf(stderr, "%s: corrupt record at byte %ld\n", path, static_cast<long>(begin - static_cast<const char *>(data) - skip));
+          status = 1;
+      }
+      else if( begin != end ) {
+          // Session was interrupted while the record was being written
+          std::fprintf(stderr, "%s: truncated record at the end of the log\n", path);
+      }
+      ::munmap(data, mapped);
+      return status;
+  }
+
+  int convertStream(std::FILE *in, std::FILE *out) {
+      std::vector<char> buffer(65536);
+      std::size_t length = 0;
+      bool header = false;
+      BinaryLogDecoder decoder;
+      while( true ) {
+          std::size_t read = std::fread(&buffer[length], 1, buffer.size() - length, in);
+          length += read;
+          const char *begin = &buffer[0];
+          const char *end = begin + length;
+          if( !header ) {
+              BinaryLogDecoder::Result result = decoder.decodeHeader(begin, end);
+              if( result == BinaryLogDecoder::Corrupt || (result == BinaryLogDecoder::NeedMore && read == 0) ) {
+                  std::fprintf(stderr, "stdin: not a binary session log\n");
+                  return 1;
+              }
+              header = result == BinaryLogDecoder::Decoded;
+          }
+          if( header && !convert(decoder, begin, end, out) ) {
+              std::fprintf(stderr, "stdin: corrupt record\n");
+              return 1;
+          }
+          // Keep the incomplete record for the next read
+          length = end - begin;
+          std::memmove(&buffer[0], begin, length);
+          if( read == 0 ) {
+              if( length > 0 ) {
+                  std::fprintf(stderr, "stdin: truncated record at the end of the log\n");
+              }
+              return 0;
+          }
+      }
+  }
+}
+
+int main(int argc, char *argv[]) {
+    int first = 1;
+    if( argc > 1 && std::strcmp(argv[1], "--extended") == 0 ) {
+        format = formatLogRecord;
+        first = 2;
+    }
+    if( argc - first < 1 || argc - first > 2 ) {
+        std::fprintf(stderr, "Usage: %s [--extended] <input.rtnb | directory/sessions.idx#id | -> [output.txt]\n", argv[0]);
+        return 2;
+    }
+    std::FILE *out = stdout;
+    if( argc - first == 2 ) {
+        out = std::fopen(argv[first + 1], "w");
+        if( !out ) {
+            std::perror(argv[first + 1]);
+            return 1;
+        }
+    }
+    const char *input = argv[first];
+    int status = std::strcmp(input, "-") == 0 ? convertStream(stdin, out) : convertMapped(input, out);
+    if( out != stdout ) {
+        std::fclose(out);
+    }
+    return status;
+}
@@ -0,0 +1,231 @@
+/**
+ * Replays recorded sessions through the call protocol, faster than real time and in parallel
+ *
+ * Usage: rtnreplay [options] <log | directory>...
+ *   --face-timeout=ms      no call before this long after the last face (5000)
+ *   --call-timeout=ms      no call before this long after the last call (5000)
+ *   --name-calls=n         calls by name (5)
+ *   --phrase-calls=n       calls with the special phrase after the calls by name (2)
+ *   --response-faces=n     faces after a call counted as a response (2)
+ *   --protocol=name|file   built-in protocol or protocol file replacing the five options above
+ *   --response-dwell=ms    face has to stay this long after a call to count as a response (0)
+ *   --response-gap=ms      longest gap between frames of a face that stays (500)
+ *   --response-window=ms   faces are counted this long after a call, 0 until the next call (0)
+ *   --call-duration=ms     length of a call, estimated from each log if not given
+ *   --threads=n            sessions replayed at once (number of cores)
+ *   --out=directory        writes the replayed decisions of each session as a text log
+ *
+ * Prints one tab-separated line per session, in the order the logs were given:
+ *   log, recorded outcome, replayed outcome, recorded calls, replayed calls, recorded end, replayed end
+ */
+
+#include "callprotocol.hpp"
+#include "sessionlog.hpp"
+#include "sessionreplay.hpp"
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+
+namespace
+{
+  struct Session {
+      std::string path;
+      bool ok;
+      SessionReplay::Result result;
+  };
+
+  bool isDirectory(const char *path) {
+      struct stat info;
+      return ::stat(path, &info) == 0 && S_ISDIR(info.st_mode);
+  }
+
+  /**
+    * Value of --name=value, 0 if the argument is another option
+    */
+  const char *option(const char *argument, const char *name) {
+      std::size_t length = std::strlen(name);
+      if( std::strncmp(argument, name, length) == 0 && argument[length] == '=' ) {
+          return argument + length + 1;
+      }
+      return 0;
+  }
+
+  std::string baseName(const std::string &path) {
+      std::string::size_type slash = path.rfind('/');
+      return slash == std::string::npos ? path : path.substr(slash + 1);
+  }
+
+  /**
+    * Worker, takes the next session not yet taken until there are none left
+    */
+  void replaySessions(std::vector<Session> &sessions, volatile long &next, const SessionReplay &replay) {
+      while( true ) {
+          long index = __sync_fetch_and_add(&next, 1);
+          if( index >= static_cast<long>(sessions.size()) ) {
+              return;
+          }
+          Session &session = sessions[index];
+          std::vector<LogRecord> records;
+          session.ok = readSessionLog(session.path, records);
+          if( session.ok ) {
+              session.result = replay.run(records);
+          }
+      }
+  }
+
+  /**
+    * Time in seconds as written to the log, "-" if the session has no end
+    */
+  std::string endTime(long long timestamp) {
+      if( timestamp < 0 ) {
+          return "-";
+      }
+      char text[32];
+      std::snprintf(text, sizeof(text), "%g", timestamp/1000.0);
+      return text;
+  }
+
+  bool writeDecisions(const std::string &path, const std::vector<LogRecord> &decisions) {
+      std::FILE *out = std::fopen(path.c_str(), "w");
+      if( !out ) {
+          return false;
+      }
+      char line[LogRecord::MaxLineLength];
+      for( std::size_t i = 0; i < decisions.size(); ++i ) {
+          std::fwrite(line, 1, formatLogRecord(decisions[i], line, sizeof(line)), out);
+      }
+      return std::fclose(out) == 0;
+  }
+}
+
+int main(int argc, char *argv[]) {
+    CallProtocol::Parameters parameters;
+    ResponseDetector::Thresholds response;
+    std::string protocol;
+    long long callDuration = -1;
+    unsigned int threads = boost::thread::hardware_concurrency();
+    std::string outDirectory;
+    std::vector<Session> sessions;
+
+    for( int i = 1; i < argc; ++i ) {
+        const char *value;
+        if( (value = option(argv[i], "--face-timeout")) ) {
+            parameters.faceTimeout = std::atol(value);
+        }
+        else if( (value = option(argv[i], "--call-timeout")) ) {
+            parameters.callTimeout = std::atol(value);
+        }
+        else if( (value = option(argv[i], "--name-calls")) ) {
+            parameters.nameCalls = std::atoi(value);
+        }
+        else if( (value = option(argv[i], "--phrase-calls")) ) {
+            parameters.phraseCalls = std::atoi(value);
+        }
+        else if( (value = option(argv[i], "--response-faces")) ) {
+            parameters.responseFaces = std::atoi(value);
+        }
+        else if( (value = option(argv[i], "--protocol")) ) {
+            protocol = value;
+        }
+        else if( (value = option(argv[i], "--response-dwell")) ) {
+            response.dwell = std::atol(value);
+        }
+        else if( (value = option(argv[i], "--response-gap")) ) {
+            response.gapTolerance = std::atol(value);
+        }
+        else if( (value = option(argv[i], "--response-window")) ) {
+            response.window = std::atol(value);
+        }
+        else if( (value = option(argv[i], "--call-duration")) ) {
+            callDuration = std::atol(value);
+        }
+        else if( (value = option(argv[i], "--threads")) ) {
+            threads = std::atoi(value);
+        }
+        else if( (value = option(argv[i], "--out")) ) {
+            outDirectory = value;
+        }
+        else if( argv[i][0] == '-' && argv[i][1] == '-' ) {
+            std::fprintf(stderr, "%s: unknown option %s\n", argv[0], argv[i]);
+            return 2;
+        }
+        else {
+            std::vector<std::string> logs;
+            if( isDirectory(argv[i]) ) {
+                logs = listSessionLogs(argv[i]);
+            }
+            else {
+                logs.push_back(argv[i]);
+            }
+            for( std::size_t j = 0; j < logs.size(); ++j ) {
+                Session session;
+                session.path = logs[j];
+                session.ok = false;
+                sessions.push_back(session);
+            }
+        }
+    }
+    if( sessions.empty() ) {
+        std::fprintf(stderr, "Usage: %s [options] <log | directory>...\n", argv[0]);
+        return 2;
+    }
+
+    // Sessions are independent, each worker replays whole sessions
+    // Protocol of the options is checked by the same validator as a protocol file
+    CallProtocol::Table table = CallProtocol::tableOf(parameters);
+    std::string error;
+    if( !protocol.empty() && !CallProtocol::load(protocol, table, error) ) {
+        std::fprintf(stderr, "%s: %s\n", protocol.c_str(), error.c_str());
+        return 2;
+    }
+    if( protocol.empty() && !CallProtocol::validate(table, error) ) {
+        std::fprintf(stderr, "%s: protocol of the options %s\n", argv[0], error.c_str());
+        return 2;
+    }
+    SessionReplay replay(table, callDuration, response);
+    volatile long next = 0;
+    threads = std::max(1u, std::min(threads, static_cast<unsigned int>(sessions.size())));
+    boost::thread_group workers;
+    for( unsigned int i = 0; i < threads; ++i ) {
+        workers.create_thread(boost::bind(replaySessions, boost::ref(sessions), boost::ref(next), boost::cref(replay)));
+    }
+    workers.join_all();
+
+    int status = 0;
+    std::printf("log\trecorded\treplayed\trecorded_calls\treplayed_calls\trecorded_end\treplayed_end\n");
+    for( std::size_t i = 0; i < sessions.size(); ++i ) {
+        const Session &session = sessions[i];
+        if( !session.ok ) {
+            std::fprintf(stderr, "%s: not a readable session log\n", session.path.c_str());
+            status = 1;
+            continue;
+        }
+        const SessionReplay::Result &result = session.result;
+        if( result.stalled ) {
+            std::fprintf(stderr, "%s: protocol decided again without its deadline moving, replay stopped\n", session.path.c_str());
+            status = 1;
+        }
+        std::printf("%s\t%d\t%d\t%d\t%d\t%s\t%s\n", session.path.c_str(),
+                    result.recordedOutcome, result.replayedOutcome,
+                    result.recordedCalls, result.replayedCalls,
+                    endTime(result.recordedEnd).c_str(), endTime(result.replayedEnd).c_str());
+        if( !outDirectory.empty() ) {
+            std::string path = outDirectory + "/" + baseName(session.path);
+            // Decisions are always written as text
+            if( path.size() > 5 && path.compare(path.size() - 5, 5, ".rtnb") == 0 ) {
+                path.replace(path.size() - 5, 5, ".txt");
+            }
+            if( !writeDecisions(path, result.decisions) ) {
+                std::perror(path.c_str());
+                status = 1;
+            }
+        }
+    }
+    return status;
+}